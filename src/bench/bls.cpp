@@ -5,7 +5,9 @@
 #include <bench/bench.h>
 #include <random.h>
 #include <bls/bls_worker.h>
+#include <streams.h>
 #include <util/time.h>
+#include <version.h>
 
 #include <iostream>
 
@@ -357,6 +359,51 @@ static void BLS_Verify_BatchedParallel(benchmark::Bench& bench)
     blsWorker.Stop();
 }
 
+static void BLS_Deserialize_Signature(benchmark::Bench& bench)
+{
+    CBLSSecretKey secKey;
+    secKey.MakeNewKey();
+    CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+    ds << secKey.Sign(GetRandHash());
+
+    bench.run([&] {
+        CDataStream ds2(ds);
+        CBLSSignature sig;
+        ds2 >> sig;
+        assert(sig.IsValid());
+    });
+}
+
+static void BLS_Deserialize_LazySignature(benchmark::Bench& bench)
+{
+    CBLSSecretKey secKey;
+    secKey.MakeNewKey();
+    CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+    ds << secKey.Sign(GetRandHash());
+
+    // deserialize and decode, like sig shares in CSigSharesManager
+    bench.run([&] {
+        CDataStream ds2(ds);
+        CBLSLazySignature sig;
+        ds2 >> sig;
+        assert(sig.Get().IsValid());
+    });
+}
+
+static void BLS_LazySignature_Get(benchmark::Bench& bench)
+{
+    CBLSSecretKey secKey;
+    secKey.MakeNewKey();
+    CBLSLazySignature sig;
+    sig.Set(secKey.Sign(GetRandHash()), bls::bls_legacy_scheme.load());
+
+    // repeated access to an already decoded object, e.g. when verifying and rebuilding sig shares
+    bench.minEpochIterations(1000).run([&] {
+        assert(sig.Get().IsValid());
+        assert(!sig.GetHash().IsNull());
+    });
+}
+
 BENCHMARK(BLS_PubKeyAggregate_Normal)
 BENCHMARK(BLS_SecKeyAggregate_Normal)
 BENCHMARK(BLS_SignatureAggregate_Normal)
@@ -371,3 +418,6 @@ BENCHMARK(BLS_Verify_LargeAggregatedBlock1000)
 BENCHMARK(BLS_Verify_LargeAggregatedBlock1000PreVerified)
 BENCHMARK(BLS_Verify_Batched)
 BENCHMARK(BLS_Verify_BatchedParallel)
+BENCHMARK(BLS_Deserialize_Signature)
+BENCHMARK(BLS_Deserialize_LazySignature)
+BENCHMARK(BLS_LazySignature_Get)
@@ -0,0 +1,222 @@
+// Copyright (c) 2023 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <evo/deterministicmns.h>
+#include <random.h>
+#include <util/irange.h>
+
+#include <map>
+
+// Mirrors the snapshot placement done by CDeterministicMNManager::ProcessBlock
+static constexpr int SNAPSHOT_PERIOD = 576;
+static constexpr int SNAPSHOT_MAX_REPLAY_COST = SNAPSHOT_PERIOD * 4;
+
+static CDeterministicMNCPtr MakeTestMN(uint64_t internalId)
+{
+    auto dmn = std::make_shared<CDeterministicMN>(internalId);
+    dmn->proTxHash = GetRandHash();
+    dmn->collateralOutpoint = COutPoint(GetRandHash(), 0);
+    uint160 keyIDOwner;
+    GetRandBytes(keyIDOwner.begin(), keyIDOwner.size());
+    auto state = std::make_shared<CDeterministicMNState>();
+    state->nRegisteredHeight = 1;
+    state->keyIDOwner = CKeyID(keyIDOwner);
+    dmn->pdmnState = state;
+    return dmn;
+}
+
+class MNListChain
+{
+private:
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> blocks;
+    std::vector<CDeterministicMNListDiff> diffs;
+    std::map<int, CDeterministicMNList> snapshots;
+
+public:
+    MNListChain(size_t mnCount, int blockCount, bool adaptive) :
+        hashes(blockCount),
+        blocks(blockCount),
+        diffs(blockCount)
+    {
+        FastRandomContext rng(true);
+
+        CDeterministicMNList list(uint256(), 0, 0);
+        for (const auto i : irange::range(mnCount)) {
+            list.AddMN(MakeTestMN(i));
+        }
+
+        int nReplayCost{0};
+        for (const auto nHeight : irange::range(blockCount)) {
+            hashes[nHeight] = GetRandHash();
+            blocks[nHeight].phashBlock = &hashes[nHeight];
+            blocks[nHeight].nHeight = nHeight;
+            blocks[nHeight].pprev = nHeight > 0 ? &blocks[nHeight - 1] : nullptr;
+
+            // every block pays one masternode, roughly once a day a quorum commitment punishes a large chunk of them
+            size_t nUpdates = 1 + rng.randrange(3);
+            if (rng.randrange(SNAPSHOT_PERIOD) == 0) {
+                nUpdates += mnCount / 10;
+            }
+            CDeterministicMNList newList = list;
+            newList.SetBlockHash(hashes[nHeight]);
+            newList.SetHeight(nHeight);
+            for ([[maybe_unused]] const auto _ : irange::range(nUpdates)) {
+                auto dmn = newList.GetMNByInternalId(rng.randrange(mnCount));
+                auto newState = std::make_shared<CDeterministicMNState>(*dmn->pdmnState);
+                newState->nLastPaidHeight = nHeight;
+                newState->nPoSePenalty = rng.randrange(100);
+                newList.UpdateMN(*dmn, newState);
+            }
+            diffs[nHeight] = list.BuildDiff(newList);
+            list = newList;
+
+            nReplayCost += diffs[nHeight].GetReplayCost();
+            if (nHeight % SNAPSHOT_PERIOD == 0 || (adaptive && nReplayCost > SNAPSHOT_MAX_REPLAY_COST)) {
+                snapshots.emplace(nHeight, list);
+                nReplayCost = 0;
+            }
+        }
+    }
+
+    CDeterministicMNList GetListForHeight(int nHeight) const
+    {
+        auto it = std::prev(snapshots.upper_bound(nHeight));
+        CDeterministicMNList list = it->second;
+        for (int h = it->first + 1; h <= nHeight; h++) {
+            list = list.ApplyDiff(&blocks[h], diffs[h]);
+        }
+        return list;
+    }
+};
+
+static void EvoMNListReplay(benchmark::Bench& bench, bool adaptive)
+{
+    constexpr int blockCount = SNAPSHOT_PERIOD * 4;
+    MNListChain chain(4000, blockCount, adaptive);
+    FastRandomContext rng(true);
+
+    bench.run([&] {
+        auto list = chain.GetListForHeight(rng.randrange(blockCount));
+        assert(list.GetAllMNsCount() == 4000);
+    });
+}
+
+static void EvoMNListReplay_Periodic(benchmark::Bench& bench)
+{
+    EvoMNListReplay(bench, false);
+}
+
+static void EvoMNListReplay_Adaptive(benchmark::Bench& bench)
+{
+    EvoMNListReplay(bench, true);
+}
+
+static void EvoCalculateQuorum(benchmark::Bench& bench, size_t mnCount)
+{
+    CDeterministicMNList list(uint256(), 0, 0);
+    for (const auto i : irange::range(mnCount)) {
+        auto dmn = std::make_shared<CDeterministicMN>(*MakeTestMN(i));
+        auto state = std::make_shared<CDeterministicMNState>(*dmn->pdmnState);
+        state->UpdateConfirmedHash(dmn->proTxHash, GetRandHash());
+        dmn->pdmnState = state;
+        list.AddMN(dmn);
+    }
+
+    // quorum size of LLMQ_400_60
+    const uint256 modifier = GetRandHash();
+    bench.run([&] {
+        auto quorum = list.CalculateQuorum(400, modifier);
+        assert(quorum.size() == 400);
+    });
+}
+
+static void EvoCalculateQuorum_4k(benchmark::Bench& bench)
+{
+    EvoCalculateQuorum(bench, 4000);
+}
+
+static void EvoCalculateQuorum_10k(benchmark::Bench& bench)
+{
+    EvoCalculateQuorum(bench, 10000);
+}
+
+static void EvoCalculateQuorum_50k(benchmark::Bench& bench)
+{
+    EvoCalculateQuorum(bench, 50000);
+}
+
+static CDeterministicMNList MakeFlatViewTestList(size_t mnCount)
+{
+    CDeterministicMNList list(uint256(), 0, 0);
+    for (const auto i : irange::range(mnCount)) {
+        list.AddMN(MakeTestMN(i));
+    }
+    return list;
+}
+
+// Every block mutates the list (payments, DecreasePoSePenalties), so the first flat view access for a new block always
+// rebuilds the view. Compare that with the cost of the mutation alone and with a cache hit.
+static void EvoMNListFlatView_Update(benchmark::Bench& bench, size_t mnCount, bool fAccessView)
+{
+    const auto list = MakeFlatViewTestList(mnCount);
+    FastRandomContext rng(true);
+
+    bench.run([&] {
+        CDeterministicMNList newList = list;
+        auto dmn = newList.GetMNByInternalId(rng.randrange(mnCount));
+        auto newState = std::make_shared<CDeterministicMNState>(*dmn->pdmnState);
+        newState->nLastPaidHeight++;
+        newList.UpdateMN(*dmn, newState);
+        if (fAccessView) {
+            assert(newList.GetFlatView()->size() == mnCount);
+        }
+    });
+}
+
+static void EvoMNListFlatView_UpdateOnly_4k(benchmark::Bench& bench)
+{
+    EvoMNListFlatView_Update(bench, 4000, false);
+}
+
+static void EvoMNListFlatView_UpdateAndRebuild_4k(benchmark::Bench& bench)
+{
+    EvoMNListFlatView_Update(bench, 4000, true);
+}
+
+static void EvoMNListFlatView_Hit_4k(benchmark::Bench& bench)
+{
+    const auto list = MakeFlatViewTestList(4000);
+    assert(list.GetFlatView()->size() == 4000);
+
+    bench.run([&] {
+        assert(list.GetFlatView()->size() == 4000);
+    });
+}
+
+// what the view replaces: counting the valid masternodes by walking the immer map
+static void EvoMNListFlatView_ImmerWalk_4k(benchmark::Bench& bench)
+{
+    const auto list = MakeFlatViewTestList(4000);
+
+    bench.run([&] {
+        size_t nValid{0};
+        list.ForEachMN(false, [&](const CDeterministicMN& dmn) {
+            if (CDeterministicMNList::IsMNValid(dmn)) nValid++;
+        });
+        assert(nValid == 4000);
+    });
+}
+
+BENCHMARK(EvoMNListReplay_Periodic)
+BENCHMARK(EvoMNListReplay_Adaptive)
+BENCHMARK(EvoCalculateQuorum_4k)
+BENCHMARK(EvoCalculateQuorum_10k)
+BENCHMARK(EvoCalculateQuorum_50k)
+BENCHMARK(EvoMNListFlatView_UpdateOnly_4k)
+BENCHMARK(EvoMNListFlatView_UpdateAndRebuild_4k)
+BENCHMARK(EvoMNListFlatView_Hit_4k)
+BENCHMARK(EvoMNListFlatView_ImmerWalk_4k)
@@ -7,11 +7,18 @@
 #include <random.h>
 
 #ifndef BUILD_BITCOIN_INTERNAL
+#include <crypto/sha256.h>
+#include <crypto/siphash.h>
 #include <support/allocators/mt_pooled_secure.h>
+#include <unordered_lru_cache.h>
 #endif
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <limits>
+#include <mutex>
+#include <numeric>
 
 namespace bls {
     std::atomic<bool> bls_legacy_scheme = std::atomic<bool>(true);
@@ -214,6 +221,13 @@ bool CBLSPublicKey::DHKeyExchange(const CBLSSecretKey& sk, const CBLSPublicKey&
     return true;
 }
 
+void CBLSPublicKey::MulInsecure(const CBLSSecretKey& k)
+{
+    assert(IsValid() && k.IsValid());
+    impl = impl * k.impl;
+    cachedHash.SetNull();
+}
+
 void CBLSSignature::AggregateInsecure(const CBLSSignature& o)
 {
     assert(IsValid() && o.IsValid());
@@ -288,6 +302,13 @@ void CBLSSignature::SubInsecure(const CBLSSignature& o)
     cachedHash.SetNull();
 }
 
+void CBLSSignature::MulInsecure(const CBLSSecretKey& k)
+{
+    assert(IsValid() && k.IsValid());
+    impl = impl * k.impl;
+    cachedHash.SetNull();
+}
+
 bool CBLSSignature::VerifyInsecure(const CBLSPublicKey& pubKey, const uint256& hash, const bool specificLegacyScheme) const
 {
     if (!IsValid() || !pubKey.IsValid()) {
@@ -352,30 +373,211 @@ bool CBLSSignature::VerifySecureAggregated(const std::vector<CBLSPublicKey>& pks
     }
 }
 
+namespace {
+// RAII wrapper around a relic big number, works with both of relic's AUTO and DYNAMIC allocation modes
+struct BLSBigNum
+{
+    bn_t v;
+
+    BLSBigNum() { bn_null(v); bn_new(v); }
+    BLSBigNum(const BLSBigNum& o) : BLSBigNum() { bn_copy(v, o.v); }
+    BLSBigNum& operator=(const BLSBigNum& o)
+    {
+        bn_copy(v, o.v);
+        return *this;
+    }
+    ~BLSBigNum() { bn_free(v); }
+};
+
+// r = r mod order, in [0, order)
+void BLSModOrder(bn_t r, const bn_t order)
+{
+    bn_mod(r, r, order);
+    if (bn_sign(r) == RLC_NEG) {
+        bn_add(r, r, order);
+    }
+}
+
+void BLSMulMod(bn_t r, const bn_t a, const bn_t b, const bn_t order)
+{
+    bn_mul(r, a, b);
+    BLSModOrder(r, order);
+}
+
+// Inverts all (non-zero) values with a single modular inversion
+void BLSBatchInvert(const std::vector<BLSBigNum>& vals, std::vector<BLSBigNum>& ret, const bn_t order)
+{
+    const size_t k = vals.size();
+    ret.resize(k);
+    if (k == 0) {
+        return;
+    }
+
+    // prefix[i] = vals[0] * ... * vals[i]
+    std::vector<BLSBigNum> prefix(k);
+    bn_copy(prefix[0].v, vals[0].v);
+    for (size_t i = 1; i < k; i++) {
+        BLSMulMod(prefix[i].v, prefix[i - 1].v, vals[i].v, order);
+    }
+    BLSBigNum inv;
+    bn_mod_inv(inv.v, prefix[k - 1].v, order);
+
+    for (size_t i = k - 1; i > 0; i--) {
+        // inv is 1 / (vals[0] * ... * vals[i]) here
+        BLSMulMod(ret[i].v, inv.v, prefix[i - 1].v, order);
+        BLSMulMod(inv.v, inv.v, vals[i].v, order);
+    }
+    bn_copy(ret[0].v, inv.v);
+}
+
+// Lagrange coefficients for interpolating at 0, see bls::Poly::LagrangeInterpolate. Fails for zero or duplicate ids.
+bool ComputeLagrangeCoefficients(const std::vector<uint256>& ids, std::vector<BLSBigNum>& ret)
+{
+    const size_t k = ids.size();
+
+    BLSBigNum order;
+    gt_get_ord(order.v);
+
+    std::vector<BLSBigNum> xs(k);
+    for (size_t i = 0; i < k; i++) {
+        bn_read_bin(xs[i].v, ids[i].begin(), BLS_CURVE_ID_SIZE);
+        BLSModOrder(xs[i].v, order.v);
+        if (bn_is_zero(xs[i].v)) {
+            return false;
+        }
+    }
+
+    // coefficient i is num / dens[i] with num = prod_j xs[j] and dens[i] = xs[i] * prod_{j != i} (xs[j] - xs[i])
+    BLSBigNum num, diff;
+    bn_set_dig(num.v, 1);
+    std::vector<BLSBigNum> dens(xs);
+    for (size_t i = 0; i < k; i++) {
+        BLSMulMod(num.v, num.v, xs[i].v, order.v);
+        for (size_t j = i + 1; j < k; j++) {
+            bn_sub(diff.v, xs[j].v, xs[i].v);
+            BLSModOrder(diff.v, order.v);
+            if (bn_is_zero(diff.v)) {
+                return false;
+            }
+            BLSMulMod(dens[i].v, dens[i].v, diff.v, order.v);
+            bn_sub(diff.v, order.v, diff.v);
+            BLSMulMod(dens[j].v, dens[j].v, diff.v, order.v);
+        }
+    }
+
+    BLSBatchInvert(dens, ret, order.v);
+    for (auto& c : ret) {
+        BLSMulMod(c.v, c.v, num.v, order.v);
+    }
+    return true;
+}
+
+#ifndef BUILD_BITCOIN_INTERNAL
+struct LagrangeCacheKeyHasher
+{
+    const uint64_t k0{GetRand(std::numeric_limits<uint64_t>::max())};
+    const uint64_t k1{GetRand(std::numeric_limits<uint64_t>::max())};
+
+    size_t operator()(const uint256& key) const
+    {
+        return SipHashUint256(k0, k1, key);
+    }
+};
+
+struct LagrangeCache
+{
+    std::mutex mutex;
+    unordered_lru_cache<uint256, std::vector<uint256>, LagrangeCacheKeyHasher, CBLSLagrangeCache::MAX_SIZE> cache;
+};
+
+// constructed on first use, the hasher salt must not be drawn during static initialization
+LagrangeCache& GetLagrangeCache()
+{
+    static LagrangeCache lagrangeCache;
+    return lagrangeCache;
+}
+#endif
+
+// ids must be sorted, so that the same set of ids always ends up with the same cache entry
+bool GetLagrangeCoefficients(const std::vector<uint256>& ids, std::vector<BLSBigNum>& ret)
+{
+#ifndef BUILD_BITCOIN_INTERNAL
+    uint256 key;
+    CSHA256 hasher;
+    for (const auto& id : ids) {
+        hasher.Write(id.begin(), id.size());
+    }
+    hasher.Finalize(key.begin());
+
+    auto& c = GetLagrangeCache();
+    std::vector<uint256> cached;
+    bool found;
+    {
+        std::unique_lock<std::mutex> l(c.mutex);
+        found = c.cache.get(key, cached);
+    }
+    if (found && cached.size() == ids.size()) {
+        ret.resize(cached.size());
+        for (size_t i = 0; i < cached.size(); i++) {
+            bn_read_bin(ret[i].v, cached[i].begin(), cached[i].size());
+        }
+        return true;
+    }
+#endif
+
+    if (!ComputeLagrangeCoefficients(ids, ret)) {
+        return false;
+    }
+
+#ifndef BUILD_BITCOIN_INTERNAL
+    cached.resize(ret.size());
+    for (size_t i = 0; i < ret.size(); i++) {
+        bn_write_bin(cached[i].begin(), cached[i].size(), ret[i].v);
+    }
+    std::unique_lock<std::mutex> l(c.mutex);
+    c.cache.insert(key, std::move(cached));
+#endif
+    return true;
+}
+} // anonymous namespace
+
 bool CBLSSignature::Recover(const std::vector<CBLSSignature>& sigs, const std::vector<CBLSId>& ids)
 {
     fValid = false;
     cachedHash.SetNull();
 
-    if (sigs.empty() || ids.empty() || sigs.size() != ids.size()) {
+    if (sigs.empty() || sigs.size() != ids.size()) {
         return false;
     }
 
-    std::vector<bls::G2Element> sigsVec;
-    std::vector<bls::Bytes> idsVec;
-    sigsVec.reserve(sigs.size());
-    idsVec.reserve(sigs.size());
-
     for (size_t i = 0; i < sigs.size(); i++) {
         if (!sigs[i].IsValid() || !ids[i].IsValid()) {
             return false;
         }
-        sigsVec.emplace_back(sigs[i].impl);
-        idsVec.emplace_back(ids[i].impl.begin(), ids[i].impl.size());
+    }
+
+    // The coefficients only depend on the set of ids, not on their order
+    std::vector<size_t> sorted(ids.size());
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::sort(sorted.begin(), sorted.end(), [&](size_t a, size_t b) { return ids[a].impl < ids[b].impl; });
+
+    std::vector<uint256> sortedIds;
+    sortedIds.reserve(ids.size());
+    for (const auto i : sorted) {
+        sortedIds.emplace_back(ids[i].impl);
+    }
+
+    std::vector<BLSBigNum> coeffs;
+    if (!GetLagrangeCoefficients(sortedIds, coeffs)) {
+        return false;
     }
 
     try {
-        impl = bls::Threshold::SignatureRecover(sigsVec, idsVec);
+        bls::G2Element sum;
+        for (size_t i = 0; i < sorted.size(); i++) {
+            sum += sigs[sorted[i]].impl * coeffs[i].v;
+        }
+        impl = sum;
     } catch (...) {
         return false;
     }
@@ -385,8 +587,221 @@ bool CBLSSignature::Recover(const std::vector<CBLSSignature>& sigs, const std::v
     return true;
 }
 
+struct CBLSSignatureRecovery::Impl
+{
+    BLSBigNum order;
+    // product of all ids
+    BLSBigNum num;
+
+    std::vector<bls::G2Element> sigs;
+    std::vector<BLSBigNum> ids;
+    // den[i] = ids[i] * prod_{j != i} (ids[j] - ids[i]), so that the Lagrange coefficient of share i is num / den[i]
+    std::vector<BLSBigNum> dens;
+
+    Impl()
+    {
+        gt_get_ord(order.v);
+        bn_set_dig(num.v, 1);
+    }
+};
+
+CBLSSignatureRecovery::CBLSSignatureRecovery() : impl(std::make_unique<Impl>()) {}
+CBLSSignatureRecovery::~CBLSSignatureRecovery() = default;
+CBLSSignatureRecovery::CBLSSignatureRecovery(CBLSSignatureRecovery&&) noexcept = default;
+CBLSSignatureRecovery& CBLSSignatureRecovery::operator=(CBLSSignatureRecovery&&) noexcept = default;
+
+bool CBLSSignatureRecovery::Add(const CBLSId& id, const CBLSSignature& sig)
+{
+    if (!id.IsValid() || !sig.IsValid()) {
+        return false;
+    }
+
+    const auto& order = impl->order.v;
+
+    BLSBigNum x;
+    bn_read_bin(x.v, id.impl.begin(), BLS_CURVE_ID_SIZE);
+    BLSModOrder(x.v, order);
+    if (bn_is_zero(x.v)) {
+        return false;
+    }
+
+    // check for duplicates first, so that a failed Add leaves everything untouched
+    std::vector<BLSBigNum> diffs(impl->ids.size());
+    for (size_t i = 0; i < impl->ids.size(); i++) {
+        bn_sub(diffs[i].v, x.v, impl->ids[i].v);
+        BLSModOrder(diffs[i].v, order);
+        if (bn_is_zero(diffs[i].v)) {
+            return false;
+        }
+    }
+
+    BLSBigNum den = x;
+    BLSBigNum negDiff;
+    for (size_t i = 0; i < impl->ids.size(); i++) {
+        // the new id contributes (x - ids[i]) to all existing denominators and each existing id contributes
+        // (ids[i] - x) to the new one
+        BLSMulMod(impl->dens[i].v, impl->dens[i].v, diffs[i].v, order);
+        bn_sub(negDiff.v, order, diffs[i].v);
+        BLSMulMod(den.v, den.v, negDiff.v, order);
+    }
+    BLSMulMod(impl->num.v, impl->num.v, x.v, order);
+
+    impl->sigs.emplace_back(sig.impl);
+    impl->ids.emplace_back(std::move(x));
+    impl->dens.emplace_back(std::move(den));
+    return true;
+}
+
+size_t CBLSSignatureRecovery::Size() const
+{
+    return impl->sigs.size();
+}
+
+bool CBLSSignatureRecovery::Recover(CBLSSignature& ret) const
+{
+    ret = CBLSSignature();
+
+    const size_t k = impl->sigs.size();
+    if (k == 0) {
+        return false;
+    }
+    const auto& order = impl->order.v;
+
+    std::vector<BLSBigNum> invDens;
+    BLSBatchInvert(impl->dens, invDens, order);
+
+    bls::G2Element sum;
+    BLSBigNum coeff;
+    for (size_t i = 0; i < k; i++) {
+        BLSMulMod(coeff.v, invDens[i].v, impl->num.v, order);
+        sum += impl->sigs[i] * coeff.v;
+    }
+
+    ret.impl = sum;
+    ret.fValid = true;
+    ret.cachedHash.SetNull();
+    return true;
+}
+
 #ifndef BUILD_BITCOIN_INTERNAL
 
+namespace {
+using PubKeyCacheKey = std::pair<bool, std::array<uint8_t, BLS_CURVE_PUBKEY_SIZE>>;
+
+struct PubKeyCacheKeyHasher
+{
+    // salted, the looked up bytes are attacker controlled
+    const uint64_t k0{GetRand(std::numeric_limits<uint64_t>::max())};
+    const uint64_t k1{GetRand(std::numeric_limits<uint64_t>::max())};
+
+    size_t operator()(const PubKeyCacheKey& key) const
+    {
+        return CSipHasher(k0, k1).Write(key.first).Write(key.second.data(), key.second.size()).Finalize();
+    }
+};
+
+// key, value, LRU counter and the node/bucket overhead of the map
+constexpr size_t PUBKEY_CACHE_ENTRY_SIZE = sizeof(PubKeyCacheKey) + sizeof(bls::G1Element) + sizeof(int64_t) + 4 * sizeof(void*);
+// Lookups happen concurrently from the message handler, the BLS workers and validation. Even a hit updates the LRU
+// state, so instead of a single lock the cache is split into shards, each with its own lock and LRU
+constexpr size_t PUBKEY_CACHE_SHARDS = 16;
+// the cache grows to twice its size before it's truncated
+constexpr size_t PUBKEY_CACHE_SHARD_MAX_SIZE = CBLSPublicKeyCache::MAX_MEMORY_USAGE / PUBKEY_CACHE_ENTRY_SIZE / 2 / PUBKEY_CACHE_SHARDS;
+
+struct PubKeyCacheShard
+{
+    std::mutex mutex;
+    unordered_lru_cache<PubKeyCacheKey, bls::G1Element, PubKeyCacheKeyHasher, PUBKEY_CACHE_SHARD_MAX_SIZE> cache;
+};
+
+struct PubKeyCache
+{
+    const PubKeyCacheKeyHasher hasher;
+    std::array<PubKeyCacheShard, PUBKEY_CACHE_SHARDS> shards;
+
+    PubKeyCacheShard& GetShard(const PubKeyCacheKey& key) { return shards[hasher(key) % PUBKEY_CACHE_SHARDS]; }
+};
+
+// constructed on first use, the hasher salt must not be drawn during static initialization
+PubKeyCache& GetPubKeyCache()
+{
+    static PubKeyCache pubKeyCache;
+    return pubKeyCache;
+}
+
+bool MakePubKeyCacheKey(Span<const uint8_t> bytes, const bool specificLegacyScheme, PubKeyCacheKey& ret)
+{
+    if (bytes.size() != BLS_CURVE_PUBKEY_SIZE) {
+        return false;
+    }
+    ret.first = specificLegacyScheme;
+    std::copy(bytes.begin(), bytes.end(), ret.second.begin());
+    return true;
+}
+} // anonymous namespace
+
+bool CBLSPublicKeyCache::Get(Span<const uint8_t> bytes, const bool specificLegacyScheme, bls::G1Element& ret)
+{
+    PubKeyCacheKey key;
+    if (!MakePubKeyCacheKey(bytes, specificLegacyScheme, key)) {
+        return false;
+    }
+    auto& shard = GetPubKeyCache().GetShard(key);
+    std::unique_lock<std::mutex> l(shard.mutex);
+    return shard.cache.get(key, ret);
+}
+
+void CBLSPublicKeyCache::Add(Span<const uint8_t> bytes, const bool specificLegacyScheme, const CBLSPublicKey& pk)
+{
+    PubKeyCacheKey key;
+    if (!pk.IsValid() || !MakePubKeyCacheKey(bytes, specificLegacyScheme, key)) {
+        return;
+    }
+    auto& shard = GetPubKeyCache().GetShard(key);
+    std::unique_lock<std::mutex> l(shard.mutex);
+    shard.cache.insert(key, pk.impl);
+}
+
+void CBLSPublicKeyCache::Add(const CBLSPublicKey& pk, const bool specificLegacyScheme)
+{
+    if (!pk.IsValid()) {
+        return;
+    }
+    Add(pk.ToByteVector(specificLegacyScheme), specificLegacyScheme, pk);
+}
+
+size_t CBLSLagrangeCache::Size()
+{
+    auto& c = GetLagrangeCache();
+    std::unique_lock<std::mutex> l(c.mutex);
+    return c.cache.size();
+}
+
+void CBLSLagrangeCache::Clear()
+{
+    auto& c = GetLagrangeCache();
+    std::unique_lock<std::mutex> l(c.mutex);
+    c.cache.clear();
+}
+
+size_t CBLSPublicKeyCache::Size()
+{
+    size_t nSize{0};
+    for (auto& shard : GetPubKeyCache().shards) {
+        std::unique_lock<std::mutex> l(shard.mutex);
+        nSize += shard.cache.size();
+    }
+    return nSize;
+}
+
+void CBLSPublicKeyCache::Clear()
+{
+    for (auto& shard : GetPubKeyCache().shards) {
+        std::unique_lock<std::mutex> l(shard.mutex);
+        shard.cache.clear();
+    }
+}
+
 static std::once_flag init_flag;
 static mt_pooled_secure_allocator<uint8_t>* secure_allocator_instance;
 static void create_secure_allocator()
@@ -7,6 +7,7 @@
 
 #include <hash.h>
 #include <serialize.h>
+#include <span.h>
 #include <uint256.h>
 #include <util/strencodings.h>
 #include <util/ranges.h>
@@ -22,11 +23,13 @@
 #undef DOUBLE
 #undef SEED
 
+#include <algorithm>
 #include <array>
-#include <mutex>
-#include <unistd.h>
-
 #include <atomic>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
 
 namespace bls {
     extern std::atomic<bool> bls_legacy_scheme;
@@ -40,6 +43,41 @@ constexpr int BLS_CURVE_SIG_SIZE{96};
 
 class CBLSSignature;
 class CBLSPublicKey;
+class CBLSSignatureRecovery;
+
+#ifndef BUILD_BITCOIN_INTERNAL
+// Decompressing and validating a serialized G1 element is by far the most expensive part of decoding a public key.
+// Operator and quorum public keys are decoded over and over again (evo db, diffs, commitments, ProTx payloads), so
+// these are kept in a process wide and memory bounded LRU cache, keyed by their serialized form. The cache is only
+// consulted where keys are also added: by lazy (operator) keys and when unserializing quorum commitments, whose keys
+// are added by CQuorum. Other public keys are decoded without touching the cache.
+class CBLSPublicKeyCache
+{
+public:
+    // upper bound for the memory used by the cache, including map overhead
+    static constexpr size_t MAX_MEMORY_USAGE = 8 * 1024 * 1024;
+
+    static bool Get(Span<const uint8_t> bytes, const bool specificLegacyScheme, bls::G1Element& ret);
+    // bytes must be the canonical serialization of pk in the given scheme
+    static void Add(Span<const uint8_t> bytes, const bool specificLegacyScheme, const CBLSPublicKey& pk);
+    static void Add(const CBLSPublicKey& pk, const bool specificLegacyScheme);
+    static size_t Size();
+    static void Clear();
+};
+
+// CBLSSignature::Recover needs the Lagrange coefficients of the ids of the used shares. Quorums usually recover from
+// the shares of the same (well connected) members, so the coefficients are cached, keyed by the hash of the sorted
+// ids. This saves the modular inversions and the quadratic number of multiplications of computing them.
+class CBLSLagrangeCache
+{
+public:
+    // number of id sets, the cache grows to twice its size before it's truncated
+    static constexpr size_t MAX_SIZE = 128;
+
+    static size_t Size();
+    static void Clear();
+};
+#endif
 
 template <typename ImplType, size_t _SerSize, typename C>
 class CBLSWrapper
@@ -47,6 +85,7 @@ class CBLSWrapper
     friend class CBLSSecretKey;
     friend class CBLSPublicKey;
     friend class CBLSSignature;
+    friend class CBLSSignatureRecovery;
 
 protected:
     ImplType impl;
@@ -99,18 +138,29 @@ public:
         *(static_cast<C*>(this)) = C();
     }
 
-    void SetByteVector(const std::vector<uint8_t>& vecBytes, const bool specificLegacyScheme)
+    // fUseCache is only supported for public keys, see CBLSPublicKeyCache
+    void SetBytes(Span<const uint8_t> bytes, const bool specificLegacyScheme, const bool fUseCache = false)
     {
-        if (vecBytes.size() != SerSize) {
+        if (bytes.size() != SerSize) {
             Reset();
             return;
         }
 
-        if (ranges::all_of(vecBytes, [](uint8_t c) { return c == 0; })) {
+        if (std::all_of(bytes.begin(), bytes.end(), [](uint8_t c) { return c == 0; })) {
             Reset();
         } else {
             try {
-                impl = ImplType::FromBytes(bls::Bytes(vecBytes), specificLegacyScheme);
+#ifndef BUILD_BITCOIN_INTERNAL
+                bool fCached{false};
+                if constexpr (std::is_same_v<ImplType, bls::G1Element>) {
+                    fCached = fUseCache && CBLSPublicKeyCache::Get(bytes, specificLegacyScheme, impl);
+                }
+                if (!fCached) {
+                    impl = ImplType::FromBytes(bls::Bytes(bytes.data(), bytes.size()), specificLegacyScheme);
+                }
+#else
+                impl = ImplType::FromBytes(bls::Bytes(bytes.data(), bytes.size()), specificLegacyScheme);
+#endif
                 fValid = true;
             } catch (...) {
                 Reset();
@@ -119,6 +169,11 @@ public:
         cachedHash.SetNull();
     }
 
+    void SetByteVector(const std::vector<uint8_t>& vecBytes, const bool specificLegacyScheme)
+    {
+        SetBytes(vecBytes, specificLegacyScheme);
+    }
+
     void SetByteVector(const std::vector<uint8_t>& vecBytes)
     {
         SetByteVector(vecBytes, bls::bls_legacy_scheme.load());
@@ -173,6 +228,11 @@ public:
     template <typename Stream>
     inline void Serialize(Stream& s, const bool specificLegacyScheme) const
     {
+        if (!fValid) {
+            static constexpr std::array<uint8_t, SerSize> nullBytes{};
+            s.write(reinterpret_cast<const char*>(nullBytes.data()), SerSize);
+            return;
+        }
         s.write(reinterpret_cast<const char*>(ToByteVector(specificLegacyScheme).data()), SerSize);
     }
 
@@ -183,17 +243,18 @@ public:
     }
 
     template <typename Stream>
-    inline void Unserialize(Stream& s, const bool specificLegacyScheme, bool checkMalleable = true)
+    inline void Unserialize(Stream& s, const bool specificLegacyScheme, bool checkMalleable = true, bool fUseCache = false)
     {
-        std::vector<uint8_t> vecBytes(SerSize, 0);
-        s.read(reinterpret_cast<char*>(vecBytes.data()), SerSize);
-        SetByteVector(vecBytes, specificLegacyScheme);
+        // decoded from the stack, deserializing sigs and keys is hot enough in the LLMQ code to avoid heap allocations
+        std::array<uint8_t, SerSize> bytes;
+        s.read(reinterpret_cast<char*>(bytes.data()), SerSize);
+        SetBytes(bytes, specificLegacyScheme, fUseCache);
 
-        if (checkMalleable && !CheckMalleable(vecBytes, specificLegacyScheme)) {
+        if (checkMalleable && !CheckMalleable(bytes, specificLegacyScheme)) {
             // If CheckMalleable failed with specificLegacyScheme, we need to try again with the opposite scheme.
             // Probably we received the BLS object sent with legacy scheme, but in the meanwhile the fork activated.
-            SetByteVector(vecBytes, !specificLegacyScheme);
-            if (!CheckMalleable(vecBytes, !specificLegacyScheme)) {
+            SetBytes(bytes, !specificLegacyScheme);
+            if (!CheckMalleable(bytes, !specificLegacyScheme)) {
                 // Both attempts failed
                 throw std::ios_base::failure("malleable BLS object");
             } else {
@@ -210,9 +271,13 @@ public:
         Unserialize(s, bls::bls_legacy_scheme.load(), checkMalleable);
     }
 
-    inline bool CheckMalleable(const std::vector<uint8_t>& vecBytes, const bool specificLegacyScheme) const
+    inline bool CheckMalleable(Span<const uint8_t> bytes, const bool specificLegacyScheme) const
     {
-        if (memcmp(vecBytes.data(), ToByteVector(specificLegacyScheme).data(), SerSize)) {
+        if (!fValid) {
+            // the null object serializes to all zeros
+            return std::all_of(bytes.begin(), bytes.end(), [](uint8_t c) { return c == 0; });
+        }
+        if (bytes.size() != SerSize || memcmp(bytes.data(), ToByteVector(specificLegacyScheme).data(), SerSize)) {
             // TODO not sure if this is actually possible with the BLS libs. I'm assuming here that somewhere deep inside
             // these libs masking might happen, so that 2 different binary representations could result in the same object
             // representation
@@ -221,9 +286,9 @@ public:
         return true;
     }
 
-    inline bool CheckMalleable(const std::vector<uint8_t>& vecBytes) const
+    inline bool CheckMalleable(Span<const uint8_t> bytes) const
     {
-        return CheckMalleable(vecBytes, bls::bls_legacy_scheme.load());
+        return CheckMalleable(bytes, bls::bls_legacy_scheme.load());
     }
 
     inline std::string ToString(const bool specificLegacyScheme) const
@@ -297,6 +362,9 @@ class CBLSPublicKey : public CBLSWrapper<bls::G1Element, BLS_CURVE_PUBKEY_SIZE,
 {
     friend class CBLSSecretKey;
     friend class CBLSSignature;
+#ifndef BUILD_BITCOIN_INTERNAL
+    friend class CBLSPublicKeyCache;
+#endif
 
 public:
     using CBLSWrapper::operator=;
@@ -312,6 +380,9 @@ public:
     bool PublicKeyShare(const std::vector<CBLSPublicKey>& mpk, const CBLSId& id);
     bool DHKeyExchange(const CBLSSecretKey& sk, const CBLSPublicKey& pk);
 
+    // multiplies the key with the scalar k, used to randomize batch verifications
+    void MulInsecure(const CBLSSecretKey& k);
+
 };
 
 class ConstCBLSPublicKeyVersionWrapper {
@@ -334,11 +405,13 @@ private:
     CBLSPublicKey& obj;
     bool legacy;
     bool checkMalleable;
+    bool fUseCache;
 public:
-    CBLSPublicKeyVersionWrapper(CBLSPublicKey& obj, bool legacy, bool checkMalleable = true)
+    CBLSPublicKeyVersionWrapper(CBLSPublicKey& obj, bool legacy, bool checkMalleable = true, bool fUseCache = false)
             : obj(obj)
             , legacy(legacy)
             , checkMalleable(checkMalleable)
+            , fUseCache(fUseCache)
     {}
     template <typename Stream>
     inline void Serialize(Stream& s) const {
@@ -346,7 +419,7 @@ public:
     }
     template <typename Stream>
     inline void Unserialize(Stream& s) {
-        obj.Unserialize(s, legacy, checkMalleable);
+        obj.Unserialize(s, legacy, checkMalleable, fUseCache);
     }
 };
 
@@ -368,6 +441,8 @@ public:
     static CBLSSignature AggregateSecure(const std::vector<CBLSSignature>& sigs, const std::vector<CBLSPublicKey>& pks, const uint256& hash);
 
     void SubInsecure(const CBLSSignature& o);
+    // multiplies the signature with the scalar k, used to randomize batch verifications
+    void MulInsecure(const CBLSSecretKey& k);
     [[nodiscard]] bool VerifyInsecure(const CBLSPublicKey& pubKey, const uint256& hash, const bool specificLegacyScheme) const;
     [[nodiscard]] bool VerifyInsecure(const CBLSPublicKey& pubKey, const uint256& hash) const;
     [[nodiscard]] bool VerifyInsecureAggregated(const std::vector<CBLSPublicKey>& pubKeys, const std::vector<uint256>& hashes) const;
@@ -377,6 +452,30 @@ public:
     bool Recover(const std::vector<CBLSSignature>& sigs, const std::vector<CBLSId>& ids);
 };
 
+/**
+ * Recovers a threshold signature from shares which arrive one after another. Lagrange interpolation needs, for every
+ * share, the product of the differences of its id to all other ids. These are updated as each share is added, which
+ * are cheap scalar operations. When the threshold is reached, only a single batched inversion and the weighted sum of
+ * the shares are left to do. The result is the same as the one of CBLSSignature::Recover.
+ */
+class CBLSSignatureRecovery
+{
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+
+public:
+    CBLSSignatureRecovery();
+    ~CBLSSignatureRecovery();
+    CBLSSignatureRecovery(CBLSSignatureRecovery&&) noexcept;
+    CBLSSignatureRecovery& operator=(CBLSSignatureRecovery&&) noexcept;
+
+    // Fails for invalid, zero or duplicate ids and for invalid signatures
+    bool Add(const CBLSId& id, const CBLSSignature& sig);
+    [[nodiscard]] size_t Size() const;
+    bool Recover(CBLSSignature& ret) const;
+};
+
 class CBLSSignatureVersionWrapper {
 private:
     CBLSSignature& obj;
@@ -403,20 +502,76 @@ template<typename BLSObject>
 class CBLSLazyWrapper
 {
 private:
-    mutable std::mutex mutex;
-
-    mutable std::vector<uint8_t> vecBytes;
-    mutable bool bufValid{false};
-    mutable bool bufLegacyScheme{true};
+    // All lazily computed members are initialized at most once between two modifications (Set, SetLegacy,
+    // Unserialize or assignment), which need exclusive access to the object. Const access only synchronizes on the
+    // per member state, so reading an already decoded/encoded object neither blocks nor allocates.
+    enum : uint8_t {
+        LAZY_EMPTY,
+        LAZY_BUSY,
+        LAZY_READY,
+    };
+
+    using Bytes = std::array<uint8_t, BLSObject::SerSize>;
+
+    // serialized forms and their hashes, indexed by the scheme (0 = basic, 1 = legacy)
+    mutable std::array<Bytes, 2> bufBytes{};
+    mutable std::array<std::atomic<uint8_t>, 2> bufState{};
+    mutable std::array<uint256, 2> hashes;
+    mutable std::array<std::atomic<uint8_t>, 2> hashState{};
 
     mutable BLSObject obj;
-    mutable bool objInitialized{false};
+    mutable std::atomic<uint8_t> objState{LAZY_READY};
+    // scheme of the serialized form obj is decoded from, only meaningful while obj is not decoded yet
+    mutable bool srcLegacyScheme{true};
+
+    mutable std::atomic<bool> bufLegacyScheme;
+
+    template <typename Callable>
+    static void InitOnce(std::atomic<uint8_t>& state, Callable&& init)
+    {
+        uint8_t s = state.load(std::memory_order_acquire);
+        while (s != LAZY_READY) {
+            if (s == LAZY_EMPTY && state.compare_exchange_weak(s, LAZY_BUSY, std::memory_order_acquire)) {
+                try {
+                    init();
+                } catch (...) {
+                    // don't leave other threads spinning on LAZY_BUSY forever, the next caller retries
+                    state.store(LAZY_EMPTY, std::memory_order_release);
+                    throw;
+                }
+                state.store(LAZY_READY, std::memory_order_release);
+                return;
+            }
+            if (s == LAZY_BUSY) {
+                // another thread is decoding/encoding the same object right now
+                std::this_thread::yield();
+                s = state.load(std::memory_order_acquire);
+            }
+        }
+    }
+
+    void SetSource(const bool specificLegacyScheme, const bool fObjReady) const
+    {
+        srcLegacyScheme = specificLegacyScheme;
+        objState = fObjReady ? LAZY_READY : LAZY_EMPTY;
+        bufState[specificLegacyScheme] = fObjReady ? LAZY_EMPTY : LAZY_READY;
+        bufState[!specificLegacyScheme] = LAZY_EMPTY;
+        hashState[0] = LAZY_EMPTY;
+        hashState[1] = LAZY_EMPTY;
+        bufLegacyScheme = specificLegacyScheme;
+    }
 
-    mutable uint256 hash;
+    const Bytes& GetBytes(const bool specificLegacyScheme) const
+    {
+        InitOnce(bufState[specificLegacyScheme], [&]() {
+            const auto vecBytes = Get().ToByteVector(specificLegacyScheme);
+            std::copy(vecBytes.begin(), vecBytes.end(), bufBytes[specificLegacyScheme].begin());
+        });
+        return bufBytes[specificLegacyScheme];
+    }
 
 public:
     CBLSLazyWrapper() :
-            vecBytes(BLSObject::SerSize, 0),
             bufLegacyScheme(bls::bls_legacy_scheme.load())
     {}
 
@@ -428,22 +583,31 @@ public:
 
     CBLSLazyWrapper& operator=(const CBLSLazyWrapper& r)
     {
-        std::unique_lock<std::mutex> l(r.mutex);
-        bufValid = r.bufValid;
-        bufLegacyScheme = r.bufLegacyScheme;
-        if (r.bufValid) {
-            vecBytes = r.vecBytes;
-        } else {
-            vecBytes.resize(BLSObject::SerSize);
-            std::fill(vecBytes.begin(), vecBytes.end(), 0);
+        if (this == &r) {
+            return *this;
         }
-        objInitialized = r.objInitialized;
-        if (r.objInitialized) {
+        for (size_t i = 0; i < 2; i++) {
+            const bool fBufReady = r.bufState[i].load(std::memory_order_acquire) == LAZY_READY;
+            if (fBufReady) {
+                bufBytes[i] = r.bufBytes[i];
+            }
+            bufState[i] = fBufReady ? LAZY_READY : LAZY_EMPTY;
+            const bool fHashReady = r.hashState[i].load(std::memory_order_acquire) == LAZY_READY;
+            if (fHashReady) {
+                hashes[i] = r.hashes[i];
+            }
+            hashState[i] = fHashReady ? LAZY_READY : LAZY_EMPTY;
+        }
+        // if r is not decoded yet, its serialized source is always ready and was copied above
+        if (r.objState.load(std::memory_order_acquire) == LAZY_READY) {
             obj = r.obj;
+            objState = LAZY_READY;
         } else {
             obj.Reset();
+            objState = LAZY_EMPTY;
         }
-        hash = r.hash;
+        srcLegacyScheme = r.srcLegacyScheme;
+        bufLegacyScheme = r.bufLegacyScheme.load();
         return *this;
     }
 
@@ -455,17 +619,9 @@ public:
     template<typename Stream>
     inline void Serialize(Stream& s, const bool specificLegacyScheme) const
     {
-        std::unique_lock<std::mutex> l(mutex);
-        if (!objInitialized && !bufValid) {
-            vecBytes.resize(BLSObject::SerSize);
-            std::fill(vecBytes.begin(), vecBytes.end(), 0);
-        } else if (!bufValid || (bufLegacyScheme != specificLegacyScheme)) {
-            vecBytes = obj.ToByteVector(specificLegacyScheme);
-            bufValid = true;
-            bufLegacyScheme = specificLegacyScheme;
-            hash.SetNull();
-        }
-        s.write(reinterpret_cast<const char*>(vecBytes.data()), vecBytes.size());
+        const auto& bytes = GetBytes(specificLegacyScheme);
+        bufLegacyScheme = specificLegacyScheme;
+        s.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
     }
 
     template<typename Stream>
@@ -477,12 +633,8 @@ public:
     template<typename Stream>
     inline void Unserialize(Stream& s, const bool specificLegacyScheme) const
     {
-        std::unique_lock<std::mutex> l(mutex);
-        s.read(reinterpret_cast<char*>(vecBytes.data()), BLSObject::SerSize);
-        bufValid = true;
-        bufLegacyScheme = specificLegacyScheme;
-        objInitialized = false;
-        hash.SetNull();
+        s.read(reinterpret_cast<char*>(bufBytes[specificLegacyScheme].data()), BLSObject::SerSize);
+        SetSource(specificLegacyScheme, false);
     }
 
     template<typename Stream>
@@ -493,41 +645,36 @@ public:
 
     void Set(const BLSObject& _obj, const bool specificLegacyScheme)
     {
-        std::unique_lock<std::mutex> l(mutex);
-        bufValid = false;
-        bufLegacyScheme = specificLegacyScheme;
-        objInitialized = true;
         obj = _obj;
-        hash.SetNull();
+        SetSource(specificLegacyScheme, true);
     }
     const BLSObject& Get() const
     {
-        std::unique_lock<std::mutex> l(mutex);
-        static BLSObject invalidObj;
-        if (!bufValid && !objInitialized) {
-            return invalidObj;
-        }
-        if (!objInitialized) {
-            obj.SetByteVector(vecBytes, bufLegacyScheme);
-            if (!obj.IsValid()) {
-                bufValid = false;
-                return invalidObj;
+        InitOnce(objState, [&]() {
+            const auto& bytes = bufBytes[srcLegacyScheme];
+            obj.SetBytes(bytes, srcLegacyScheme, /*fUseCache=*/std::is_same_v<BLSObject, CBLSPublicKey>);
+            if (obj.IsValid() && !obj.CheckMalleable(bytes, srcLegacyScheme)) {
+                obj.Reset();
             }
-            if (!obj.CheckMalleable(vecBytes, bufLegacyScheme)) {
-                bufValid = false;
-                return invalidObj;
+            if constexpr (std::is_same_v<BLSObject, CBLSPublicKey>) {
+                // lazy public keys are operator keys, which are decoded again with every new state/diff/payload
+                if (obj.IsValid()) {
+                    CBLSPublicKeyCache::Add(bytes, srcLegacyScheme, obj);
+                }
             }
-            objInitialized = true;
-        }
+        });
         return obj;
     }
 
     bool operator==(const CBLSLazyWrapper& r) const
     {
-        if (bufValid && r.bufValid && bufLegacyScheme == r.bufLegacyScheme) {
-            return vecBytes == r.vecBytes;
+        const bool fLegacy = bufLegacyScheme;
+        if (fLegacy == r.bufLegacyScheme &&
+            bufState[fLegacy].load(std::memory_order_acquire) == LAZY_READY &&
+            r.bufState[fLegacy].load(std::memory_order_acquire) == LAZY_READY) {
+            return bufBytes[fLegacy] == r.bufBytes[fLegacy];
         }
-        if (objInitialized && r.objInitialized) {
+        if (objState.load(std::memory_order_acquire) == LAZY_READY && r.objState.load(std::memory_order_acquire) == LAZY_READY) {
             return obj == r.obj;
         }
         return Get() == r.Get();
@@ -540,22 +687,14 @@ public:
 
     uint256 GetHash() const
     {
-        std::unique_lock<std::mutex> l(mutex);
-        if (!objInitialized && !bufValid) {
-            vecBytes.resize(BLSObject::SerSize);
-            std::fill(vecBytes.begin(), vecBytes.end(), 0);
-            hash.SetNull();
-        } else if (!bufValid) {
-            vecBytes = obj.ToByteVector(bufLegacyScheme);
-            bufValid = true;
-            hash.SetNull();
-        }
-        if (hash.IsNull()) {
+        const bool fLegacy = bufLegacyScheme;
+        InitOnce(hashState[fLegacy], [&]() {
+            const auto& bytes = GetBytes(fLegacy);
             CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-            ss.write(reinterpret_cast<const char*>(vecBytes.data()), vecBytes.size());
-            hash = ss.GetHash();
-        }
-        return hash;
+            ss.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+            hashes[fLegacy] = ss.GetHash();
+        });
+        return hashes[fLegacy];
     }
 
     bool IsLegacy() const
@@ -565,7 +704,13 @@ public:
 
     void SetLegacy(bool specificLegacyScheme)
     {
-        bufLegacyScheme = specificLegacyScheme;
+        if (objState == LAZY_READY || srcLegacyScheme == specificLegacyScheme) {
+            bufLegacyScheme = specificLegacyScheme;
+            return;
+        }
+        // not decoded yet, the serialized bytes are reinterpreted in the given scheme
+        bufBytes[specificLegacyScheme] = bufBytes[srcLegacyScheme];
+        SetSource(specificLegacyScheme, false);
     }
 
     std::string ToString() const
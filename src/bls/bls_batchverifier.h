@@ -6,8 +6,14 @@
 #define DASH_CRYPTO_BLS_BATCHVERIFIER_H
 
 #include <bls/bls.h>
-
-#include <map>
+#include <bls/bls_worker.h>
+#include <saltedhasher.h>
+
+#include <functional>
+#include <set>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 template<typename SourceId, typename MessageId>
@@ -21,13 +27,22 @@ private:
         CBLSPublicKey pubKey;
     };
 
-    using MessageMap = std::map<MessageId, Message>;
-    using MessageMapIterator = typename MessageMap::iterator;
-    using MessagesBySourceMap = std::map<SourceId, std::vector<MessageMapIterator>>;
+    // integral ids (e.g. NodeId) are hashed with std::hash, everything else (uint256, SigShareKey) with the salted hasher
+    template <typename T>
+    using Hasher = std::conditional_t<std::is_integral_v<T>, std::hash<T>, StaticSaltedHasher>;
+
+    // Messages are referenced by pointer, these stay valid when the map rehashes (iterators don't)
+    using MessageMap = std::unordered_map<MessageId, Message, Hasher<MessageId>>;
+    using MessagesBySourceMap = std::unordered_map<SourceId, std::vector<const Message*>, Hasher<SourceId>>;
+    using MessagesByHashMap = std::unordered_map<uint256, std::vector<const Message*>, StaticSaltedHasher>;
+
+    // Don't split a batch into shards smaller than this, each shard needs its own final exponentiation
+    static constexpr size_t MIN_SHARD_SIZE = 16;
 
     bool secureVerification;
     bool perMessageFallback;
     size_t subBatchSize;
+    CBLSWorker* worker;
 
     MessageMap messages;
     MessagesBySourceMap messagesBySource;
@@ -37,10 +52,15 @@ public:
     std::set<MessageId> badMessages;
 
 public:
-    CBLSBatchVerifier(bool _secureVerification, bool _perMessageFallback, size_t _subBatchSize = 0) :
+    /**
+     * If a worker is passed, large insecure batches are split into shards which are verified in parallel on the
+     * worker pool. Must not be used from inside of the worker's own threads then.
+     */
+    CBLSBatchVerifier(bool _secureVerification, bool _perMessageFallback, size_t _subBatchSize = 0, CBLSWorker* _worker = nullptr) :
             secureVerification(_secureVerification),
             perMessageFallback(_perMessageFallback),
-            subBatchSize(_subBatchSize)
+            subBatchSize(_subBatchSize),
+            worker(_worker)
     {
     }
 
@@ -49,7 +69,7 @@ public:
         assert(sig.IsValid() && pubKey.IsValid());
 
         auto it = messages.emplace(msgId, Message{msgId, msgHash, sig, pubKey}).first;
-        messagesBySource[sourceId].emplace_back(it);
+        messagesBySource[sourceId].emplace_back(&it->second);
 
         if (subBatchSize != 0 && messages.size() >= subBatchSize) {
             Verify();
@@ -70,10 +90,11 @@ public:
 
     void Verify()
     {
-        std::map<uint256, std::vector<MessageMapIterator>> byMessageHash;
+        MessagesByHashMap byMessageHash;
+        byMessageHash.reserve(messages.size());
 
-        for (auto it = messages.begin(); it != messages.end(); ++it) {
-            byMessageHash[it->second.msgHash].emplace_back(it);
+        for (const auto& p : messages) {
+            byMessageHash[p.second.msgHash].emplace_back(&p.second);
         }
 
         if (VerifyBatch(byMessageHash)) {
@@ -81,6 +102,28 @@ public:
             return;
         }
 
+        if (perMessageFallback) {
+            // Find the bad messages by bisecting the batch. This needs O(b * log(n)) batch verifications for b bad
+            // messages, so mixing a few invalid messages into a large batch can't force per-message verification of
+            // all of them. Every source which sent a bad message is bad.
+            std::vector<const Message*> msgs;
+            msgs.reserve(messages.size());
+            for (const auto& p : messages) {
+                msgs.emplace_back(&p.second);
+            }
+            Bisect(msgs, 0, msgs.size());
+
+            for (const auto& p : messagesBySource) {
+                for (const auto* msg : p.second) {
+                    if (badMessages.count(msg->msgId)) {
+                        badSources.emplace(p.first);
+                        break;
+                    }
+                }
+            }
+            return;
+        }
+
         // revert to per-source verification
         for (const auto& p : messagesBySource) {
             bool batchValid = false;
@@ -88,42 +131,75 @@ public:
             // no need to verify it again if there was just one source
             if (messagesBySource.size() != 1) {
                 byMessageHash.clear();
-                for (auto it = p.second.begin(); it != p.second.end(); ++it) {
-                    byMessageHash[(*it)->second.msgHash].emplace_back(*it);
+                for (const auto* msg : p.second) {
+                    byMessageHash[msg->msgHash].emplace_back(msg);
                 }
                 batchValid = VerifyBatch(byMessageHash);
             }
             if (!batchValid) {
                 badSources.emplace(p.first);
+            }
+        }
+    }
 
-                if (perMessageFallback) {
-                    // revert to per-message verification
-                    if (p.second.size() == 1) {
-                        // no need to re-verify a single message
-                        badMessages.emplace(p.second[0]->second.msgId);
-                    } else {
-                        for (const auto& msgIt : p.second) {
-                            if (badMessages.count(msgIt->first)) {
-                                // same message might be invalid from different source, so no need to re-verify it
-                                continue;
-                            }
-
-                            const auto& msg = msgIt->second;
-                            if (!msg.sig.VerifyInsecure(msg.pubKey, msg.msgHash)) {
-                                badMessages.emplace(msg.msgId);
-                            }
-                        }
-                    }
+private:
+    // Called for ranges which failed verification. A message is only marked bad after it failed verification on its
+    // own, so valid messages can't be convicted by inference
+    void Bisect(const std::vector<const Message*>& msgs, size_t start, size_t count)
+    {
+        if (count == 1) {
+            if (!VerifyRange(msgs, start, 1)) {
+                badMessages.emplace(msgs[start]->msgId);
+            }
+            return;
+        }
+
+        const size_t half = count / 2;
+        const bool firstValid = VerifyRange(msgs, start, half);
+        const bool secondValid = VerifyRange(msgs, start + half, count - half);
+        if (firstValid && secondValid) {
+            // Both halves are valid on their own while the whole range is not. Sharded and secure batches are not a
+            // single equation, so messages in here might cancel each other out. Check all of them individually.
+            for (size_t i = start; i < start + count; i++) {
+                if (!VerifyRange(msgs, i, 1)) {
+                    badMessages.emplace(msgs[i]->msgId);
                 }
             }
+            return;
+        }
+        // ranges of a single message were already verified individually above
+        if (!firstValid) {
+            if (half == 1) {
+                badMessages.emplace(msgs[start]->msgId);
+            } else {
+                Bisect(msgs, start, half);
+            }
+        }
+        if (!secondValid) {
+            if (count - half == 1) {
+                badMessages.emplace(msgs[start + half]->msgId);
+            } else {
+                Bisect(msgs, start + half, count - half);
+            }
         }
     }
 
-private:
+    bool VerifyRange(const std::vector<const Message*>& msgs, size_t start, size_t count)
+    {
+        if (count == 1) {
+            return msgs[start]->sig.VerifyInsecure(msgs[start]->pubKey, msgs[start]->msgHash);
+        }
+        MessagesByHashMap byMessageHash;
+        for (size_t i = start; i < start + count; i++) {
+            byMessageHash[msgs[i]->msgHash].emplace_back(msgs[i]);
+        }
+        return VerifyBatch(byMessageHash);
+    }
+
     // All Verify methods take ownership of the passed byMessageHash map and thus might modify the map. This is to avoid
     // unnecessary copies
 
-    bool VerifyBatch(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash)
+    bool VerifyBatch(MessagesByHashMap& byMessageHash)
     {
         if (secureVerification) {
             return VerifyBatchSecure(byMessageHash);
@@ -132,38 +208,65 @@ private:
         }
     }
 
-    bool VerifyBatchInsecure(const std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash)
+    bool VerifyBatchInsecure(const MessagesByHashMap& byMessageHash)
+    {
+        std::vector<const typename MessagesByHashMap::value_type*> entries;
+        entries.reserve(byMessageHash.size());
+        for (const auto& p : byMessageHash) {
+            entries.emplace_back(&p);
+        }
+
+        // Aggregating e(g, s1 + s2) = e(pk1, h1) * e(pk2, h2) over disjoint sets of message hashes gives independent
+        // checks, so the Miller loops of large batches are spread over the worker threads. The batch is valid if all
+        // shards are valid.
+        size_t nShards = 1;
+        if (worker != nullptr) {
+            nShards = std::min(worker->GetWorkerCount() + 1, entries.size() / MIN_SHARD_SIZE);
+        }
+        if (nShards <= 1) {
+            return VerifyShardInsecure(entries, 0, entries.size());
+        }
+
+        std::vector<std::function<bool()>> jobs;
+        jobs.reserve(nShards);
+        const size_t nShardSize = (entries.size() + nShards - 1) / nShards;
+        for (size_t start = 0; start < entries.size(); start += nShardSize) {
+            const size_t count = std::min(nShardSize, entries.size() - start);
+            jobs.emplace_back([this, &entries, start, count]() { return VerifyShardInsecure(entries, start, count); });
+        }
+        return worker->ExecuteParallel(jobs);
+    }
+
+    bool VerifyShardInsecure(const std::vector<const typename MessagesByHashMap::value_type*>& entries, size_t start, size_t count) const
     {
         CBLSSignature aggSig;
         std::vector<uint256> msgHashes;
         std::vector<CBLSPublicKey> pubKeys;
-        std::set<MessageId> dups;
+        std::unordered_set<MessageId, Hasher<MessageId>> dups;
 
-        msgHashes.reserve(messages.size());
-        pubKeys.reserve(messages.size());
+        msgHashes.reserve(count);
+        pubKeys.reserve(count);
 
-        for (const auto& p : byMessageHash) {
-            const auto& msgHash = p.first;
+        for (size_t i = start; i < start + count; i++) {
+            const auto& msgHash = entries[i]->first;
 
             CBLSPublicKey aggPubKey;
 
-            for (const auto& msgIt : p.second) {
-                const auto& msg = msgIt->second;
-
-                if (!dups.emplace(msg.msgId).second) {
+            for (const auto* msg : entries[i]->second) {
+                if (!dups.emplace(msg->msgId).second) {
                     continue;
                 }
 
                 if (!aggSig.IsValid()) {
-                    aggSig = msg.sig;
+                    aggSig = msg->sig;
                 } else {
-                    aggSig.AggregateInsecure(msg.sig);
+                    aggSig.AggregateInsecure(msg->sig);
                 }
 
                 if (!aggPubKey.IsValid()) {
-                    aggPubKey = msg.pubKey;
+                    aggPubKey = msg->pubKey;
                 } else {
-                    aggPubKey.AggregateInsecure(msg.pubKey);
+                    aggPubKey.AggregateInsecure(msg->pubKey);
                 }
             }
 
@@ -183,7 +286,7 @@ private:
         return aggSig.VerifyInsecureAggregated(pubKeys, msgHashes);
     }
 
-    bool VerifyBatchSecure(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash)
+    bool VerifyBatchSecure(MessagesByHashMap& byMessageHash)
     {
         // Loop until the byMessageHash map is empty, which means that all messages were verified
         // The secure form of verification will only aggregate one message for the same message hash, even if multiple
@@ -197,34 +300,34 @@ private:
         return true;
     }
 
-    bool VerifyBatchSecureStep(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash)
+    bool VerifyBatchSecureStep(MessagesByHashMap& byMessageHash)
     {
         CBLSSignature aggSig;
         std::vector<uint256> msgHashes;
         std::vector<CBLSPublicKey> pubKeys;
-        std::set<MessageId> dups;
+        std::unordered_set<MessageId, Hasher<MessageId>> dups;
 
         msgHashes.reserve(messages.size());
         pubKeys.reserve(messages.size());
 
         for (auto it = byMessageHash.begin(); it != byMessageHash.end(); ) {
             const auto& msgHash = it->first;
-            auto& messageIts = it->second;
-            const auto& msg = messageIts.back()->second;
+            auto& msgs = it->second;
+            const auto* msg = msgs.back();
 
-            if (dups.emplace(msg.msgId).second) {
+            if (dups.emplace(msg->msgId).second) {
                 msgHashes.emplace_back(msgHash);
-                pubKeys.emplace_back(msg.pubKey);
+                pubKeys.emplace_back(msg->pubKey);
 
                 if (!aggSig.IsValid()) {
-                    aggSig = msg.sig;
+                    aggSig = msg->sig;
                 } else {
-                    aggSig.AggregateInsecure(msg.sig);
+                    aggSig.AggregateInsecure(msg->sig);
                 }
             }
 
-            messageIts.pop_back();
-            if (messageIts.empty()) {
+            msgs.pop_back();
+            if (msgs.empty()) {
                 it = byMessageHash.erase(it);
             } else {
                 ++it;
@@ -838,6 +838,35 @@ bool CBLSWorker::IsAsyncVerifyInProgress()
     return sigVerifyBatchesInProgress != 0;
 }
 
+size_t CBLSWorker::GetWorkerCount()
+{
+    return size_t(workerPool.size());
+}
+
+bool CBLSWorker::ExecuteParallel(const std::vector<std::function<bool()>>& jobs)
+{
+    if (jobs.empty()) {
+        return true;
+    }
+    if (workerPool.size() == 0) {
+        return ranges::all_of(jobs, [](const auto& job) { return job(); });
+    }
+
+    std::vector<std::future<bool>> futures;
+    futures.reserve(jobs.size() - 1);
+    for (size_t i = 1; i < jobs.size(); i++) {
+        futures.emplace_back(workerPool.push([&job = jobs[i]](int threadId) { return job(); }));
+    }
+    bool result = jobs[0]();
+    // wait for all futures, even if we already know that the result is false, the jobs reference memory of the caller
+    for (auto& f : futures) {
+        if (!f.get()) {
+            result = false;
+        }
+    }
+    return result;
+}
+
 // sigVerifyMutex must be held while calling
 void CBLSWorker::PushSigVerifyBatch()
 {
@@ -129,6 +129,14 @@ public:
     std::future<bool> AsyncVerifySig(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash, CancelCond cancelCond = [] { return false; });
     bool IsAsyncVerifyInProgress();
 
+    // Number of threads in the worker pool, 0 if the worker is not running
+    size_t GetWorkerCount();
+
+    // Runs all jobs in parallel (the first one on the calling thread) and returns true if all of them returned true.
+    // Falls back to running the jobs on the calling thread if the pool is not running. Must not be called from inside
+    // of the worker pool as this would deadlock once all workers wait for each other.
+    bool ExecuteParallel(const std::vector<std::function<bool()>>& jobs);
+
 private:
     void PushSigVerifyBatch();
 };
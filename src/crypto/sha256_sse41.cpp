@@ -64,7 +64,9 @@ void inline Write4(unsigned char* out, int offset, __m128i v) {
 
 }
 
-void Transform_4way(unsigned char* out, const unsigned char* in)
+/** Compute 4 SHA256 hashes of 64-byte blobs at once, the results are hashed once more if fDouble is set. */
+template <bool fDouble>
+static inline void __attribute__((always_inline)) Transform64_4way(unsigned char* out, const unsigned char* in)
 {
     // Transform 1
     __m128i a = K(0x6a09e667ul);
@@ -229,6 +231,18 @@ void Transform_4way(unsigned char* out, const unsigned char* in)
     w6 = Add(t6, g);
     w7 = Add(t7, h);
 
+    if constexpr (!fDouble) {
+        Write4(out, 0, w0);
+        Write4(out, 4, w1);
+        Write4(out, 8, w2);
+        Write4(out, 12, w3);
+        Write4(out, 16, w4);
+        Write4(out, 20, w5);
+        Write4(out, 24, w6);
+        Write4(out, 28, w7);
+        return;
+    }
+
     // Transform 3
     a = K(0x6a09e667ul);
     b = K(0xbb67ae85ul);
@@ -315,6 +329,16 @@ void Transform_4way(unsigned char* out, const unsigned char* in)
     Write4(out, 28, Add(h, K(0x5be0cd19ul)));
 }
 
+void Transform_4way(unsigned char* out, const unsigned char* in)
+{
+    Transform64_4way<true>(out, in);
+}
+
+void Transform_4way_single(unsigned char* out, const unsigned char* in)
+{
+    Transform64_4way<false>(out, in);
+}
+
 }
 
 #endif
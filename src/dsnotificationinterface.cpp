@@ -51,6 +51,10 @@ void CDSNotificationInterface::SynchronousUpdatedBlockTip(const CBlockIndex *pin
         return;
 
     dmnman->UpdatedBlockTip(pindexNew);
+
+    if (!fInitialDownload && pindexNew->pprev != nullptr) {
+        llmq_ctx->qman->StartQuorumMembersPrecomputeThreads(pindexNew);
+    }
 }
 
 void CDSNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
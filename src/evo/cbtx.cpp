@@ -107,7 +107,6 @@ bool CalcCbTxMerkleRootMNList(const CBlock& block, const CBlockIndex* pindexPrev
 
     try {
         static int64_t nTimeDMN = 0;
-        static int64_t nTimeSMNL = 0;
         static int64_t nTimeMerkle = 0;
 
         int64_t nTime1 = GetTimeMicros();
@@ -121,32 +120,42 @@ bool CalcCbTxMerkleRootMNList(const CBlock& block, const CBlockIndex* pindexPrev
         int64_t nTime2 = GetTimeMicros(); nTimeDMN += nTime2 - nTime1;
         LogPrint(BCLog::BENCHMARK, "            - BuildNewListFromBlock: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeDMN * 0.000001);
 
-        CSimplifiedMNList sml(tmpMNList);
-
-        int64_t nTime3 = GetTimeMicros(); nTimeSMNL += nTime3 - nTime2;
-        LogPrint(BCLog::BENCHMARK, "            - CSimplifiedMNList: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeSMNL * 0.000001);
-
-        static CSimplifiedMNList smlCached;
-        static uint256 merkleRootCached;
-        static bool mutatedCached{false};
-
-        if (sml == smlCached) {
-            merkleRootRet = merkleRootCached;
-            if (mutatedCached) {
-                return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "mutated-cached-calc-cb-mnmerkleroot");
+        // The merkle tree is kept between calls and updated with the diff between the list it was last updated for and
+        // the new list, so only changed entries need to be hashed again. The diff is complete between any two lists, so
+        // this also works when the new list is not based on the cached one (reorgs, block templates)
+        static CDeterministicMNList mnListCached;
+        static CSimplifiedMNListMerkleTree merkleTreeCached;
+        static bool merkleTreeCachedValid{false};
+
+        const auto setEntry = [&](const CDeterministicMN& dmn) {
+            merkleTreeCached.Set(dmn.proTxHash, CSimplifiedMNListEntry(dmn).CalcHash());
+        };
+
+        if (!merkleTreeCachedValid) {
+            merkleTreeCached.Clear();
+            tmpMNList.ForEachMN(false, setEntry);
+        } else {
+            // invalidated until the update is complete, in case it throws
+            merkleTreeCachedValid = false;
+            const auto diff = mnListCached.BuildDiff(tmpMNList);
+            for (const auto& internalId : diff.removedMns) {
+                merkleTreeCached.Remove(mnListCached.GetMNByInternalId(internalId)->proTxHash);
+            }
+            for (const auto& dmn : diff.addedMNs) {
+                setEntry(*dmn);
+            }
+            for (const auto& [internalId, _] : diff.updatedMNs) {
+                setEntry(*tmpMNList.GetMNByInternalId(internalId));
             }
-            return true;
         }
+        mnListCached = tmpMNList;
 
         bool mutated = false;
-        merkleRootRet = sml.CalcMerkleRoot(&mutated);
-
-        int64_t nTime4 = GetTimeMicros(); nTimeMerkle += nTime4 - nTime3;
-        LogPrint(BCLog::BENCHMARK, "            - CalcMerkleRoot: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeMerkle * 0.000001);
+        merkleRootRet = merkleTreeCached.GetRoot(&mutated);
+        merkleTreeCachedValid = true;
 
-        smlCached = std::move(sml);
-        merkleRootCached = merkleRootRet;
-        mutatedCached = mutated;
+        int64_t nTime3 = GetTimeMicros(); nTimeMerkle += nTime3 - nTime2;
+        LogPrint(BCLog::BENCHMARK, "            - UpdateMerkleTree: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeMerkle * 0.000001);
 
         if (mutated) {
             return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "mutated-calc-cb-mnmerkleroot");
@@ -12,21 +12,54 @@
 #include <llmq/utils.h>
 
 #include <base58.h>
+#include <bls/bls_batchverifier.h>
 #include <chainparams.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <crypto/sha256.h>
 #include <script/standard.h>
 #include <ui_interface.h>
 #include <validation.h>
 #include <validationinterface.h>
 #include <univalue.h>
+#include <memusage.h>
 #include <messagesigner.h>
+#include <random.h>
+#include <statsd_client.h>
 #include <uint256.h>
 
 #include <memory>
+#include <optional>
+#include <unordered_set>
 
 static const std::string DB_LIST_SNAPSHOT = "dmn_S3";
+static const std::string DB_LIST_SHARED_SNAPSHOT = "dmn_S4";
+static const std::string DB_LIST_ENTRY = "dmn_E4";
 static const std::string DB_LIST_DIFF = "dmn_D3";
+// Format of DB_LIST_SHARED_SNAPSHOT and DB_LIST_ENTRY records, written together with every shared snapshot. Bump
+// LIST_SHARED_SNAPSHOT_FORMAT whenever either of them changes, versions which don't know the stored format refuse to
+// start. Versions before the shared snapshots ignore these records and rebuild lists from DB_LIST_DIFF records since
+// the last DB_LIST_SNAPSHOT instead, which is correct but slow, see doc/release-notes-evodb-snapshots.md.
+static const std::string DB_LIST_SNAPSHOT_FORMAT = "dmn_SF";
+static constexpr uint8_t LIST_SHARED_SNAPSHOT_FORMAT{1};
+
+/**
+ * Masternode list snapshot which references its masternodes by the hash of their serialized form. The masternodes
+ * themselves are stored once per content hash under DB_LIST_ENTRY, so unchanged entries are shared between snapshots.
+ */
+class CDeterministicMNListSharedSnapshot
+{
+public:
+    uint256 blockHash;
+    int nHeight{-1};
+    uint32_t nTotalRegisteredCount{0};
+    std::vector<uint256> entryHashes;
+
+    SERIALIZE_METHODS(CDeterministicMNListSharedSnapshot, obj)
+    {
+        READWRITE(obj.blockHash, obj.nHeight, obj.nTotalRegisteredCount, obj.entryHashes);
+    }
+};
 
 std::unique_ptr<CDeterministicMNManager> deterministicMNManager;
 
@@ -177,26 +210,110 @@ static bool CompareByLastPaid(const CDeterministicMN* _a, const CDeterministicMN
     return CompareByLastPaid(*_a, *_b);
 }
 
+CDeterministicMNListFlatView::CDeterministicMNListFlatView(size_t nCapacity)
+{
+    dmns.reserve(nCapacity);
+    proTxHashes.reserve(nCapacity);
+    types.reserve(nCapacity);
+    valid.reserve(nCapacity);
+    lastPaidHeights.reserve(nCapacity);
+    paymentOrderHeights.reserve(nCapacity);
+    confirmed.reserve(nCapacity);
+    confirmedHashesWithProRegTxHash.reserve(nCapacity);
+}
+
+void CDeterministicMNListFlatView::Add(const CDeterministicMNCPtr& dmn)
+{
+    const bool fValid = CDeterministicMNList::IsMNValid(*dmn);
+    const bool fHPMN = dmn->nType == MnType::HighPerformance;
+
+    dmns.emplace_back(dmn);
+    proTxHashes.emplace_back(dmn->proTxHash);
+    types.emplace_back(dmn->nType);
+    valid.emplace_back(fValid);
+    lastPaidHeights.emplace_back(dmn->pdmnState->nLastPaidHeight);
+    paymentOrderHeights.emplace_back(CompareByLastPaid_GetHeight(*dmn));
+    confirmed.emplace_back(!dmn->pdmnState->confirmedHash.IsNull());
+    confirmedHashesWithProRegTxHash.emplace_back(dmn->pdmnState->confirmedHashWithProRegTxHash);
+
+    if (fHPMN) ++nHPMNCount;
+    if (fValid) {
+        ++nValidCount;
+        nValidWeightedCount += GetMnType(dmn->nType).voting_weight;
+        if (fHPMN) ++nValidHPMNCount;
+    }
+}
+
+size_t CDeterministicMNListFlatView::GetMemoryUsage() const
+{
+    return GetMemoryUsage(dmns.capacity());
+}
+
+size_t CDeterministicMNListFlatView::GetMemoryUsage(size_t nCapacity)
+{
+    return sizeof(CDeterministicMNListFlatView) + nCapacity * (sizeof(CDeterministicMNCPtr) + 2 * sizeof(uint256) +
+           sizeof(MnType) + 2 * sizeof(uint8_t) + 2 * sizeof(int));
+}
+
+std::shared_ptr<const CDeterministicMNListFlatView> CDeterministicMNList::GetFlatView() const
+{
+    LOCK(flatViewHolder->cs);
+    if (flatViewHolder->view == nullptr) {
+        auto view = std::make_shared<CDeterministicMNListFlatView>(mnMap.size());
+        for (const auto& p : mnMap) {
+            view->Add(p.second);
+        }
+        flatViewHolder->view = std::move(view);
+    }
+    return flatViewHolder->view;
+}
+
+std::shared_ptr<const CDeterministicMNListFlatView> CDeterministicMNList::GetFlatViewIfBuilt() const
+{
+    LOCK(flatViewHolder->cs);
+    return flatViewHolder->view;
+}
+
+size_t CDeterministicMNList::GetFlatViewMemoryUsage() const
+{
+    LOCK(flatViewHolder->cs);
+    return flatViewHolder->view != nullptr ? flatViewHolder->view->GetMemoryUsage() : 0;
+}
+
+void CDeterministicMNList::InvalidateFlatView()
+{
+    if (flatViewHolder.use_count() == 1) {
+        LOCK(flatViewHolder->cs);
+        flatViewHolder->view = nullptr;
+    } else {
+        // other copies of this list still use the current view
+        flatViewHolder = std::make_shared<FlatViewHolder>();
+    }
+}
+
 CDeterministicMNCPtr CDeterministicMNList::GetMNPayee(const CBlockIndex* pIndex) const
 {
     if (mnMap.size() == 0) {
         return nullptr;
     }
 
+    const auto view = GetFlatView();
+
     bool isv19Active = llmq::utils::IsV19Active(pIndex);
     // Starting from v19 and until v20 (Platform release), HPMN will be rewarded 4 blocks in a row
     // TODO: Skip this code once v20 is active
     CDeterministicMNCPtr best = nullptr;
     if (isv19Active) {
-        ForEachMNShared(true, [&](const CDeterministicMNCPtr& dmn) {
-            if (dmn->pdmnState->nLastPaidHeight == nHeight) {
+        for (size_t i = 0; i < view->size(); i++) {
+            if (view->valid[i] && view->lastPaidHeights[i] == nHeight) {
                 // We found the last MN Payee.
                 // If the last payee is a HPMN, we need to check its consecutive payments and pay him again if needed
-                if (dmn->nType == MnType::HighPerformance && dmn->pdmnState->nConsecutivePayments < dmn_types::HighPerformance.voting_weight) {
+                const auto& dmn = view->dmns[i];
+                if (view->types[i] == MnType::HighPerformance && dmn->pdmnState->nConsecutivePayments < dmn_types::HighPerformance.voting_weight) {
                     best = dmn;
                 }
             }
-        });
+        }
 
         if (best != nullptr) return best;
 
@@ -204,13 +321,17 @@ CDeterministicMNCPtr CDeterministicMNList::GetMNPayee(const CBlockIndex* pIndex)
         // We can proceed with classic MN payee selection
     }
 
-    ForEachMNShared(true, [&](const CDeterministicMNCPtr& dmn) {
-        if (best == nullptr || CompareByLastPaid(dmn.get(), best.get())) {
-            best = dmn;
+    // same order as CompareByLastPaid, but without touching the masternode objects
+    std::optional<size_t> bestIdx;
+    for (size_t i = 0; i < view->size(); i++) {
+        if (!view->valid[i]) continue;
+        if (!bestIdx || view->paymentOrderHeights[i] < view->paymentOrderHeights[*bestIdx] ||
+            (view->paymentOrderHeights[i] == view->paymentOrderHeights[*bestIdx] && view->proTxHashes[i] < view->proTxHashes[*bestIdx])) {
+            bestIdx = i;
         }
-    });
+    }
 
-    return best;
+    return bestIdx ? view->dmns[*bestIdx] : nullptr;
 }
 
 std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(int nCount) const
@@ -268,17 +389,24 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t m
     auto scores = CalculateScores(modifier, onlyHighPerformanceMasternodes);
 
     // sort is descending order
-    std::sort(scores.rbegin(), scores.rend(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, const std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
+    const auto cmp = [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, const std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
         if (a.first == b.first) {
             // this should actually never happen, but we should stay compatible with how the non-deterministic MNs did the sorting
-            return a.second->collateralOutpoint < b.second->collateralOutpoint;
+            return b.second->collateralOutpoint < a.second->collateralOutpoint;
         }
-        return a.first < b.first;
-    });
+        return b.first < a.first;
+    };
+
+    // only the top maxSize entries need to be in order, the rest is dropped anyway
+    const auto itEnd = scores.begin() + std::min(maxSize, scores.size());
+    if (itEnd != scores.end()) {
+        std::nth_element(scores.begin(), itEnd, scores.end(), cmp);
+    }
+    std::sort(scores.begin(), itEnd, cmp);
 
     // take top maxSize entries and return it
     std::vector<CDeterministicMNCPtr> result;
-    result.resize(std::min(maxSize, scores.size()));
+    result.resize(itEnd - scores.begin());
     for (size_t i = 0; i < result.size(); i++) {
         result[i] = std::move(scores[i].second);
     }
@@ -287,30 +415,43 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t m
 
 std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CDeterministicMNList::CalculateScores(const uint256& modifier, const bool onlyHighPerformanceMasternodes) const
 {
-    std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> scores;
-    scores.reserve(GetAllMNsCount());
-    ForEachMNShared(true, [&](const CDeterministicMNCPtr& dmn) {
-        if (dmn->pdmnState->confirmedHash.IsNull()) {
+    const auto view = GetFlatView();
+
+    std::vector<CDeterministicMNCPtr> dmns;
+    // pairs of (confirmedHashWithProRegTxHash, modifier), one 64-byte blob per MN
+    std::vector<uint256> blobs;
+    dmns.reserve(view->nValidCount);
+    blobs.reserve(view->nValidCount * 2);
+    for (size_t i = 0; i < view->size(); i++) {
+        if (!view->valid[i]) continue;
+        if (!view->confirmed[i]) {
             // we only take confirmed MNs into account to avoid hash grinding on the ProRegTxHash to sneak MNs into a
             // future quorums
-            return;
+            continue;
         }
         if (onlyHighPerformanceMasternodes) {
-            if (dmn->nType != MnType::HighPerformance)
-                return;
-        }
-        // calculate sha256(sha256(proTxHash, confirmedHash), modifier) per MN
-        // Please note that this is not a double-sha256 but a single-sha256
-        // The first part is already precalculated (confirmedHashWithProRegTxHash)
-        // TODO When https://github.com/bitcoin/bitcoin/pull/13191 gets backported, implement something that is similar but for single-sha256
-        uint256 h;
-        CSHA256 sha256;
-        sha256.Write(dmn->pdmnState->confirmedHashWithProRegTxHash.begin(), dmn->pdmnState->confirmedHashWithProRegTxHash.size());
-        sha256.Write(modifier.begin(), modifier.size());
-        sha256.Finalize(h.begin());
-
-        scores.emplace_back(UintToArith256(h), dmn);
-    });
+            if (view->types[i] != MnType::HighPerformance)
+                continue;
+        }
+        dmns.emplace_back(view->dmns[i]);
+        blobs.emplace_back(view->confirmedHashesWithProRegTxHash[i]);
+        blobs.emplace_back(modifier);
+    }
+
+    // calculate sha256(sha256(proTxHash, confirmedHash), modifier) per MN
+    // Please note that this is not a double-sha256 but a single-sha256
+    // The first part is already precalculated (confirmedHashWithProRegTxHash)
+    // All blobs are hashed in one go so that the multi-way SHA256 implementations can be used
+    std::vector<uint256> hashes(dmns.size());
+    if (!dmns.empty()) {
+        SHA256S64(hashes[0].begin(), blobs[0].begin(), dmns.size());
+    }
+
+    std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> scores;
+    scores.reserve(dmns.size());
+    for (size_t i = 0; i < dmns.size(); i++) {
+        scores.emplace_back(UintToArith256(hashes[i]), std::move(dmns[i]));
+    }
 
     return scores;
 }
@@ -458,6 +599,46 @@ CDeterministicMNList CDeterministicMNList::ApplyDiff(const CBlockIndex* pindex,
     return result;
 }
 
+size_t CDeterministicMNList::SetMNsFromBase(const CDeterministicMNList& base, const std::vector<CDeterministicMNCPtr>& dmns)
+{
+    mnMap = base.mnMap;
+    mnInternalIdMap = base.mnInternalIdMap;
+    mnUniquePropertyMap = base.mnUniquePropertyMap;
+    nValidCount = base.nValidCount;
+    nValidWeightedCount = base.nValidWeightedCount;
+    nHPMNCount = base.nHPMNCount;
+    nValidHPMNCount = base.nValidHPMNCount;
+    // stays shared with the base list if nothing needs to be changed below
+    flatViewHolder = base.flatViewHolder;
+
+    std::unordered_set<uint256, StaticSaltedHasher> unchanged;
+    std::vector<CDeterministicMNCPtr> toAdd;
+    for (const auto& dmn : dmns) {
+        auto p = mnMap.find(dmn->proTxHash);
+        // lists built from diffs hold their own copies of masternodes, so equal entries are not always the same object
+        if (p != nullptr && (*p == dmn || ::SerializeHash(**p) == ::SerializeHash(*dmn))) {
+            unchanged.emplace(dmn->proTxHash);
+        } else {
+            toAdd.emplace_back(dmn);
+        }
+    }
+    std::vector<uint256> toRemove;
+    for (const auto& p : mnMap) {
+        if (unchanged.count(p.first) == 0) {
+            toRemove.emplace_back(p.first);
+        }
+    }
+
+    // remove first, added entries might take over unique properties of removed ones
+    for (const auto& proTxHash : toRemove) {
+        RemoveMN(proTxHash);
+    }
+    for (const auto& dmn : toAdd) {
+        AddMN(dmn, false);
+    }
+    return toRemove.size() + toAdd.size();
+}
+
 void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn, bool fBumpTotalCount)
 {
     assert(dmn != nullptr);
@@ -504,6 +685,8 @@ void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn, bool fBumpTota
 
     mnMap = mnMap.set(dmn->proTxHash, dmn);
     mnInternalIdMap = mnInternalIdMap.set(dmn->GetInternalId(), dmn->proTxHash);
+    UpdateCounts(*dmn, true);
+    InvalidateFlatView();
     if (fBumpTotalCount) {
         // nTotalRegisteredCount acts more like a checkpoint, not as a limit,
         nTotalRegisteredCount = std::max(dmn->GetInternalId() + 1, (uint64_t)nTotalRegisteredCount);
@@ -542,8 +725,12 @@ void CDeterministicMNList::UpdateMN(const CDeterministicMN& oldDmn, const std::s
         }
     }
 
+    // oldDmn might be owned by mnMap, so it must not be used after replacing it there
+    UpdateCounts(oldDmn, false);
     dmn->pdmnState = pdmnState;
     mnMap = mnMap.set(oldDmn.proTxHash, dmn);
+    UpdateCounts(*dmn, true);
+    InvalidateFlatView();
 }
 
 void CDeterministicMNList::UpdateMN(const uint256& proTxHash, const std::shared_ptr<const CDeterministicMNState>& pdmnState)
@@ -605,6 +792,62 @@ void CDeterministicMNList::RemoveMN(const uint256& proTxHash)
 
     mnMap = mnMap.erase(proTxHash);
     mnInternalIdMap = mnInternalIdMap.erase(dmn->GetInternalId());
+    UpdateCounts(*dmn, false);
+    InvalidateFlatView();
+}
+
+void CDeterministicMNList::UpdateCounts(const CDeterministicMN& dmn, bool fAdd)
+{
+    const auto update = [fAdd](size_t& nCount, size_t nAmount) {
+        if (fAdd) {
+            nCount += nAmount;
+        } else {
+            assert(nCount >= nAmount);
+            nCount -= nAmount;
+        }
+    };
+    const bool fHPMN = dmn.nType == MnType::HighPerformance;
+    if (fHPMN) update(nHPMNCount, 1);
+    if (IsMNValid(dmn)) {
+        update(nValidCount, 1);
+        update(nValidWeightedCount, GetMnType(dmn.nType).voting_weight);
+        if (fHPMN) update(nValidHPMNCount, 1);
+    }
+}
+
+// Memory owned by a single masternode entry, the CDeterministicMN and its state are both held by shared_ptrs
+static size_t GetMNEntryUsage()
+{
+    return memusage::MallocUsage(sizeof(CDeterministicMN)) + memusage::MallocUsage(sizeof(CDeterministicMNState)) +
+           2 * memusage::MallocUsage(sizeof(memusage::stl_shared_counter));
+}
+
+// immer::map is a hash trie with 2^immer::default_bits children per node. Changing a single entry copies every node on
+// the path to it, the upper ones are full while the last one holds the remaining values inline.
+static size_t GetImmerPathCopyUsage(size_t nCount, size_t nValueSize)
+{
+    constexpr size_t BRANCHES = size_t{1} << immer::default_bits;
+    size_t nUsage{0};
+    for (; nCount > BRANCHES; nCount /= BRANCHES) {
+        nUsage += memusage::MallocUsage(BRANCHES * sizeof(void*));
+    }
+    return nUsage + memusage::MallocUsage(std::max<size_t>(nCount, 1) * nValueSize);
+}
+
+// Memory charged to a cached list. Only the nChanged masternodes which are not shared with the list it was derived from
+// are charged, together with the copied paths of mnMap (the other maps only change on registrations and removals). The
+// flat view is charged in full, it's built for most lists which are used more than once.
+static size_t GetListCacheUsage(const CDeterministicMNList& mnList, size_t nChanged)
+{
+    const size_t nCount = mnList.GetAllMNsCount();
+    return sizeof(CDeterministicMNList) + CDeterministicMNListFlatView::GetMemoryUsage(nCount) +
+           std::min(nChanged, nCount) * (GetMNEntryUsage() + GetImmerPathCopyUsage(nCount, sizeof(std::pair<uint256, CDeterministicMNCPtr>)));
+}
+
+static size_t GetDiffCacheUsage(const CDeterministicMNListDiff& diff)
+{
+    return sizeof(CDeterministicMNListDiff) + memusage::DynamicUsage(diff.addedMNs) + diff.addedMNs.size() * GetMNEntryUsage() +
+           memusage::DynamicUsage(diff.updatedMNs) + memusage::DynamicUsage(diff.removedMns);
 }
 
 bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& _state, const CCoinsViewCache& view, bool fJustCheck)
@@ -644,15 +887,20 @@ bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockInde
         diff = oldList.BuildDiff(newList);
 
         m_evoDb.Write(std::make_pair(DB_LIST_DIFF, newList.GetBlockHash()), diff);
-        if ((nHeight % DISK_SNAPSHOT_PERIOD) == 0 || oldList.GetHeight() == -1) {
-            m_evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, newList.GetBlockHash()), newList);
-            mnListsCache.emplace(newList.GetBlockHash(), newList);
-            LogPrintf("CDeterministicMNManager::%s -- Wrote snapshot. nHeight=%d, mapCurMNs.allMNsCount=%d\n",
-                __func__, nHeight, newList.GetAllMNsCount());
+        int nReplayCost = GetReplayCostSinceSnapshot(pindex->pprev) + diff.GetReplayCost();
+        if ((nHeight % DISK_SNAPSHOT_PERIOD) == 0 || oldList.GetHeight() == -1 || nReplayCost > DISK_SNAPSHOT_MAX_REPLAY_COST) {
+            WriteListSnapshot(newList, FindPrevListSnapshot(pindex->pprev));
+            AddToCache(mnListsCache, newList.GetBlockHash(), newList, 1 + newList.GetAllMNsCount(),
+                       GetListCacheUsage(newList, diff.GetReplayCost() - 1));
+            LogPrintf("CDeterministicMNManager::%s -- Wrote snapshot. nHeight=%d, mapCurMNs.allMNsCount=%d, nReplayCost=%d\n",
+                __func__, nHeight, newList.GetAllMNsCount(), nReplayCost);
+            nReplayCost = 0;
         }
+        mnListReplayCostCache[newList.GetBlockHash()] = std::make_pair(nHeight, nReplayCost);
 
         diff.nHeight = pindex->nHeight;
-        mnListDiffsCache.emplace(pindex->GetBlockHash(), diff);
+        AddToCache(mnListDiffsCache, pindex->GetBlockHash(), diff, 1, GetDiffCacheUsage(diff));
+        EnforceCacheBudget();
     } catch (const std::exception& e) {
         LogPrintf("CDeterministicMNManager::%s -- internal error: %s\n", __func__, e.what());
         return _state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "failed-dmn-block");
@@ -695,8 +943,9 @@ bool CDeterministicMNManager::UndoBlock(const CBlock& block, const CBlockIndex*
             prevList = GetListForBlock(pindex->pprev);
         }
 
-        mnListsCache.erase(blockHash);
-        mnListDiffsCache.erase(blockHash);
+        EraseFromCache(mnListsCache, blockHash);
+        EraseFromCache(mnListDiffsCache, blockHash);
+        mnListReplayCostCache.erase(blockHash);
     }
 
     if (diff.HasChanges()) {
@@ -1052,24 +1301,32 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
     LOCK(cs);
 
     CDeterministicMNList snapshot;
+    int nCost{0};
+    size_t nChanged{0};
     std::list<const CBlockIndex*> listDiffIndexes;
 
     while (true) {
         // try using cache before reading from disk
         auto itLists = mnListsCache.find(pindex->GetBlockHash());
         if (itLists != mnListsCache.end()) {
-            snapshot = itLists->second;
+            itLists->second.nInflation = cacheInflation;
+            snapshot = itLists->second.value;
+            nCost = itLists->second.nCost;
             break;
         }
 
-        if (m_evoDb.Read(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()), snapshot)) {
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
+        if (ReadListSnapshot(pindex->GetBlockHash(), snapshot, nChanged)) {
+            nCost = 1 + snapshot.GetAllMNsCount();
+            AddToCache(mnListsCache, pindex->GetBlockHash(), snapshot, nCost, GetListCacheUsage(snapshot, nChanged));
+            nChanged = 0;
             break;
         }
 
         // no snapshot found yet, check diffs
         auto itDiffs = mnListDiffsCache.find(pindex->GetBlockHash());
         if (itDiffs != mnListDiffsCache.end()) {
+            itDiffs->second.nInflation = cacheInflation;
+            ++nCacheDiffHits;
             listDiffIndexes.emplace_front(pindex);
             pindex = pindex->pprev;
             continue;
@@ -1079,41 +1336,41 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
         if (!m_evoDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), diff)) {
             // no snapshot and no diff on disk means that it's the initial snapshot
             snapshot = CDeterministicMNList(pindex->GetBlockHash(), -1, 0);
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
+            AddToCache(mnListsCache, pindex->GetBlockHash(), snapshot, 1, GetListCacheUsage(snapshot, 0));
             break;
         }
 
+        ++nCacheDiffMisses;
         diff.nHeight = pindex->nHeight;
-        mnListDiffsCache.emplace(pindex->GetBlockHash(), std::move(diff));
+        const size_t nDiffSize = GetDiffCacheUsage(diff);
+        AddToCache(mnListDiffsCache, pindex->GetBlockHash(), std::move(diff), 1, nDiffSize);
         listDiffIndexes.emplace_front(pindex);
         pindex = pindex->pprev;
     }
 
+    if (listDiffIndexes.empty()) {
+        ++nCacheListHits;
+        EnforceCacheBudget();
+        return snapshot;
+    }
+    ++nCacheListMisses;
+
     for (const auto& diffIndex : listDiffIndexes) {
-        const auto& diff = mnListDiffsCache.at(diffIndex->GetBlockHash());
+        const auto& diff = mnListDiffsCache.at(diffIndex->GetBlockHash()).value;
         if (diff.HasChanges()) {
             snapshot = snapshot.ApplyDiff(diffIndex, diff);
         } else {
             snapshot.SetBlockHash(diffIndex->GetBlockHash());
             snapshot.SetHeight(diffIndex->nHeight);
         }
+        nCost += diff.GetReplayCost();
+        nChanged += diff.GetReplayCost() - 1;
     }
 
-    if (tipIndex) {
-        // always keep a snapshot for the tip
-        if (snapshot.GetBlockHash() == tipIndex->GetBlockHash()) {
-            mnListsCache.emplace(snapshot.GetBlockHash(), snapshot);
-        } else {
-            // keep snapshots for yet alive quorums
-            if (ranges::any_of(Params().GetConsensus().llmqs, [&snapshot, this](const auto& params){
-                LOCK(cs);
-                return (snapshot.GetHeight() % params.dkgInterval == 0) &&
-                (snapshot.GetHeight() + params.dkgInterval * (params.keepOldConnections + 1) >= tipIndex->nHeight);
-            })) {
-                mnListsCache.emplace(snapshot.GetBlockHash(), snapshot);
-            }
-        }
-    }
+    // Rebuilt lists are cached as well. The budget is only enforced now that the diffs of this walk are not needed
+    // anymore, lists which are cheap to rebuild or not used anymore are evicted first.
+    AddToCache(mnListsCache, snapshot.GetBlockHash(), snapshot, nCost, GetListCacheUsage(snapshot, nChanged));
+    EnforceCacheBudget();
 
     return snapshot;
 }
@@ -1167,45 +1424,257 @@ bool CDeterministicMNManager::IsDIP3Enforced(int nHeight)
     return nHeight >= Params().GetConsensus().DIP0003EnforcementHeight;
 }
 
+bool CDeterministicMNManager::IsPinnedInCache(const CDeterministicMNList& mnList, int nHeight) const
+{
+    AssertLockHeld(cs);
+
+    if (tipIndex != nullptr && mnList.GetBlockHash() == tipIndex->GetBlockHash()) {
+        // it's a snapshot for the tip, keep it
+        return true;
+    }
+    // keep snapshots for yet alive quorums
+    return ranges::any_of(Params().GetConsensus().llmqs, [&nHeight, &mnList](const auto& params){
+        return (mnList.GetHeight() % params.dkgInterval == 0) &&
+               (mnList.GetHeight() + params.dkgInterval * (params.keepOldConnections + 1) >= nHeight);
+    });
+}
+
+size_t SelectMNListCacheEvictions(std::vector<CMNListCacheEvictionCandidate>& candidates, size_t nUsage, size_t nMaxBytes)
+{
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+        return a.nPriority < b.nPriority;
+    });
+    size_t nCount{0};
+    for (; nCount < candidates.size() && nUsage > nMaxBytes; ++nCount) {
+        nUsage -= std::min(nUsage, candidates[nCount].nSize);
+    }
+    return nCount;
+}
+
 void CDeterministicMNManager::CleanupCache(int nHeight)
 {
     AssertLockHeld(cs);
 
+    // Lists and diffs which are too old to be of use for any quorum are always dropped. Younger lists are kept as long
+    // as the cache stays within its memory budget, even if they are neither the tip nor used by an active quorum.
     std::vector<uint256> toDeleteLists;
     std::vector<uint256> toDeleteDiffs;
     for (const auto& p : mnListsCache) {
-        if (p.second.GetHeight() + LIST_DIFFS_CACHE_SIZE < nHeight) {
-            // too old, drop it
+        if (p.second.value.GetHeight() + LIST_DIFFS_CACHE_SIZE < nHeight) {
             toDeleteLists.emplace_back(p.first);
-            continue;
         }
-        if (tipIndex != nullptr && p.first == tipIndex->GetBlockHash()) {
-            // it's a snapshot for the tip, keep it
-            continue;
+    }
+    for (const auto& p : mnListDiffsCache) {
+        if (p.second.value.nHeight + LIST_DIFFS_CACHE_SIZE < nHeight) {
+            toDeleteDiffs.emplace_back(p.first);
+        }
+    }
+    for (const auto& h : toDeleteLists) {
+        EraseFromCache(mnListsCache, h);
+    }
+    for (const auto& h : toDeleteDiffs) {
+        EraseFromCache(mnListDiffsCache, h);
+    }
+
+    EvictFromCache(nHeight, nCacheMaxBytes);
+
+    for (auto it = mnListReplayCostCache.begin(); it != mnListReplayCostCache.end(); ) {
+        if (it->second.first + LIST_DIFFS_CACHE_SIZE < nHeight) {
+            it = mnListReplayCostCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CDeterministicMNManager::EvictFromCache(int nHeight, size_t nMaxBytes)
+{
+    AssertLockHeld(cs);
+
+    const size_t nUsage = GetCacheMemoryUsageInternal();
+    if (nUsage <= nMaxBytes) {
+        return;
+    }
+    // GreedyDual-Size: evict the entries with the lowest rebuild cost per byte first, entries which were
+    // accessed recently got a higher inflation value and are kept longer
+    std::vector<CMNListCacheEvictionCandidate> candidates;
+    candidates.reserve(mnListsCache.size() + mnListDiffsCache.size());
+    for (const auto& [blockHash, entry] : mnListsCache) {
+        if (!IsPinnedInCache(entry.value, nHeight)) {
+            candidates.push_back({entry.nInflation + double(entry.nCost) / entry.nSize, entry.nSize, blockHash, true});
+        }
+    }
+    for (const auto& [blockHash, entry] : mnListDiffsCache) {
+        candidates.push_back({entry.nInflation + double(entry.nCost) / entry.nSize, entry.nSize, blockHash, false});
+    }
+    const size_t nEvict = SelectMNListCacheEvictions(candidates, nUsage, nMaxBytes);
+    for (size_t i = 0; i < nEvict; ++i) {
+        if (candidates[i].fIsList) {
+            EraseFromCache(mnListsCache, candidates[i].blockHash);
+        } else {
+            EraseFromCache(mnListDiffsCache, candidates[i].blockHash);
+        }
+        cacheInflation = std::max(cacheInflation, candidates[i].nPriority);
+        ++nCacheEvictions;
+    }
+}
+
+void CDeterministicMNManager::EnforceCacheBudget()
+{
+    AssertLockHeld(cs);
+
+    if (GetCacheMemoryUsageInternal() <= nCacheMaxBytes) {
+        return;
+    }
+    // Make some room below the budget, so that a burst of lookups for historical blocks doesn't have to sort all
+    // cache entries again for every single list it adds
+    EvictFromCache(tipIndex ? tipIndex->nHeight : 0, nCacheMaxBytes / 10 * 9);
+}
+
+int CDeterministicMNManager::GetReplayCostSinceSnapshot(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs);
+
+    // Walk back until we find a block with a known cost or a disk snapshot. This only happens after
+    // a restart or a reorg, usually the cost for the previous block was recorded in ProcessBlock already.
+    std::vector<std::pair<const CBlockIndex*, int>> diffCosts;
+    int nReplayCost{0};
+    for (; pindex != nullptr; pindex = pindex->pprev) {
+        auto itCost = mnListReplayCostCache.find(pindex->GetBlockHash());
+        if (itCost != mnListReplayCostCache.end()) {
+            nReplayCost = itCost->second.second;
+            break;
         }
-        bool fQuorumCache = ranges::any_of(Params().GetConsensus().llmqs, [&nHeight, &p](const auto& params){
-            return (p.second.GetHeight() % params.dkgInterval == 0) &&
-                   (p.second.GetHeight() + params.dkgInterval * (params.keepOldConnections + 1) >= nHeight);
-        });
-        if (fQuorumCache) {
-            // at least one quorum could be using it, keep it
+        if (HasListSnapshot(pindex->GetBlockHash())) {
+            mnListReplayCostCache.emplace(pindex->GetBlockHash(), std::make_pair(pindex->nHeight, 0));
+            break;
+        }
+        auto itDiffs = mnListDiffsCache.find(pindex->GetBlockHash());
+        if (itDiffs != mnListDiffsCache.end()) {
+            diffCosts.emplace_back(pindex, itDiffs->second.value.GetReplayCost());
             continue;
         }
-        // none of the above, drop it
-        toDeleteLists.emplace_back(p.first);
+        CDeterministicMNListDiff diff;
+        if (!m_evoDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), diff)) {
+            // no snapshot and no diff on disk means that it's the initial snapshot
+            break;
+        }
+        diffCosts.emplace_back(pindex, diff.GetReplayCost());
     }
-    for (const auto& h : toDeleteLists) {
-        mnListsCache.erase(h);
+
+    for (auto it = diffCosts.rbegin(); it != diffCosts.rend(); ++it) {
+        nReplayCost += it->second;
+        mnListReplayCostCache.emplace(it->first->GetBlockHash(), std::make_pair(it->first->nHeight, nReplayCost));
     }
-    for (const auto& p : mnListDiffsCache) {
-        if (p.second.nHeight + LIST_DIFFS_CACHE_SIZE < nHeight) {
-            toDeleteDiffs.emplace_back(p.first);
+    return nReplayCost;
+}
+
+bool CDeterministicMNManager::HasListSnapshot(const uint256& blockHash)
+{
+    return m_evoDb.Exists(std::make_pair(DB_LIST_SHARED_SNAPSHOT, blockHash)) ||
+           m_evoDb.Exists(std::make_pair(DB_LIST_SNAPSHOT, blockHash));
+}
+
+bool CDeterministicMNManager::ReadListSnapshot(const uint256& blockHash, CDeterministicMNList& mnListRet, size_t& nChangedRet)
+{
+    AssertLockHeld(cs);
+
+    CDeterministicMNListSharedSnapshot snapshot;
+    if (!m_evoDb.Read(std::make_pair(DB_LIST_SHARED_SNAPSHOT, blockHash), snapshot)) {
+        // snapshots written before masternode entries were shared between them
+        if (!m_evoDb.Read(std::make_pair(DB_LIST_SNAPSHOT, blockHash), mnListRet)) {
+            return false;
         }
+        nChangedRet = mnListRet.GetAllMNsCount();
+        return true;
     }
-    for (const auto& h : toDeleteDiffs) {
-        mnListDiffsCache.erase(h);
+
+    std::vector<CDeterministicMNCPtr> dmns;
+    dmns.reserve(snapshot.entryHashes.size());
+    for (const auto& entryHash : snapshot.entryHashes) {
+        CDeterministicMNCPtr dmn;
+        if (!mnListEntriesCache.get(entryHash, dmn)) {
+            auto newDmn = std::make_shared<CDeterministicMN>(0);
+            if (!m_evoDb.Read(std::make_pair(DB_LIST_ENTRY, entryHash), *newDmn)) {
+                throw std::runtime_error(strprintf("%s: missing masternode list entry %s for snapshot at block %s", __func__,
+                                                   entryHash.ToString(), blockHash.ToString()));
+            }
+            dmn = newDmn;
+            mnListEntriesCache.insert(entryHash, dmn);
+        }
+        dmns.emplace_back(dmn);
+    }
+
+    // Start from a cached list which most likely shares most masternodes with the snapshot, so that most of the immer
+    // maps can be shared with it. Snapshots are usually read one after another while walking along the chain, so that's
+    // the previously read one or otherwise the tip, whichever is closer.
+    const CDeterministicMNList* pbase{nullptr};
+    for (const auto& baseHash : {lastReadSnapshotHash, tipIndex != nullptr ? tipIndex->GetBlockHash() : uint256()}) {
+        auto it = mnListsCache.find(baseHash);
+        if (it != mnListsCache.end() && (pbase == nullptr ||
+            std::abs(it->second.value.GetHeight() - snapshot.nHeight) < std::abs(pbase->GetHeight() - snapshot.nHeight))) {
+            pbase = &it->second.value;
+        }
+    }
+
+    mnListRet = CDeterministicMNList(snapshot.blockHash, snapshot.nHeight, snapshot.nTotalRegisteredCount);
+    nChangedRet = mnListRet.SetMNsFromBase(pbase != nullptr ? *pbase : CDeterministicMNList(), dmns);
+    lastReadSnapshotHash = blockHash;
+    return true;
+}
+
+uint256 CDeterministicMNManager::FindPrevListSnapshot(const CBlockIndex* pindex)
+{
+    // snapshots are written at least every DISK_SNAPSHOT_PERIOD blocks
+    for (int i = 0; pindex != nullptr && i <= DISK_SNAPSHOT_PERIOD; pindex = pindex->pprev, ++i) {
+        if (m_evoDb.Exists(std::make_pair(DB_LIST_SHARED_SNAPSHOT, pindex->GetBlockHash()))) {
+            return pindex->GetBlockHash();
+        }
     }
+    return uint256();
+}
+
+void CDeterministicMNManager::WriteListSnapshot(const CDeterministicMNList& mnList, const uint256& prevSnapshotHash)
+{
+    AssertLockHeld(cs);
+
+    // Entries referenced by the previous snapshot are known to be on disk, they were written in the same (or an earlier)
+    // DB transaction as that snapshot and entries are never erased. mnListEntriesCache can't be used for this, it keeps
+    // entries from rolled back DB transactions.
+    std::unordered_set<uint256, StaticSaltedHasher> prevEntryHashes;
+    CDeterministicMNListSharedSnapshot prevSnapshot;
+    if (!prevSnapshotHash.IsNull() && m_evoDb.Read(std::make_pair(DB_LIST_SHARED_SNAPSHOT, prevSnapshotHash), prevSnapshot)) {
+        prevEntryHashes.insert(prevSnapshot.entryHashes.begin(), prevSnapshot.entryHashes.end());
+    }
+
+    CDeterministicMNListSharedSnapshot snapshot;
+    snapshot.blockHash = mnList.GetBlockHash();
+    snapshot.nHeight = mnList.GetHeight();
+    snapshot.nTotalRegisteredCount = mnList.GetTotalRegisteredCount();
+    snapshot.entryHashes.reserve(mnList.GetAllMNsCount());
+
+    mnList.ForEachMNShared(false, [&](const CDeterministicMNCPtr& dmn) {
+        const uint256 entryHash = ::SerializeHash(*dmn);
+        if (prevEntryHashes.count(entryHash) == 0) {
+            m_evoDb.Write(std::make_pair(DB_LIST_ENTRY, entryHash), *dmn);
+        }
+        mnListEntriesCache.insert(entryHash, dmn);
+        snapshot.entryHashes.emplace_back(entryHash);
+    });
+
+    m_evoDb.Write(std::make_pair(DB_LIST_SHARED_SNAPSHOT, mnList.GetBlockHash()), snapshot);
+    m_evoDb.Write(DB_LIST_SNAPSHOT_FORMAT, LIST_SHARED_SNAPSHOT_FORMAT);
+}
 
+bool CDeterministicMNManager::IsListSnapshotFormatSupported()
+{
+    uint8_t nFormat{0};
+    if (m_evoDb.Read(DB_LIST_SNAPSHOT_FORMAT, nFormat) && nFormat > LIST_SHARED_SNAPSHOT_FORMAT) {
+        LogPrintf("CDeterministicMNManager::%s -- unknown masternode list snapshot format %d, expected at most %d\n", __func__,
+                  nFormat, LIST_SHARED_SNAPSHOT_FORMAT);
+        return false;
+    }
+    return true;
 }
 
 bool CDeterministicMNManager::MigrateDBIfNeeded()
@@ -1471,36 +1940,92 @@ static bool CheckPlatformFields(const ProTx& proTx, CValidationState& state)
     return true;
 }
 
-template <typename ProTx>
-static bool CheckHashSig(const ProTx& proTx, const PKHash& pkhash, CValidationState& state)
+bool CProTxSigCheck::operator()() const
 {
     std::string strError;
-    if (!CHashSigner::VerifyHash(::SerializeHash(proTx), CKeyID(pkhash), proTx.vchSig, strError)) {
-        return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-sig");
+    switch (sigType) {
+    case SigType::HashECDSA:
+        return CHashSigner::VerifyHash(hash, keyID, vchSig, strError);
+    case SigType::MessageECDSA:
+        return CMessageSigner::VerifyMessage(keyID, vchSig, strMessage, strError);
+    case SigType::HashBLS:
+        return sig.VerifyInsecure(pubKey, hash);
+    case SigType::None:
+        break;
+    }
+    return false;
+}
+
+bool CProTxSigCheck::VerifyBLSBatch(const std::vector<CProTxSigCheck>& checks)
+{
+    if (checks.empty()) {
+        return true;
     }
-    return true;
+    if (checks.size() == 1) {
+        // nothing to gain from batching
+        return checks[0]();
+    }
+
+    // Only the overall result is needed, the failing TX is found by FindInvalidProTxSig. All checks are pushed as a
+    // single source without per message fallback, so an invalid batch is not verified again
+    CBLSBatchVerifier<size_t, size_t> batchVerifier(true, false);
+    std::vector<uint8_t> vecScalar(CBLSSecretKey::SerSize, 0);
+    for (size_t i = 0; i < checks.size(); i++) {
+        const auto& check = checks[i];
+        assert(check.IsBLS());
+        if (!check.sig.IsValid() || !check.pubKey.IsValid()) {
+            return false;
+        }
+
+        // 128 bit random scalars, always smaller than the group order
+        CBLSSecretKey scalar;
+        do {
+            GetRandBytes(vecScalar.data() + vecScalar.size() / 2, vecScalar.size() / 2);
+            scalar.SetByteVector(vecScalar);
+        } while (!scalar.IsValid());
+
+        CBLSSignature sig = check.sig;
+        CBLSPublicKey pubKey = check.pubKey;
+        sig.MulInsecure(scalar);
+        pubKey.MulInsecure(scalar);
+        batchVerifier.PushMessage(0, i, check.hash, sig, pubKey);
+    }
+    batchVerifier.Verify();
+
+    return batchVerifier.badSources.empty();
 }
 
-template <typename ProTx>
-static bool CheckStringSig(const ProTx& proTx, const PKHash& pkhash, CValidationState& state)
+static bool CheckProTxSig(CProTxSigCheck&& check, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks)
 {
-    std::string strError;
-    if (!CMessageSigner::VerifyMessage(CKeyID(pkhash), proTx.vchSig, proTx.MakeSignString(), strError)) {
+    if (pvChecks != nullptr) {
+        pvChecks->emplace_back(std::move(check));
+        return true;
+    }
+    if (!check()) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-sig");
     }
     return true;
 }
 
 template <typename ProTx>
-static bool CheckHashSig(const ProTx& proTx, const CBLSPublicKey& pubKey, CValidationState& state)
+static bool CheckHashSig(const ProTx& proTx, const PKHash& pkhash, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks)
 {
-    if (!proTx.sig.VerifyInsecure(pubKey, ::SerializeHash(proTx))) {
-        return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-sig");
-    }
-    return true;
+    return CheckProTxSig(CProTxSigCheck(::SerializeHash(proTx), CKeyID(pkhash), proTx.vchSig), state, pvChecks);
 }
 
-bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, bool check_sigs)
+template <typename ProTx>
+static bool CheckStringSig(const ProTx& proTx, const PKHash& pkhash, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks)
+{
+    return CheckProTxSig(CProTxSigCheck(proTx.MakeSignString(), CKeyID(pkhash), proTx.vchSig), state, pvChecks);
+}
+
+template <typename ProTx>
+static bool CheckHashSig(const ProTx& proTx, const CBLSPublicKey& pubKey, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks)
+{
+    return CheckProTxSig(CProTxSigCheck(::SerializeHash(proTx), pubKey, proTx.sig), state, pvChecks);
+}
+
+bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, bool check_sigs, std::vector<CProTxSigCheck>* pvChecks)
 {
     if (tx.nType != TRANSACTION_PROVIDER_REGISTER) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-type");
@@ -1606,7 +2131,7 @@ bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValid
 
     if (keyForPayloadSig) {
         // collateral is not part of this ProRegTx, so we must verify ownership of the collateral
-        if (check_sigs && !CheckStringSig(ptx, *keyForPayloadSig, state)) {
+        if (check_sigs && !CheckStringSig(ptx, *keyForPayloadSig, state, pvChecks)) {
             // pass the state returned by the function above
             return false;
         }
@@ -1620,7 +2145,7 @@ bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValid
     return true;
 }
 
-bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, bool check_sigs)
+bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, bool check_sigs, std::vector<CProTxSigCheck>* pvChecks)
 {
     if (tx.nType != TRANSACTION_PROVIDER_UPDATE_SERVICE) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-type");
@@ -1679,7 +2204,7 @@ bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVa
         if (auto maybe_err = CheckInputsHash(tx, ptx); maybe_err.did_err) {
             return state.Invalid(maybe_err.reason, false, REJECT_INVALID, std::string(maybe_err.error_str));
         }
-        if (check_sigs && !CheckHashSig(ptx, mn->pdmnState->pubKeyOperator.Get(), state)) {
+        if (check_sigs && !CheckHashSig(ptx, mn->pdmnState->pubKeyOperator.Get(), state, pvChecks)) {
             // pass the state returned by the function above
             return false;
         }
@@ -1688,7 +2213,7 @@ bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVa
     return true;
 }
 
-bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, bool check_sigs)
+bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, bool check_sigs, std::vector<CProTxSigCheck>* pvChecks)
 {
     if (tx.nType != TRANSACTION_PROVIDER_UPDATE_REGISTRAR) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-type");
@@ -1752,7 +2277,7 @@ bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
         if (auto maybe_err = CheckInputsHash(tx, ptx); maybe_err.did_err) {
             return state.Invalid(maybe_err.reason, false, REJECT_INVALID, std::string(maybe_err.error_str));
         }
-        if (check_sigs && !CheckHashSig(ptx, PKHash(dmn->pdmnState->keyIDOwner), state)) {
+        if (check_sigs && !CheckHashSig(ptx, PKHash(dmn->pdmnState->keyIDOwner), state, pvChecks)) {
             // pass the state returned by the function above
             return false;
         }
@@ -1761,7 +2286,7 @@ bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
     return true;
 }
 
-bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, bool check_sigs)
+bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, bool check_sigs, std::vector<CProTxSigCheck>* pvChecks)
 {
     if (tx.nType != TRANSACTION_PROVIDER_UPDATE_REVOKE) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-type");
@@ -1785,7 +2310,7 @@ bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
         if (auto maybe_err = CheckInputsHash(tx, ptx); maybe_err.did_err) {
             return state.Invalid(maybe_err.reason, false, REJECT_INVALID, std::string(maybe_err.error_str));
         }
-        if (check_sigs && !CheckHashSig(ptx, dmn->pdmnState->pubKeyOperator.Get(), state)) {
+        if (check_sigs && !CheckHashSig(ptx, dmn->pdmnState->pubKeyOperator.Get(), state, pvChecks)) {
             // pass the state returned by the function above
             return false;
         }
@@ -1802,4 +2327,28 @@ void CDeterministicMNManager::DoMaintenance() {
     LOCK(cs);
     CleanupCache(loc_to_cleanup);
     did_cleanup = loc_to_cleanup;
+
+    statsClient.count("masternodes.listCache.listHits", nCacheListHits, 1.0f);
+    statsClient.count("masternodes.listCache.listMisses", nCacheListMisses, 1.0f);
+    statsClient.count("masternodes.listCache.diffHits", nCacheDiffHits, 1.0f);
+    statsClient.count("masternodes.listCache.diffMisses", nCacheDiffMisses, 1.0f);
+    statsClient.count("masternodes.listCache.evictions", nCacheEvictions, 1.0f);
+    statsClient.gauge("masternodes.listCache.lists", mnListsCache.size(), 1.0f);
+    statsClient.gauge("masternodes.listCache.diffs", mnListDiffsCache.size(), 1.0f);
+    statsClient.gauge("masternodes.listCache.memoryUsageBytes", GetCacheMemoryUsageInternal(), 1.0f);
+    nCacheListHits = nCacheListMisses = nCacheDiffHits = nCacheDiffMisses = nCacheEvictions = 0;
+}
+
+size_t CDeterministicMNManager::GetCacheMemoryUsage()
+{
+    LOCK(cs);
+    return GetCacheMemoryUsageInternal();
+}
+
+size_t CDeterministicMNManager::GetCacheMemoryUsageInternal() const
+{
+    AssertLockHeld(cs);
+    // masternodes in mnListEntriesCache are charged in full, they can outlive the lists they were read for
+    using EntriesCacheNode = memusage::unordered_node<std::pair<const uint256, std::pair<CDeterministicMNCPtr, int64_t>>>;
+    return nCacheMemoryUsage + mnListEntriesCache.size() * (memusage::MallocUsage(sizeof(EntriesCacheNode)) + sizeof(void*) + GetMNEntryUsage());
 }
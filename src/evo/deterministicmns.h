@@ -16,6 +16,7 @@
 #include <saltedhasher.h>
 #include <scheduler.h>
 #include <sync.h>
+#include <unordered_lru_cache.h>
 
 #include <immer/map.hpp>
 
@@ -156,6 +157,38 @@ inline void SerReadWrite(Stream& s, immer::map<K, T, Hash, Equal>& obj, CSerActi
     ::UnserializeImmerMap(s, obj);
 }
 
+/**
+ * Immutable struct-of-arrays copy of all masternodes of a CDeterministicMNList, in the order the list iterates them.
+ * Scanning these arrays is much more cache friendly than walking the immer map and dereferencing every masternode and
+ * its state, which is what the hot loops (payments, quorum calculation, RPC listings) would be doing otherwise.
+ */
+class CDeterministicMNListFlatView
+{
+public:
+    std::vector<CDeterministicMNCPtr> dmns;
+    std::vector<uint256> proTxHashes;
+    std::vector<MnType> types;
+    std::vector<uint8_t> valid;
+    std::vector<int> lastPaidHeights;
+    // nLastPaidHeight or nPoSeRevivedHeight/nRegisteredHeight, whatever is used to order masternodes for payments
+    std::vector<int> paymentOrderHeights;
+    std::vector<uint8_t> confirmed;
+    std::vector<uint256> confirmedHashesWithProRegTxHash;
+
+    size_t nValidCount{0};
+    size_t nValidWeightedCount{0};
+    size_t nHPMNCount{0};
+    size_t nValidHPMNCount{0};
+
+    explicit CDeterministicMNListFlatView(size_t nCapacity);
+
+    void Add(const CDeterministicMNCPtr& dmn);
+
+    [[nodiscard]] size_t size() const { return dmns.size(); }
+    [[nodiscard]] size_t GetMemoryUsage() const;
+    // memory usage of a fully built view with room for nCapacity masternodes
+    [[nodiscard]] static size_t GetMemoryUsage(size_t nCapacity);
+};
 
 class CDeterministicMNList
 {
@@ -181,6 +214,20 @@ private:
     // we keep track of this as checking for duplicates would otherwise be painfully slow
     MnUniquePropertyMap mnUniquePropertyMap;
 
+    // kept up to date on every change of mnMap, so that asking for the counts doesn't (re)build the flat view
+    size_t nValidCount{0};
+    size_t nValidWeightedCount{0};
+    size_t nHPMNCount{0};
+    size_t nValidHPMNCount{0};
+
+    // lazily built flat view of mnMap, shared by all copies of a list until one of them gets modified
+    struct FlatViewHolder
+    {
+        Mutex cs;
+        std::shared_ptr<const CDeterministicMNListFlatView> view GUARDED_BY(cs);
+    };
+    std::shared_ptr<FlatViewHolder> flatViewHolder{std::make_shared<FlatViewHolder>()};
+
 public:
     CDeterministicMNList() = default;
     explicit CDeterministicMNList(const uint256& _blockHash, int _height, uint32_t _totalRegisteredCount) :
@@ -214,6 +261,8 @@ public:
         mnMap = MnMap();
         mnUniquePropertyMap = MnUniquePropertyMap();
         mnInternalIdMap = MnInternalIdMap();
+        nValidCount = nValidWeightedCount = nHPMNCount = nValidHPMNCount = 0;
+        InvalidateFlatView();
 
         SerializationOpBase(s, CSerActionUnserialize());
 
@@ -223,6 +272,7 @@ public:
             if (evodb_migration) {
                 const auto dmn = std::make_shared<CDeterministicMN>(deserialize, s, format_version);
                 mnMap = mnMap.set(dmn->proTxHash, dmn);
+                UpdateCounts(*dmn, true);
             } else {
                 AddMN(std::make_shared<CDeterministicMN>(deserialize, s, format_version), false);
             }
@@ -236,27 +286,38 @@ public:
 
     [[nodiscard]] size_t GetValidMNsCount() const
     {
-        return ranges::count_if(mnMap, [](const auto& p){ return IsMNValid(*p.second); });
+        return nValidCount;
     }
 
     [[nodiscard]] size_t GetAllHPMNsCount() const
     {
-        return ranges::count_if(mnMap, [](const auto& p) { return p.second->nType == MnType::HighPerformance; });
+        return nHPMNCount;
     }
 
     [[nodiscard]] size_t GetValidHPMNsCount() const
     {
-        return ranges::count_if(mnMap, [](const auto& p) { return p.second->nType == MnType::HighPerformance && IsMNValid(*p.second); });
+        return nValidHPMNCount;
     }
 
     [[nodiscard]] size_t GetValidWeightedMNsCount() const
     {
-        return std::accumulate(mnMap.begin(), mnMap.end(), 0, [](auto res, const auto& p) {
-                                                                if (!IsMNValid(*p.second)) return res;
-                                                                return res + GetMnType(p.second->nType).voting_weight;
-                                                            });
+        return nValidWeightedCount;
     }
 
+    /**
+     * Returns the flat view of this list, builds it if this list version doesn't have one yet.
+     */
+    [[nodiscard]] std::shared_ptr<const CDeterministicMNListFlatView> GetFlatView() const;
+    /**
+     * Returns the flat view of this list if it was built already, nullptr otherwise. Every block changes the list, and
+     * building the view costs several times more than walking the list once, so single walks should not build it.
+     */
+    [[nodiscard]] std::shared_ptr<const CDeterministicMNListFlatView> GetFlatViewIfBuilt() const;
+    /**
+     * Memory used by the flat view of this list, 0 if it was never built.
+     */
+    [[nodiscard]] size_t GetFlatViewMemoryUsage() const;
+
     /**
      * Execute a callback on all masternodes in the mnList. This will pass a reference
      * of each masternode to the callback function. This should be preferred over ForEachMNShared.
@@ -266,9 +327,18 @@ public:
     template <typename Callback>
     void ForEachMN(bool onlyValid, Callback&& cb) const
     {
-        for (const auto& p : mnMap) {
-            if (!onlyValid || IsMNValid(*p.second)) {
-                cb(*p.second);
+        const auto view = onlyValid ? GetFlatViewIfBuilt() : nullptr;
+        if (view == nullptr) {
+            for (const auto& p : mnMap) {
+                if (!onlyValid || IsMNValid(*p.second)) {
+                    cb(*p.second);
+                }
+            }
+            return;
+        }
+        for (size_t i = 0; i < view->size(); i++) {
+            if (view->valid[i]) {
+                cb(*view->dmns[i]);
             }
         }
     }
@@ -283,9 +353,18 @@ public:
     template <typename Callback>
     void ForEachMNShared(bool onlyValid, Callback&& cb) const
     {
-        for (const auto& p : mnMap) {
-            if (!onlyValid || IsMNValid(*p.second)) {
-                cb(p.second);
+        const auto view = onlyValid ? GetFlatViewIfBuilt() : nullptr;
+        if (view == nullptr) {
+            for (const auto& p : mnMap) {
+                if (!onlyValid || IsMNValid(*p.second)) {
+                    cb(p.second);
+                }
+            }
+            return;
+        }
+        for (size_t i = 0; i < view->size(); i++) {
+            if (view->valid[i]) {
+                cb(view->dmns[i]);
             }
         }
     }
@@ -391,6 +470,16 @@ public:
     [[nodiscard]] CSimplifiedMNListDiff BuildSimplifiedDiff(const CDeterministicMNList& to, bool extended) const;
     [[nodiscard]] CDeterministicMNList ApplyDiff(const CBlockIndex* pindex, const CDeterministicMNListDiff& diff) const;
 
+    /**
+     * Replaces all masternodes of this list with the given ones. Masternodes which are also present in the base list
+     * (same proTxHash and serialized content) are taken over as is, so unchanged parts of the immer maps stay shared
+     * with the base list.
+     * @param base list to start from, usually one with a nearby height
+     * @param dmns all masternodes of the resulting list
+     * @return the number of masternodes which had to be added or removed, i.e. which are not shared with the base list
+     */
+    size_t SetMNsFromBase(const CDeterministicMNList& base, const std::vector<CDeterministicMNCPtr>& dmns);
+
     void AddMN(const CDeterministicMNCPtr& dmn, bool fBumpTotalCount = true);
     void UpdateMN(const CDeterministicMN& oldDmn, const std::shared_ptr<const CDeterministicMNState>& pdmnState);
     void UpdateMN(const uint256& proTxHash, const std::shared_ptr<const CDeterministicMNState>& pdmnState);
@@ -413,6 +502,9 @@ public:
     }
 
 private:
+    void InvalidateFlatView();
+    void UpdateCounts(const CDeterministicMN& dmn, bool fAdd);
+
     template <typename T>
     [[nodiscard]] uint256 GetUniquePropertyHash(const T& v) const
     {
@@ -551,6 +643,15 @@ public:
     {
         return !addedMNs.empty() || !updatedMNs.empty() || !removedMns.empty();
     }
+
+    /**
+     * Estimates how expensive it is to apply this diff when rebuilding a list from a snapshot.
+     * Every diff costs at least one unit (reading and looking it up), plus one unit per touched masternode.
+     */
+    [[nodiscard]] int GetReplayCost() const
+    {
+        return static_cast<int>(1 + addedMNs.size() + updatedMNs.size() + removedMns.size());
+    }
 };
 
 
@@ -563,9 +664,31 @@ constexpr int llmq_max_blocks() {
     return max_blocks;
 }
 
+//! Default for -mnlistcachemb, memory budget for cached masternode lists and diffs in MiB
+static constexpr size_t DEFAULT_MNLIST_CACHE_SIZE{32};
+
+struct CMNListCacheEvictionCandidate
+{
+    double nPriority;
+    size_t nSize;
+    uint256 blockHash;
+    bool fIsList;
+};
+
+/**
+ * GreedyDual-Size eviction as done by CDeterministicMNManager::EvictFromCache(). Sorts the candidates by priority (cost
+ * to rebuild per byte plus the aging value at the time of the last access) and returns how many of them, starting
+ * with the lowest priority, have to be evicted to bring nUsage down to nMaxBytes. Returns candidates.size() if that
+ * is not possible.
+ */
+size_t SelectMNListCacheEvictions(std::vector<CMNListCacheEvictionCandidate>& candidates, size_t nUsage, size_t nMaxBytes);
+
 class CDeterministicMNManager
 {
     static constexpr int DISK_SNAPSHOT_PERIOD = 576; // once per day
+    // write an additional snapshot as soon as the diffs since the last one get too expensive to replay,
+    // this keeps GetListForBlock() fast for blocks which follow bursts of masternode list changes
+    static constexpr int DISK_SNAPSHOT_MAX_REPLAY_COST = DISK_SNAPSHOT_PERIOD * 4;
     // keep cache for enough disk snapshots to have all active quourms covered
     static constexpr int DISK_SNAPSHOTS = llmq_max_blocks() / DISK_SNAPSHOT_PERIOD + 1;
     static constexpr int LIST_DIFFS_CACHE_SIZE = DISK_SNAPSHOT_PERIOD * DISK_SNAPSHOTS;
@@ -574,23 +697,53 @@ public:
     CCriticalSection cs;
 
 private:
+    template <typename T>
+    struct CacheEntry
+    {
+        T value;
+        // how expensive it is to get the value back after eviction, in units of CDeterministicMNListDiff::GetReplayCost()
+        int nCost{1};
+        // value of cacheInflation at the time of the last access, see CleanupCache()
+        double nInflation{0};
+        // memory charged to this entry when it was added, see GetListCacheUsage() and GetDiffCacheUsage()
+        size_t nSize{0};
+    };
+
     Mutex cs_cleanup;
-    // We have performed CleanupCache() on this height.
-    int did_cleanup GUARDED_BY(cs_cleanup) {0};
 
     // Main thread has indicated we should perform cleanup up to this height
     std::atomic<int> to_cleanup {0};
+    // Last cleanup was performed at this height
+    int did_cleanup GUARDED_BY(cs_cleanup) {0};
 
     CEvoDB& m_evoDb;
     CConnman& connman;
 
-    std::unordered_map<uint256, CDeterministicMNList, StaticSaltedHasher> mnListsCache GUARDED_BY(cs);
-    std::unordered_map<uint256, CDeterministicMNListDiff, StaticSaltedHasher> mnListDiffsCache GUARDED_BY(cs);
+    const size_t nCacheMaxBytes;
+    std::unordered_map<uint256, CacheEntry<CDeterministicMNList>, StaticSaltedHasher> mnListsCache GUARDED_BY(cs);
+    std::unordered_map<uint256, CacheEntry<CDeterministicMNListDiff>, StaticSaltedHasher> mnListDiffsCache GUARDED_BY(cs);
+    // GreedyDual-Size aging value, raised to the priority of every evicted entry
+    double cacheInflation GUARDED_BY(cs) {0};
+    // counters since the last time they were sent to statsd
+    uint64_t nCacheListHits GUARDED_BY(cs) {0};
+    uint64_t nCacheListMisses GUARDED_BY(cs) {0};
+    uint64_t nCacheDiffHits GUARDED_BY(cs) {0};
+    uint64_t nCacheDiffMisses GUARDED_BY(cs) {0};
+    uint64_t nCacheEvictions GUARDED_BY(cs) {0};
+    // sum of CacheEntry::nSize of all entries in mnListsCache and mnListDiffsCache, updated on insert and erase
+    size_t nCacheMemoryUsage GUARDED_BY(cs) {0};
+    // masternode entries of snapshots by content hash, lets snapshots loaded from disk share them. Counts against
+    // nCacheMaxBytes as well, see GetCacheMemoryUsage()
+    unordered_lru_cache<uint256, CDeterministicMNCPtr, StaticSaltedHasher, 8192> mnListEntriesCache GUARDED_BY(cs);
+    // height and accumulated replay cost since the last disk snapshot, see CDeterministicMNListDiff::GetReplayCost()
+    std::unordered_map<uint256, std::pair<int, int>, StaticSaltedHasher> mnListReplayCostCache GUARDED_BY(cs);
     const CBlockIndex* tipIndex GUARDED_BY(cs) {nullptr};
+    // block hash of the snapshot which was read last, see ReadListSnapshot()
+    uint256 lastReadSnapshotHash GUARDED_BY(cs);
 
 public:
-    explicit CDeterministicMNManager(CEvoDB& evoDb, CConnman& _connman) :
-        m_evoDb(evoDb), connman(_connman) {}
+    explicit CDeterministicMNManager(CEvoDB& evoDb, CConnman& _connman, size_t _nCacheMaxBytes = DEFAULT_MNLIST_CACHE_SIZE << 20) :
+        m_evoDb(evoDb), connman(_connman), nCacheMaxBytes(_nCacheMaxBytes) {}
     ~CDeterministicMNManager() = default;
 
     bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state,
@@ -615,17 +768,113 @@ public:
 
     bool MigrateDBIfNeeded();
     bool MigrateDBIfNeeded2();
+    // false if the DB contains snapshots in a format written by a newer version
+    bool IsListSnapshotFormatSupported();
 
     void DoMaintenance();
 
+    // estimated memory used by cached lists, diffs and masternode entries
+    size_t GetCacheMemoryUsage();
+
 private:
+    template <typename T>
+    void AddToCache(std::unordered_map<uint256, CacheEntry<T>, StaticSaltedHasher>& cache, const uint256& blockHash, T value, int nCost, size_t nSize) EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        if (cache.emplace(blockHash, CacheEntry<T>{std::move(value), nCost, cacheInflation, nSize}).second) {
+            nCacheMemoryUsage += nSize;
+        }
+    }
+    template <typename T>
+    void EraseFromCache(std::unordered_map<uint256, CacheEntry<T>, StaticSaltedHasher>& cache, const uint256& blockHash) EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        auto it = cache.find(blockHash);
+        if (it != cache.end()) {
+            nCacheMemoryUsage -= it->second.nSize;
+            cache.erase(it);
+        }
+    }
+    size_t GetCacheMemoryUsageInternal() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    bool IsPinnedInCache(const CDeterministicMNList& mnList, int nHeight) const EXCLUSIVE_LOCKS_REQUIRED(cs);
     void CleanupCache(int nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    // evicts unpinned lists and diffs until the cache uses at most nMaxBytes (or only pinned lists are left)
+    void EvictFromCache(int nHeight, size_t nMaxBytes) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    // called after adding to the cache, keeps it within its budget between the per block cleanups
+    void EnforceCacheBudget() EXCLUSIVE_LOCKS_REQUIRED(cs);
+    int GetReplayCostSinceSnapshot(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+public:
+    // disk snapshots, only used directly by GetListForBlock() and ProcessBlock() (and tests)
+    bool HasListSnapshot(const uint256& blockHash);
+    // nChangedRet is set to the number of masternodes which are not shared with another cached list
+    bool ReadListSnapshot(const uint256& blockHash, CDeterministicMNList& mnListRet, size_t& nChangedRet) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    // only writes the masternode entries which are not referenced by the snapshot at prevSnapshotHash already
+    void WriteListSnapshot(const CDeterministicMNList& mnList, const uint256& prevSnapshotHash) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    // block hash of the last shared snapshot at or before pindex, null if there is none
+    uint256 FindPrevListSnapshot(const CBlockIndex* pindex);
+};
+
+/**
+ * Closure representing the verification of a ProTx payload signature. Only needs the data stored inside of it, so it
+ * can be executed on any thread, e.g. by a CCheckQueue, while the stateful checks keep running sequentially.
+ */
+class CProTxSigCheck
+{
+private:
+    enum class SigType : uint8_t {
+        None,
+        HashECDSA,
+        MessageECDSA,
+        HashBLS,
+    };
+
+    SigType sigType{SigType::None};
+    uint256 hash;
+    std::string strMessage;
+    CKeyID keyID;
+    std::vector<unsigned char> vchSig;
+    CBLSPublicKey pubKey;
+    CBLSSignature sig;
+
+public:
+    CProTxSigCheck() = default;
+    CProTxSigCheck(const uint256& _hash, const CKeyID& _keyID, const std::vector<unsigned char>& _vchSig) :
+        sigType(SigType::HashECDSA), hash(_hash), keyID(_keyID), vchSig(_vchSig) {}
+    CProTxSigCheck(const std::string& _strMessage, const CKeyID& _keyID, const std::vector<unsigned char>& _vchSig) :
+        sigType(SigType::MessageECDSA), strMessage(_strMessage), keyID(_keyID), vchSig(_vchSig) {}
+    CProTxSigCheck(const uint256& _hash, const CBLSPublicKey& _pubKey, const CBLSSignature& _sig) :
+        sigType(SigType::HashBLS), hash(_hash), pubKey(_pubKey), sig(_sig) {}
+
+    bool operator()() const;
+
+    [[nodiscard]] bool IsBLS() const { return sigType == SigType::HashBLS; }
+
+    /**
+     * Verifies all passed BLS checks with a single aggregated verification. Each signature and public key is
+     * multiplied by a random scalar first, so invalid signatures can't cancel each other out in the aggregate and
+     * the result is the same as when verifying each of them individually.
+     */
+    static bool VerifyBLSBatch(const std::vector<CProTxSigCheck>& checks);
+
+    void swap(CProTxSigCheck& check)
+    {
+        std::swap(sigType, check.sigType);
+        std::swap(hash, check.hash);
+        std::swap(strMessage, check.strMessage);
+        std::swap(keyID, check.keyID);
+        std::swap(vchSig, check.vchSig);
+        std::swap(pubKey, check.pubKey);
+        std::swap(sig, check.sig);
+    }
 };
 
-bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, bool check_sigs);
-bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, bool check_sigs);
-bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, bool check_sigs);
-bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, bool check_sigs);
+/**
+ * The Check*Tx functions verify payload signatures right away if check_sigs is set and pvChecks is nullptr.
+ * Otherwise the signature checks are appended to pvChecks and it's up to the caller to execute them.
+ */
+bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, bool check_sigs, std::vector<CProTxSigCheck>* pvChecks = nullptr);
+bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, bool check_sigs, std::vector<CProTxSigCheck>* pvChecks = nullptr);
+bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, bool check_sigs, std::vector<CProTxSigCheck>* pvChecks = nullptr);
+bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, bool check_sigs, std::vector<CProTxSigCheck>* pvChecks = nullptr);
 
 extern std::unique_ptr<CDeterministicMNManager> deterministicMNManager;
 
@@ -18,11 +18,14 @@
 #include <base58.h>
 #include <chainparams.h>
 #include <consensus/merkle.h>
+#include <crypto/sha256.h>
 #include <univalue.h>
 #include <validation.h>
 #include <key_io.h>
 #include <util/underlying.h>
 
+#include <limits>
+
 CSimplifiedMNListEntry::CSimplifiedMNListEntry(const CDeterministicMN& dmn) :
     proRegTxHash(dmn.proTxHash),
     confirmedHash(dmn.pdmnState->confirmedHash),
@@ -127,6 +130,106 @@ uint256 CSimplifiedMNList::CalcMerkleRoot(bool* pmutated) const
     return ComputeMerkleRoot(leaves, pmutated);
 }
 
+void CSimplifiedMNListMerkleTree::Set(const uint256& proRegTxHash, const uint256& entryHash)
+{
+    auto it = std::lower_bound(proRegTxHashes.begin(), proRegTxHashes.end(), proRegTxHash);
+    const size_t pos = it - proRegTxHashes.begin();
+    if (it != proRegTxHashes.end() && *it == proRegTxHash) {
+        if (levels[0][pos] != entryHash) {
+            levels[0][pos] = entryHash;
+            dirtyLeaves.emplace_back(pos);
+        }
+        return;
+    }
+    proRegTxHashes.insert(it, proRegTxHash);
+    levels[0].insert(levels[0].begin() + pos, entryHash);
+    nDirtyFrom = std::min(nDirtyFrom, pos);
+}
+
+void CSimplifiedMNListMerkleTree::Remove(const uint256& proRegTxHash)
+{
+    auto it = std::lower_bound(proRegTxHashes.begin(), proRegTxHashes.end(), proRegTxHash);
+    if (it == proRegTxHashes.end() || *it != proRegTxHash) {
+        return;
+    }
+    const size_t pos = it - proRegTxHashes.begin();
+    proRegTxHashes.erase(it);
+    levels[0].erase(levels[0].begin() + pos);
+    nDirtyFrom = std::min(nDirtyFrom, pos);
+}
+
+void CSimplifiedMNListMerkleTree::Clear()
+{
+    proRegTxHashes.clear();
+    levels.assign(1, {});
+    dirtyLeaves.clear();
+    nDirtyFrom = 0;
+}
+
+uint256 CSimplifiedMNListMerkleTree::GetRoot(bool* pmutated)
+{
+    // dirty positions of the current level, the ones at or after dirtyFrom are handled as a range
+    std::sort(dirtyLeaves.begin(), dirtyLeaves.end());
+    std::vector<size_t> dirty = std::move(dirtyLeaves);
+    size_t dirtyFrom = std::min(nDirtyFrom, levels[0].size());
+    dirtyLeaves.clear();
+    nDirtyFrom = std::numeric_limits<size_t>::max();
+
+    bool mutation = false;
+    std::vector<uint256> pairs;
+    size_t l = 0;
+    for (; levels[l].size() > 1; l++) {
+        if (levels.size() == l + 1) {
+            levels.emplace_back();
+        }
+        const auto& cur = levels[l];
+        auto& next = levels[l + 1];
+        for (size_t pos = 0; pos + 1 < cur.size(); pos += 2) {
+            if (cur[pos] == cur[pos + 1]) mutation = true;
+        }
+
+        const size_t nParents = (cur.size() + 1) / 2;
+        next.resize(nParents);
+        const size_t nextDirtyFrom = dirtyFrom / 2;
+
+        // same as in ComputeMerkleRoot, the last node is paired with itself if the level has an odd number of nodes
+        std::vector<size_t> nextDirty;
+        for (const size_t pos : dirty) {
+            const size_t parent = pos / 2;
+            if (parent >= nextDirtyFrom) break;
+            if (!nextDirty.empty() && nextDirty.back() == parent) continue;
+            nextDirty.emplace_back(parent);
+        }
+        const size_t nHashes = nextDirty.size() + (nParents - nextDirtyFrom);
+        pairs.resize(nHashes * 2);
+        size_t i = 0;
+        for (const size_t parent : nextDirty) {
+            pairs[i++] = cur[parent * 2];
+            pairs[i++] = cur[std::min(parent * 2 + 1, cur.size() - 1)];
+        }
+        for (size_t parent = nextDirtyFrom; parent < nParents; parent++) {
+            pairs[i++] = cur[parent * 2];
+            pairs[i++] = cur[std::min(parent * 2 + 1, cur.size() - 1)];
+        }
+        if (nHashes != 0) {
+            SHA256D64(pairs[0].begin(), pairs[0].begin(), nHashes);
+        }
+        for (i = 0; i < nextDirty.size(); i++) {
+            next[nextDirty[i]] = pairs[i];
+        }
+        std::copy(pairs.begin() + nextDirty.size(), pairs.begin() + nHashes, next.begin() + nextDirtyFrom);
+
+        dirty = std::move(nextDirty);
+        dirtyFrom = nextDirtyFrom;
+    }
+    // the tree might have gotten smaller
+    levels.resize(l + 1);
+
+    if (pmutated) *pmutated = mutation;
+    if (levels[l].empty()) return uint256();
+    return levels[l][0];
+}
+
 bool CSimplifiedMNList::operator==(const CSimplifiedMNList& rhs) const
 {
     return mnList.size() == rhs.mnList.size() &&
@@ -299,3 +402,71 @@ bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& bloc
 
     return true;
 }
+
+bool CMNListResponseCache::Get(const uint256& key, std::vector<unsigned char>& dataRet)
+{
+    LOCK(cs);
+    auto it = entriesByKey.find(key);
+    if (it == entriesByKey.end()) {
+        nMisses++;
+        return false;
+    }
+    nHits++;
+    entries.splice(entries.begin(), entries, it->second);
+    dataRet = it->second->second;
+    return true;
+}
+
+void CMNListResponseCache::Add(const uint256& key, std::vector<unsigned char>&& data)
+{
+    if (data.size() > nMaxBytes) {
+        return;
+    }
+
+    LOCK(cs);
+    if (entriesByKey.count(key) != 0) {
+        return;
+    }
+    nBytes += data.size();
+    entries.emplace_front(key, std::move(data));
+    entriesByKey.emplace(key, entries.begin());
+
+    while (nBytes > nMaxBytes) {
+        const auto& [oldKey, oldData] = entries.back();
+        nBytes -= oldData.size();
+        entriesByKey.erase(oldKey);
+        entries.pop_back();
+    }
+}
+
+void CMNListResponseCache::Clear()
+{
+    LOCK(cs);
+    entries.clear();
+    entriesByKey.clear();
+    nBytes = 0;
+}
+
+size_t CMNListResponseCache::Size() const
+{
+    LOCK(cs);
+    return entries.size();
+}
+
+size_t CMNListResponseCache::GetBytes() const
+{
+    LOCK(cs);
+    return nBytes;
+}
+
+uint64_t CMNListResponseCache::GetHits() const
+{
+    LOCK(cs);
+    return nHits;
+}
+
+uint64_t CMNListResponseCache::GetMisses() const
+{
+    LOCK(cs);
+    return nMisses;
+}
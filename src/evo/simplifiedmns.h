@@ -11,6 +11,11 @@
 #include <merkleblock.h>
 #include <netaddress.h>
 #include <pubkey.h>
+#include <saltedhasher.h>
+#include <sync.h>
+
+#include <list>
+#include <unordered_map>
 
 class UniValue;
 class CBlockIndex;
@@ -107,6 +112,34 @@ public:
     bool operator==(const CSimplifiedMNList& rhs) const;
 };
 
+/**
+ * Merkle tree over the entry hashes of a CSimplifiedMNList (sorted by proRegTxHash) which is kept between updates, so
+ * that GetRoot only needs to hash the paths of changed entries again. Adding or removing an entry shifts all following
+ * leaves, so everything right of it needs to be hashed again then (but no entries need to be serialized again).
+ * Results are equal to CSimplifiedMNList::CalcMerkleRoot.
+ */
+class CSimplifiedMNListMerkleTree
+{
+private:
+    // sorted, same order as levels[0]
+    std::vector<uint256> proRegTxHashes;
+    // levels[0] holds the entry hashes, the last level holds the root
+    std::vector<std::vector<uint256>> levels{1};
+
+    // leaves which were changed in place since the last GetRoot
+    std::vector<size_t> dirtyLeaves;
+    // all leaves from this position on need to be hashed again
+    size_t nDirtyFrom{0};
+
+public:
+    void Set(const uint256& proRegTxHash, const uint256& entryHash);
+    void Remove(const uint256& proRegTxHash);
+    void Clear();
+
+    uint256 GetRoot(bool* pmutated = nullptr);
+    size_t Size() const { return proRegTxHashes.size(); }
+};
+
 /// P2P messages
 
 class CGetSimplifiedMNListDiff
@@ -159,4 +192,45 @@ public:
 bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet,
                                const llmq::CQuorumBlockProcessor& quorum_block_processor, std::string& errorRet, bool extended = false);
 
+/**
+ * Byte bounded LRU cache of fully serialized MNLISTDIFF and QRINFO messages, so that the lists don't have to be built
+ * and diffed again when multiple clients ask for the same (base, tip) pairs. Responses depend on the active chain, so
+ * the key must commit to the current tip and the cache should be cleared whenever the tip changes. Sending a cached
+ * response still copies it once into the outgoing message, but that is much cheaper than building it again.
+ */
+class CMNListResponseCache
+{
+public:
+    static constexpr size_t DEFAULT_MAX_BYTES = 16 * 1024 * 1024;
+
+private:
+    using Entry = std::pair<uint256, std::vector<unsigned char>>;
+    using EntryList = std::list<Entry>;
+
+    const size_t nMaxBytes;
+
+    mutable Mutex cs;
+    // most recently used entries first
+    EntryList entries GUARDED_BY(cs);
+    std::unordered_map<uint256, EntryList::iterator, StaticSaltedHasher> entriesByKey GUARDED_BY(cs);
+    size_t nBytes GUARDED_BY(cs) {0};
+
+    uint64_t nHits GUARDED_BY(cs) {0};
+    uint64_t nMisses GUARDED_BY(cs) {0};
+
+public:
+    explicit CMNListResponseCache(size_t _nMaxBytes = DEFAULT_MAX_BYTES) : nMaxBytes(_nMaxBytes) {}
+
+    // the key should be derived from the message type, send version, current tip and the serialized request
+    // copies the cached response into dataRet
+    bool Get(const uint256& key, std::vector<unsigned char>& dataRet);
+    void Add(const uint256& key, std::vector<unsigned char>&& data);
+    void Clear();
+
+    size_t Size() const;
+    size_t GetBytes() const;
+    uint64_t GetHits() const;
+    uint64_t GetMisses() const;
+};
+
 #endif // BITCOIN_EVO_SIMPLIFIEDMNS_H
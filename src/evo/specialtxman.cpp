@@ -5,6 +5,7 @@
 #include <evo/specialtxman.h>
 
 #include <chainparams.h>
+#include <checkqueue.h>
 #include <consensus/validation.h>
 #include <evo/cbtx.h>
 #include <evo/deterministicmns.h>
@@ -17,7 +18,20 @@
 #include <primitives/block.h>
 #include <validation.h>
 
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, bool check_sigs)
+static CCheckQueue<CProTxSigCheck> specialtxcheckqueue(16);
+
+void StartSpecialTxCheckWorkerThreads(int threads_num)
+{
+    specialtxcheckqueue.StartWorkerThreads(threads_num, "protxch");
+}
+
+void StopSpecialTxCheckWorkerThreads()
+{
+    specialtxcheckqueue.StopWorkerThreads();
+}
+
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, bool check_sigs,
+                    std::vector<CProTxSigCheck>* pvChecks)
 {
     AssertLockHeld(cs_main);
 
@@ -31,13 +45,13 @@ bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVali
     try {
         switch (tx.nType) {
         case TRANSACTION_PROVIDER_REGISTER:
-            return CheckProRegTx(tx, pindexPrev, state, view, check_sigs);
+            return CheckProRegTx(tx, pindexPrev, state, view, check_sigs, pvChecks);
         case TRANSACTION_PROVIDER_UPDATE_SERVICE:
-            return CheckProUpServTx(tx, pindexPrev, state, check_sigs);
+            return CheckProUpServTx(tx, pindexPrev, state, check_sigs, pvChecks);
         case TRANSACTION_PROVIDER_UPDATE_REGISTRAR:
-            return CheckProUpRegTx(tx, pindexPrev, state, view, check_sigs);
+            return CheckProUpRegTx(tx, pindexPrev, state, view, check_sigs, pvChecks);
         case TRANSACTION_PROVIDER_UPDATE_REVOKE:
-            return CheckProUpRevTx(tx, pindexPrev, state, check_sigs);
+            return CheckProUpRevTx(tx, pindexPrev, state, check_sigs, pvChecks);
         case TRANSACTION_COINBASE:
             return CheckCbTx(tx, pindexPrev, state);
         case TRANSACTION_QUORUM_COMMITMENT:
@@ -99,6 +113,25 @@ bool UndoSpecialTx(const CTransaction& tx, const CBlockIndex* pindex)
     return false;
 }
 
+// The deferred payload signature checks only tell whether all of them were valid. Repeat the checks of the block one
+// transaction at a time to find out which one is invalid. This only happens for invalid blocks. Returns false if an
+// invalid TX was found, true (and logs an error) if all individual checks passed
+static bool FindInvalidProTxSig(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, const CCoinsViewCache& view)
+    EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    for (const auto& ptr_tx : block.vtx) {
+        CValidationState txState;
+        if (!CheckSpecialTx(*ptr_tx, pindex->pprev, txState, view, true)) {
+            return state.Invalid(txState.GetReason(), false, txState.GetRejectCode(), txState.GetRejectReason(),
+                                 strprintf("tx %s: %s", ptr_tx->GetHash().ToString(), txState.GetDebugMessage()));
+        }
+    }
+    // the individual checks are authoritative, a failing batch without a failing TX is a bug in the batch verification
+    LogPrintf("%s -- ERROR: deferred ProTx signature checks failed but all individual checks passed, block=%s\n", __func__,
+              block.GetHash().ToString());
+    return true;
+}
+
 bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, llmq::CQuorumBlockProcessor& quorum_block_processor,
                               CValidationState& state, const CCoinsViewCache& view, bool fJustCheck, bool fCheckCbTxMerleRoots)
 {
@@ -112,17 +145,45 @@ bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, ll
 
         int64_t nTime1 = GetTimeMicros();
 
+        // Payload signatures only depend on the tx itself and on the list of the previous block, so they are verified
+        // in parallel while the checks which need the chain state keep running in order. The resulting state
+        // transitions are all applied sequentially below.
+        // BLS signatures of the whole block are collected and verified in one batch at the end.
+        const bool fParallelChecks = fCheckCbTxMerleRoots && g_parallel_script_checks;
+        CCheckQueueControl<CProTxSigCheck> control(fParallelChecks ? &specialtxcheckqueue : nullptr);
+        std::vector<CProTxSigCheck> vChecks;
+        std::vector<CProTxSigCheck> vBLSChecks;
+
         for (const auto& ptr_tx : block.vtx) {
-            if (!CheckSpecialTx(*ptr_tx, pindex->pprev, state, view, fCheckCbTxMerleRoots)) {
+            if (!CheckSpecialTx(*ptr_tx, pindex->pprev, state, view, fCheckCbTxMerleRoots, &vChecks)) {
                 // pass the state returned by the function above
                 return false;
             }
+            const auto itBLS = std::partition(vChecks.begin(), vChecks.end(), [](const auto& check) { return !check.IsBLS(); });
+            std::move(itBLS, vChecks.end(), std::back_inserter(vBLSChecks));
+            vChecks.erase(itBLS, vChecks.end());
+            if (fParallelChecks) {
+                control.Add(vChecks);
+            } else {
+                for (const auto& check : vChecks) {
+                    if (!check()) {
+                        return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-sig",
+                                             strprintf("tx %s", ptr_tx->GetHash().ToString()));
+                    }
+                }
+            }
+            vChecks.clear();
             if (!ProcessSpecialTx(*ptr_tx, pindex, state)) {
                 // pass the state returned by the function above
                 return false;
             }
         }
 
+        const bool fBLSValid = CProTxSigCheck::VerifyBLSBatch(vBLSChecks);
+        if ((!control.Wait() || !fBLSValid) && !FindInvalidProTxSig(block, pindex, state, view)) {
+            return false;
+        }
+
         int64_t nTime2 = GetTimeMicros();
         nTimeLoop += nTime2 - nTime1;
         LogPrint(BCLog::BENCHMARK, "        - Loop: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeLoop * 0.000001);
@@ -12,6 +12,7 @@
 class CBlock;
 class CBlockIndex;
 class CCoinsViewCache;
+class CProTxSigCheck;
 class CValidationState;
 namespace llmq {
 class CQuorumBlockProcessor;
@@ -19,9 +20,19 @@ class CQuorumBlockProcessor;
 
 extern CCriticalSection cs_main;
 
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, bool check_sigs) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, const CCoinsViewCache& view, bool check_sigs,
+                    std::vector<CProTxSigCheck>* pvChecks = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, llmq::CQuorumBlockProcessor& quorum_block_processor,
                               CValidationState& state, const CCoinsViewCache& view, bool fJustCheck, bool fCheckCbTxMerleRoots) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 bool UndoSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, llmq::CQuorumBlockProcessor& quorum_block_processor) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/** Maximum number of ProTx signature checking threads. Blocks carry only a few ProTxs and these are checked before the
+ * scripts, so a handful of threads is enough and the script checking threads are not duplicated */
+static const int MAX_SPECIALTXCHECK_THREADS = 3;
+
+/** Run instances of ProTx signature checking worker threads */
+void StartSpecialTxCheckWorkerThreads(int threads_num);
+/** Stop all of the ProTx signature checking worker threads */
+void StopSpecialTxCheckWorkerThreads();
+
 #endif // BITCOIN_EVO_SPECIALTXMAN_H
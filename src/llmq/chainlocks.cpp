@@ -12,14 +12,18 @@
 #include <chainparams.h>
 #include <consensus/validation.h>
 #include <masternode/sync.h>
+#include <memusage.h>
 #include <net_processing.h>
 #include <scheduler.h>
 #include <spork.h>
+#include <statsd_client.h>
 #include <txmempool.h>
 #include <ui_interface.h>
 #include <util/validation.h>
 #include <validation.h>
 
+#include <cxxtimer.hpp>
+
 namespace llmq
 {
 std::unique_ptr<CChainLocksHandler> chainLocksHandler;
@@ -303,13 +307,17 @@ void CChainLocksHandler::TrySignChainTip()
                 break;
             }
 
-            auto txids = GetBlockTxs(pindexWalk->GetBlockHash());
-            if (!txids) {
-                pindexWalk = pindexWalk->pprev;
-                continue;
-            }
+            // TXs which were already seen as islocked were removed from this list before, only the rest needs to be
+            // checked again
+            const auto txids = GetBlockTxsNotLocked(pindexWalk->GetBlockHash());
+            std::vector<uint256> lockedTxids;
+            bool fSafe{true};
+            for (const auto& txid : txids) {
+                if (quorumInstantSendManager->IsLocked(txid)) {
+                    lockedTxids.emplace_back(txid);
+                    continue;
+                }
 
-            for (const auto& txid : *txids) {
                 int64_t txAge = 0;
                 {
                     LOCK(cs);
@@ -319,12 +327,23 @@ void CChainLocksHandler::TrySignChainTip()
                     }
                 }
 
-                if (txAge < WAIT_FOR_ISLOCK_TIMEOUT && !quorumInstantSendManager->IsLocked(txid)) {
+                if (txAge < WAIT_FOR_ISLOCK_TIMEOUT) {
                     LogPrint(BCLog::CHAINLOCKS, "CChainLocksHandler::%s -- not signing block %s due to TX %s not being islocked and not old enough. age=%d\n", __func__,
                               pindexWalk->GetBlockHash().ToString(), txid.ToString(), txAge);
-                    return;
+                    fSafe = false;
+                    break;
+                }
+            }
+
+            if (!lockedTxids.empty()) {
+                LOCK(cs);
+                for (const auto& txid : lockedTxids) {
+                    blockTxsNotLocked.TxLocked(txid);
                 }
             }
+            if (!fSafe) {
+                return;
+            }
 
             pindexWalk = pindexWalk->pprev;
         }
@@ -354,7 +373,28 @@ void CChainLocksHandler::TransactionAddedToMempool(const CTransactionRef& tx, in
     }
 
     LOCK(cs);
-    txFirstSeenTime.emplace(tx->GetHash(), nAcceptTime);
+    AddTxFirstSeenTime(tx->GetHash(), nAcceptTime);
+}
+
+void CChainLocksHandler::TransactionLocked(const uint256& txid)
+{
+    bool fBlockGotSafe;
+    {
+        LOCK(cs);
+        fBlockGotSafe = blockTxsNotLocked.TxLocked(txid);
+    }
+    if (fBlockGotSafe) {
+        // don't wait for the next scheduled retry, this might have been the last TX which prevented us from signing
+        // the tip
+        UpdatedBlockTip();
+    }
+}
+
+void CChainLocksHandler::TransactionUnlocked(const uint256& txid)
+{
+    // the islock got removed (e.g. due to a conflict), so TrySignChainTip must check this TX again
+    LOCK(cs);
+    blockTxsNotLocked.TxUnlocked(txid);
 }
 
 void CChainLocksHandler::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex)
@@ -367,33 +407,56 @@ void CChainLocksHandler::BlockConnected(const std::shared_ptr<const CBlock>& pbl
     // We need this information later when we try to sign a new tip, so that we can determine if all included TXs are
     // safe.
 
+    std::vector<uint256> txids;
+    txids.reserve(pblock->vtx.size());
+    for (const auto& tx : pblock->vtx) {
+        if (tx->IsCoinBase() || tx->vin.empty()) {
+            continue;
+        }
+        txids.emplace_back(tx->GetHash());
+    }
+
     LOCK(cs);
 
-    auto it = blockTxs.find(pindex->GetBlockHash());
-    if (it == blockTxs.end()) {
-        // we must create this entry even if there are no lockable transactions in the block, so that TrySignChainTip
-        // later knows about this block
-        it = blockTxs.emplace(pindex->GetBlockHash(), std::make_shared<std::unordered_set<uint256, StaticSaltedHasher>>()).first;
+    // we must create this entry even if there are no lockable transactions in the block, so that TrySignChainTip
+    // later knows about this block
+    auto& blockTxids = blockTxs[pindex->GetBlockHash()];
+    if (blockTxids) {
+        txids.insert(txids.end(), blockTxids->begin(), blockTxids->end());
     }
-    auto& txids = *it->second;
+    std::sort(txids.begin(), txids.end());
+    txids.erase(std::unique(txids.begin(), txids.end()), txids.end());
 
-    int64_t curTime = GetAdjustedTime();
+    blockTxsNotLocked.AddBlock(pindex->GetBlockHash(), txids);
 
-    for (const auto& tx : pblock->vtx) {
-        if (tx->IsCoinBase() || tx->vin.empty()) {
-            continue;
-        }
+    int64_t curTime = GetAdjustedTime();
 
-        txids.emplace(tx->GetHash());
-        txFirstSeenTime.emplace(tx->GetHash(), curTime);
+    for (const auto& txid : txids) {
+        AddTxFirstSeenTime(txid, curTime);
     }
 
+    blockTxids = std::make_shared<const std::vector<uint256>>(std::move(txids));
+
+    // TXs of the block which just got its 6th confirmation don't need to be tracked anymore
+    const auto* pindexConfirmed = pindex->GetAncestor(pindex->nHeight - 6);
+    if (pindexConfirmed) {
+        auto it = blockTxs.find(pindexConfirmed->GetBlockHash());
+        if (it != blockTxs.end()) {
+            txRecheckQueue.ScheduleNow(*it->second);
+        }
+    }
 }
 
 void CChainLocksHandler::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected)
 {
     LOCK(cs);
-    blockTxs.erase(pindexDisconnected->GetBlockHash());
+    auto it = blockTxs.find(pindexDisconnected->GetBlockHash());
+    if (it != blockTxs.end()) {
+        // TXs of the disconnected block might vanish now, e.g. if they conflict with TXs of the new chain
+        txRecheckQueue.ScheduleNow(*it->second);
+        blockTxsNotLocked.RemoveBlock(it->first, *it->second);
+        blockTxs.erase(it);
+    }
 }
 
 CChainLocksHandler::BlockTxs::mapped_type CChainLocksHandler::GetBlockTxs(const uint256& blockHash)
@@ -425,13 +488,17 @@ CChainLocksHandler::BlockTxs::mapped_type CChainLocksHandler::GetBlockTxs(const
                 return nullptr;
             }
 
-            ret = std::make_shared<std::unordered_set<uint256, StaticSaltedHasher>>();
+            std::vector<uint256> txids;
+            txids.reserve(block.vtx.size());
             for (auto& tx : block.vtx) {
                 if (tx->IsCoinBase() || tx->vin.empty()) {
                     continue;
                 }
-                ret->emplace(tx->GetHash());
+                txids.emplace_back(tx->GetHash());
             }
+            std::sort(txids.begin(), txids.end());
+            txids.erase(std::unique(txids.begin(), txids.end()), txids.end());
+            ret = std::make_shared<const std::vector<uint256>>(std::move(txids));
 
             blockTime = block.nTime;
         }
@@ -439,12 +506,27 @@ CChainLocksHandler::BlockTxs::mapped_type CChainLocksHandler::GetBlockTxs(const
         LOCK(cs);
         blockTxs.emplace(blockHash, ret);
         for (const auto& txid : *ret) {
-            txFirstSeenTime.emplace(txid, blockTime);
+            AddTxFirstSeenTime(txid, blockTime);
         }
     }
     return ret;
 }
 
+std::vector<uint256> CChainLocksHandler::GetBlockTxsNotLocked(const uint256& blockHash)
+{
+    auto txids = GetBlockTxs(blockHash);
+    if (!txids) {
+        return {};
+    }
+
+    LOCK(cs);
+    // only initialized from blockTxs if we didn't see the block being connected (e.g. freshly started)
+    if (!blockTxsNotLocked.HasBlock(blockHash)) {
+        blockTxsNotLocked.AddBlock(blockHash, *txids);
+    }
+    return blockTxsNotLocked.GetTxs(blockHash);
+}
+
 bool CChainLocksHandler::IsTxSafeForMining(const CInstantSendManager& isman, const uint256& txid) const
 {
     if (!isman.RejectConflictingBlocks()) {
@@ -630,6 +712,8 @@ void CChainLocksHandler::Cleanup()
         }
     }
 
+    cxxtimer::Timer t(true);
+
     // need mempool.cs due to GetTransaction calls
     LOCK2(cs_main, mempool.cs);
     LOCK(cs);
@@ -648,33 +732,198 @@ void CChainLocksHandler::Cleanup()
             for (const auto& txid : *it->second) {
                 txFirstSeenTime.erase(txid);
             }
+            blockTxsNotLocked.RemoveBlock(it->first, *it->second);
             it = blockTxs.erase(it);
         } else if (InternalHasConflictingChainLock(pindex->nHeight, pindex->GetBlockHash())) {
+            blockTxsNotLocked.RemoveBlock(it->first, *it->second);
             it = blockTxs.erase(it);
         } else {
             ++it;
         }
     }
-    for (auto it = txFirstSeenTime.begin(); it != txFirstSeenTime.end(); ) {
+    const int64_t nNow = GetTime();
+    size_t nCheckedTxs{0};
+    for (const auto& txid : txRecheckQueue.PopDue(nNow)) {
+        if (txFirstSeenTime.count(txid) == 0) {
+            // already removed together with a ChainLocked block
+            continue;
+        }
+        nCheckedTxs++;
+
         uint256 hashBlock;
-        CTransactionRef tx = GetTransaction(/* block_index */ nullptr, &mempool, it->first, Params().GetConsensus(), hashBlock);
+        CTransactionRef tx = GetTransaction(/* block_index */ nullptr, &mempool, txid, Params().GetConsensus(), hashBlock);
         if (!tx) {
             // tx has vanished, probably due to conflicts
-            it = txFirstSeenTime.erase(it);
-        } else if (!hashBlock.IsNull()) {
+            txFirstSeenTime.erase(txid);
+            continue;
+        }
+        if (!hashBlock.IsNull()) {
             auto* pindex = LookupBlockIndex(hashBlock);
             if (::ChainActive().Tip()->GetAncestor(pindex->nHeight) == pindex && ::ChainActive().Height() - pindex->nHeight >= 6) {
                 // tx got confirmed >= 6 times, so we can stop keeping track of it
-                it = txFirstSeenTime.erase(it);
-            } else {
-                ++it;
+                txFirstSeenTime.erase(txid);
+                continue;
             }
-        } else {
-            ++it;
         }
+        txRecheckQueue.Schedule(txid, nNow);
     }
 
     lastCleanupTime = GetTimeMillis();
+
+    statsClient.timing("chainlocks.cleanup.timeMs", t.count(), 1.0f);
+    statsClient.count("chainlocks.cleanup.checkedTxs", nCheckedTxs, 1.0f);
+    statsClient.gauge("chainlocks.blockTxs", blockTxs.size(), 1.0f);
+    statsClient.gauge("chainlocks.txFirstSeenTime", txFirstSeenTime.size(), 1.0f);
+    statsClient.gauge("chainlocks.memoryUsageBytes", GetMemoryUsage(), 1.0f);
+}
+
+void CChainLocksHandler::AddTxFirstSeenTime(const uint256& txid, int64_t nTime)
+{
+    AssertLockHeld(cs);
+    if (txFirstSeenTime.emplace(txid, nTime).second) {
+        txRecheckQueue.Schedule(txid, GetTime());
+    }
+}
+
+size_t CChainLocksHandler::GetMemoryUsage() const
+{
+    AssertLockHeld(cs);
+    size_t nUsage = memusage::DynamicUsage(blockTxs) + memusage::DynamicUsage(txFirstSeenTime) + blockTxsNotLocked.GetMemoryUsage() + txRecheckQueue.GetMemoryUsage();
+    for (const auto& p : blockTxs) {
+        nUsage += memusage::DynamicUsage(p.second) + memusage::DynamicUsage(*p.second);
+    }
+    return nUsage;
+}
+
+void CTxRecheckQueue::Schedule(const uint256& txid, int64_t nNow)
+{
+    const int64_t nBucketTime = nNow / nBucketSize * nBucketSize;
+    auto it = txBucketTimes.find(txid);
+    if (it != txBucketTimes.end() && it->second == nBucketTime) {
+        return;
+    }
+    if (buckets.empty() || buckets.back().nTime < nBucketTime) {
+        buckets.emplace_back(Bucket{nBucketTime, {}});
+    }
+    // keep the buckets ordered if the clock went backwards
+    buckets.back().txids.emplace_back(txid);
+    txBucketTimes[txid] = buckets.back().nTime;
+}
+
+void CTxRecheckQueue::ScheduleNow(const std::vector<uint256>& txids)
+{
+    for (const auto& txid : txids) {
+        if (txBucketTimes.erase(txid) != 0) {
+            txidsDueNow.emplace_back(txid);
+        }
+    }
+}
+
+std::vector<uint256> CTxRecheckQueue::PopDue(int64_t nNow)
+{
+    std::vector<uint256> ret = std::move(txidsDueNow);
+    txidsDueNow.clear();
+    while (!buckets.empty() && buckets.front().nTime + nDelay <= nNow) {
+        const auto& bucket = buckets.front();
+        for (const auto& txid : bucket.txids) {
+            auto it = txBucketTimes.find(txid);
+            if (it == txBucketTimes.end() || it->second != bucket.nTime) {
+                // re-scheduled into another bucket or already made due in the meantime
+                continue;
+            }
+            txBucketTimes.erase(it);
+            ret.emplace_back(txid);
+        }
+        buckets.pop_front();
+    }
+    return ret;
+}
+
+size_t CTxRecheckQueue::GetMemoryUsage() const
+{
+    size_t nUsage = memusage::DynamicUsage(txBucketTimes) + memusage::DynamicUsage(txidsDueNow);
+    for (const auto& bucket : buckets) {
+        nUsage += sizeof(bucket) + memusage::DynamicUsage(bucket.txids);
+    }
+    return nUsage;
+}
+
+void CBlockTxsNotLocked::AddBlock(const uint256& blockHash, const std::vector<uint256>& txids)
+{
+    auto& txidsNotLocked = blockTxs[blockHash];
+    for (const auto& txid : txids) {
+        txidsNotLocked.emplace(txid);
+        auto& blocks = txBlocks[txid];
+        if (std::find(blocks.begin(), blocks.end(), blockHash) == blocks.end()) {
+            blocks.emplace_back(blockHash);
+        }
+    }
+}
+
+void CBlockTxsNotLocked::RemoveBlock(const uint256& blockHash, const std::vector<uint256>& txids)
+{
+    if (blockTxs.erase(blockHash) == 0) {
+        return;
+    }
+    for (const auto& txid : txids) {
+        auto it = txBlocks.find(txid);
+        if (it == txBlocks.end()) {
+            continue;
+        }
+        auto& blocks = it->second;
+        blocks.erase(std::remove(blocks.begin(), blocks.end(), blockHash), blocks.end());
+        if (blocks.empty()) {
+            txBlocks.erase(it);
+        }
+    }
+}
+
+std::vector<uint256> CBlockTxsNotLocked::GetTxs(const uint256& blockHash) const
+{
+    auto it = blockTxs.find(blockHash);
+    if (it == blockTxs.end()) {
+        return {};
+    }
+    return {it->second.begin(), it->second.end()};
+}
+
+bool CBlockTxsNotLocked::TxLocked(const uint256& txid)
+{
+    auto it = txBlocks.find(txid);
+    if (it == txBlocks.end()) {
+        return false;
+    }
+    bool fBlockGotSafe{false};
+    for (const auto& blockHash : it->second) {
+        auto& txids = blockTxs.at(blockHash);
+        if (txids.erase(txid) != 0 && txids.empty()) {
+            fBlockGotSafe = true;
+        }
+    }
+    return fBlockGotSafe;
+}
+
+void CBlockTxsNotLocked::TxUnlocked(const uint256& txid)
+{
+    auto it = txBlocks.find(txid);
+    if (it == txBlocks.end()) {
+        return;
+    }
+    for (const auto& blockHash : it->second) {
+        blockTxs.at(blockHash).emplace(txid);
+    }
+}
+
+size_t CBlockTxsNotLocked::GetMemoryUsage() const
+{
+    size_t nUsage = memusage::DynamicUsage(blockTxs) + memusage::DynamicUsage(txBlocks);
+    for (const auto& p : blockTxs) {
+        nUsage += memusage::DynamicUsage(p.second);
+    }
+    for (const auto& p : txBlocks) {
+        nUsage += memusage::DynamicUsage(p.second);
+    }
+    return nUsage;
 }
 
 bool AreChainLocksEnabled(const CSporkManager& sporkManager)
@@ -17,7 +17,9 @@
 #include <sync.h>
 
 #include <atomic>
+#include <deque>
 #include <unordered_set>
+#include <vector>
 
 class CConnman;
 class CBlockIndex;
@@ -32,11 +34,79 @@ class CInstantSendManager;
 class CSigningManager;
 class CSigSharesManager;
 
+// Keeps track of the TXs of recently connected blocks which were not islocked yet when we last looked. It is indexed
+// by block and by txid, so that a new (or removed) islock only has to touch the blocks which actually include the TX
+class CBlockTxsNotLocked
+{
+private:
+    std::unordered_map<uint256, std::unordered_set<uint256, StaticSaltedHasher>, StaticSaltedHasher> blockTxs;
+    // all TXs of the tracked blocks (including the already locked ones), mapped to the blocks including them
+    std::unordered_map<uint256, std::vector<uint256>, StaticSaltedHasher> txBlocks;
+
+public:
+    bool HasBlock(const uint256& blockHash) const { return blockTxs.count(blockHash) != 0; }
+    size_t GetBlockCount() const { return blockTxs.size(); }
+
+    // (re-)adds all TXs of the block as not locked
+    void AddBlock(const uint256& blockHash, const std::vector<uint256>& txids);
+    // txids must contain all TXs the block was added with
+    void RemoveBlock(const uint256& blockHash, const std::vector<uint256>& txids);
+    std::vector<uint256> GetTxs(const uint256& blockHash) const;
+
+    // returns true if this was the last not yet islocked TX of a block
+    bool TxLocked(const uint256& txid);
+    // marks the TX as not locked again in all tracked blocks including it, e.g. after its islock got removed
+    void TxUnlocked(const uint256& txid);
+
+    size_t GetMemoryUsage() const;
+};
+
+// Schedules tracked TXs for being rechecked after a delay. TXs are grouped into buckets of nBucketSize seconds, so that
+// only the expired buckets have to be looked at instead of all tracked TXs. Each TX is scheduled at most once, entries
+// made stale by re-scheduling a TX are dropped when their bucket expires
+class CTxRecheckQueue
+{
+private:
+    struct Bucket
+    {
+        int64_t nTime;
+        std::vector<uint256> txids;
+    };
+
+    const int64_t nDelay;
+    const int64_t nBucketSize;
+    // Ordered by time
+    std::deque<Bucket> buckets;
+    // the bucket each scheduled TX currently belongs to
+    std::unordered_map<uint256, int64_t, StaticSaltedHasher> txBucketTimes;
+    // TXs which are returned by the next PopDue call, independent of their bucket
+    std::vector<uint256> txidsDueNow;
+
+public:
+    CTxRecheckQueue(int64_t _nDelay, int64_t _nBucketSize) : nDelay(_nDelay), nBucketSize(_nBucketSize) {}
+
+    void Schedule(const uint256& txid, int64_t nNow);
+    // makes already scheduled TXs due on the next PopDue call, TXs which are not scheduled are ignored
+    void ScheduleNow(const std::vector<uint256>& txids);
+    // Removes and returns all TXs which are due at nNow. TXs which should be checked again must be re-scheduled
+    std::vector<uint256> PopDue(int64_t nNow);
+
+    size_t GetScheduledCount() const { return txBucketTimes.size() + txidsDueNow.size(); }
+    size_t GetBucketCount() const { return buckets.size(); }
+    size_t GetMemoryUsage() const;
+};
+
 class CChainLocksHandler : public CRecoveredSigsListener
 {
     static constexpr int64_t CLEANUP_INTERVAL = 1000 * 30;
     static constexpr int64_t CLEANUP_SEEN_TIMEOUT = 24 * 60 * 60 * 1000;
 
+    // TXs in txFirstSeenTime are checked for having vanished or being deeply confirmed this long after they were added
+    // or last checked. TXs of disconnected blocks and of blocks which just got 6 confirmations are rechecked on the
+    // next Cleanup instead
+    static constexpr int64_t TX_RECHECK_DELAY = 2 * 60;
+    static constexpr int64_t TX_RECHECK_BUCKET_SIZE = 30;
+
     // how long to wait for islocks until we consider a block with non-islocked TXs to be safe to sign
     static constexpr int64_t WAIT_FOR_ISLOCK_TIMEOUT = 10 * 60;
 
@@ -70,9 +140,15 @@ private:
     {
         size_t operator()(const uint256& hash) const { return ReadLE64(hash.begin()); }
     };
-    using BlockTxs = std::unordered_map<uint256, std::shared_ptr<std::unordered_set<uint256, StaticSaltedHasher>>, BlockHasher>;
+    // txids are stored as sorted vectors, these are never modified after being created
+    using BlockTxs = std::unordered_map<uint256, std::shared_ptr<const std::vector<uint256>>, BlockHasher>;
     BlockTxs blockTxs GUARDED_BY(cs);
     std::unordered_map<uint256, int64_t, StaticSaltedHasher> txFirstSeenTime GUARDED_BY(cs);
+    // Might contain txids which were removed from txFirstSeenTime in the meantime
+    CTxRecheckQueue txRecheckQueue GUARDED_BY(cs) {TX_RECHECK_DELAY, TX_RECHECK_BUCKET_SIZE};
+    // Subset of blockTxs which was not islocked yet when we last looked. It shrinks as islocks arrive, so that
+    // TrySignChainTip only has to re-check the remaining TXs and signing can be triggered as soon as a block got safe
+    CBlockTxsNotLocked blockTxsNotLocked GUARDED_BY(cs);
 
     std::map<uint256, int64_t> seenChainLocks GUARDED_BY(cs);
 
@@ -94,6 +170,8 @@ public:
     void AcceptedBlockHeader(const CBlockIndex* pindexNew);
     void UpdatedBlockTip();
     void TransactionAddedToMempool(const CTransactionRef& tx, int64_t nAcceptTime);
+    void TransactionLocked(const uint256& txid);
+    void TransactionUnlocked(const uint256& txid);
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex);
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected);
     void CheckActiveState();
@@ -111,7 +189,11 @@ private:
     bool InternalHasChainLock(int nHeight, const uint256& blockHash) const EXCLUSIVE_LOCKS_REQUIRED(cs);
     bool InternalHasConflictingChainLock(int nHeight, const uint256& blockHash) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    void AddTxFirstSeenTime(const uint256& txid, int64_t nTime) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    size_t GetMemoryUsage() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     BlockTxs::mapped_type GetBlockTxs(const uint256& blockHash);
+    std::vector<uint256> GetBlockTxsNotLocked(const uint256& blockHash);
 
     void Cleanup();
 };
@@ -11,12 +11,14 @@
 #include <llmq/signing_shares.h>
 
 #include <bls/bls_batchverifier.h>
+#include <bls/bls_worker.h>
 #include <chainparams.h>
 #include <consensus/validation.h>
 #include <index/txindex.h>
 #include <masternode/sync.h>
 #include <net_processing.h>
 #include <spork.h>
+#include <statsd_client.h>
 #include <txmempool.h>
 #include <util/irange.h>
 #include <util/ranges.h>
@@ -57,10 +59,130 @@ uint256 CInstantSendLock::GetRequestId() const
 ////////////////
 
 
+CInstantSendKeyFilter::CInstantSendKeyFilter() :
+    k0(GetRand(std::numeric_limits<uint64_t>::max())),
+    k1(GetRand(std::numeric_limits<uint64_t>::max()))
+{
+    Reset(MIN_CAPACITY);
+}
+
+void CInstantSendKeyFilter::Reset(size_t capacity)
+{
+    nCapacity = std::max(capacity, MIN_CAPACITY);
+    bits.assign((nCapacity * BITS_PER_ELEMENT + 63) / 64, 0);
+    nInserted = 0;
+    nRemoved = 0;
+}
+
+// The bit positions are derived from the two halves of the salted hash (double hashing)
+void CInstantSendKeyFilter::Insert(uint64_t hash)
+{
+    const uint64_t nBits = bits.size() * 64;
+    const uint64_t h1 = hash & 0xffffffff;
+    const uint64_t h2 = (hash >> 32) | 1;
+    for (size_t i = 0; i < HASH_FUNCS; i++) {
+        const uint64_t pos = (h1 + i * h2) % nBits;
+        bits[pos / 64] |= uint64_t{1} << (pos % 64);
+    }
+    nInserted++;
+}
+
+bool CInstantSendKeyFilter::MayContain(uint64_t hash) const
+{
+    const uint64_t nBits = bits.size() * 64;
+    const uint64_t h1 = hash & 0xffffffff;
+    const uint64_t h2 = (hash >> 32) | 1;
+    for (size_t i = 0; i < HASH_FUNCS; i++) {
+        const uint64_t pos = (h1 + i * h2) % nBits;
+        if (!(bits[pos / 64] & (uint64_t{1} << (pos % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CInstantSendDb::RebuildKeyFilter()
+{
+    AssertLockHeld(cs_db);
+    cxxtimer::Timer t(true);
+
+    std::vector<uint256> txids;
+    std::vector<COutPoint> outpoints;
+
+    auto it = dbTransaction.NewIteratorUniquePtr();
+    auto firstTxidKey = std::make_tuple(DB_HASH_BY_TXID, uint256());
+    it->Seek(firstTxidKey);
+    while (it->Valid()) {
+        decltype(firstTxidKey) curKey;
+        if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_HASH_BY_TXID) {
+            break;
+        }
+        txids.emplace_back(std::get<1>(curKey));
+        it->Next();
+    }
+
+    auto firstOutpointKey = std::make_tuple(DB_HASH_BY_OUTPOINT, COutPoint());
+    it->Seek(firstOutpointKey);
+    while (it->Valid()) {
+        decltype(firstOutpointKey) curKey;
+        if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_HASH_BY_OUTPOINT) {
+            break;
+        }
+        outpoints.emplace_back(std::get<1>(curKey));
+        it->Next();
+    }
+
+    // leave room for as many new keys as there are now, so that rebuilds don't happen too often
+    keyFilter.Reset(2 * (txids.size() + outpoints.size()));
+    for (const auto& txid : txids) {
+        keyFilter.Insert(txid);
+    }
+    for (const auto& outpoint : outpoints) {
+        keyFilter.Insert(outpoint);
+    }
+
+    LogPrint(BCLog::INSTANTSEND, "CInstantSendDb::%s -- rebuilt key filter. txids=%d, outpoints=%d, time=%d\n", __func__,
+             txids.size(), outpoints.size(), t.count());
+}
+
+void CInstantSendDb::Flush()
+{
+    LOCK(cs_db);
+    FlushInternal();
+}
+
+void CInstantSendDb::FlushInternal()
+{
+    AssertLockHeld(cs_db);
+    nLastFlushTime = GetTime();
+    if (dbTransaction.IsClean()) {
+        return;
+    }
+
+    cxxtimer::Timer t(true);
+    const size_t memoryUsage = dbTransaction.GetMemoryUsage();
+    dbTransaction.Commit();
+    db->WriteBatch(rootBatch);
+    rootBatch.Clear();
+    statsClient.timing("instantsend.db.flushTimeMs", t.count(), 1.0f);
+
+    LogPrint(BCLog::INSTANTSEND, "CInstantSendDb::%s -- flushed %d bytes, time=%d\n", __func__, memoryUsage, t.count());
+}
+
+void CInstantSendDb::FlushIfNeeded()
+{
+    AssertLockHeld(cs_db);
+    if (dbTransaction.GetMemoryUsage() >= MAX_PENDING_MEMORY || GetTime() - nLastFlushTime >= FLUSH_INTERVAL) {
+        FlushInternal();
+    }
+}
+
 void CInstantSendDb::Upgrade(const CTxMemPool& mempool)
 {
     LOCK2(cs_main, mempool.cs);
     LOCK(cs_db);
+    // the upgrade works on db directly
+    FlushInternal();
     int v{0};
     if (!db->Read(DB_VERSION, v) || v < CInstantSendDb::CURRENT_VERSION) {
         CDBBatch batch(*db);
@@ -95,13 +217,20 @@ void CInstantSendDb::Upgrade(const CTxMemPool& mempool)
 void CInstantSendDb::WriteNewInstantSendLock(const uint256& hash, const CInstantSendLock& islock)
 {
     LOCK(cs_db);
-    CDBBatch batch(*db);
-    batch.Write(std::make_tuple(DB_ISLOCK_BY_HASH, hash), islock);
-    batch.Write(std::make_tuple(DB_HASH_BY_TXID, islock.txid), hash);
+    dbTransaction.Write(std::make_tuple(DB_ISLOCK_BY_HASH, hash), islock);
+    dbTransaction.Write(std::make_tuple(DB_HASH_BY_TXID, islock.txid), hash);
     for (const auto& in : islock.inputs) {
-        batch.Write(std::make_tuple(DB_HASH_BY_OUTPOINT, in), hash);
+        dbTransaction.Write(std::make_tuple(DB_HASH_BY_OUTPOINT, in), hash);
+    }
+
+    if (keyFilter.NeedsRebuild()) {
+        RebuildKeyFilter();
+    } else {
+        keyFilter.Insert(islock.txid);
+        for (const auto& in : islock.inputs) {
+            keyFilter.Insert(in);
+        }
     }
-    db->WriteBatch(batch);
 
     auto p = std::make_shared<CInstantSendLock>(islock);
     islockCache.insert(hash, p);
@@ -109,9 +238,11 @@ void CInstantSendDb::WriteNewInstantSendLock(const uint256& hash, const CInstant
     for (const auto& in : islock.inputs) {
         outpointCache.insert(in, hash);
     }
+
+    FlushIfNeeded();
 }
 
-void CInstantSendDb::RemoveInstantSendLock(CDBBatch& batch, const uint256& hash, CInstantSendLockPtr islock, bool keep_cache)
+void CInstantSendDb::RemoveInstantSendLock(DbTransaction& batch, const uint256& hash, CInstantSendLockPtr islock, bool keep_cache)
 {
     AssertLockHeld(cs_db);
     if (!islock) {
@@ -126,6 +257,7 @@ void CInstantSendDb::RemoveInstantSendLock(CDBBatch& batch, const uint256& hash,
     for (auto& in : islock->inputs) {
         batch.Erase(std::make_tuple(DB_HASH_BY_OUTPOINT, in));
     }
+    keyFilter.Removed(1 + islock->inputs.size());
 
     if (!keep_cache) {
         islockCache.erase(hash);
@@ -144,24 +276,23 @@ static std::tuple<std::string, uint32_t, uint256> BuildInversedISLockKey(const s
 void CInstantSendDb::WriteInstantSendLockMined(const uint256& hash, int nHeight)
 {
     LOCK(cs_db);
-    CDBBatch batch(*db);
-    WriteInstantSendLockMined(batch, hash, nHeight);
-    db->WriteBatch(batch);
+    WriteInstantSendLockMined(dbTransaction, hash, nHeight);
+    FlushIfNeeded();
 }
 
-void CInstantSendDb::WriteInstantSendLockMined(CDBBatch& batch, const uint256& hash, int nHeight)
+void CInstantSendDb::WriteInstantSendLockMined(DbTransaction& batch, const uint256& hash, int nHeight)
 {
     AssertLockHeld(cs_db);
     batch.Write(BuildInversedISLockKey(DB_MINED_BY_HEIGHT_AND_HASH, nHeight, hash), true);
 }
 
-void CInstantSendDb::RemoveInstantSendLockMined(CDBBatch& batch, const uint256& hash, int nHeight)
+void CInstantSendDb::RemoveInstantSendLockMined(DbTransaction& batch, const uint256& hash, int nHeight)
 {
     AssertLockHeld(cs_db);
     batch.Erase(BuildInversedISLockKey(DB_MINED_BY_HEIGHT_AND_HASH, nHeight, hash));
 }
 
-void CInstantSendDb::WriteInstantSendLockArchived(CDBBatch& batch, const uint256& hash, int nHeight)
+void CInstantSendDb::WriteInstantSendLockArchived(DbTransaction& batch, const uint256& hash, int nHeight)
 {
     AssertLockHeld(cs_db);
     batch.Write(BuildInversedISLockKey(DB_ARCHIVED_BY_HEIGHT_AND_HASH, nHeight, hash), true);
@@ -178,14 +309,14 @@ std::unordered_map<uint256, CInstantSendLockPtr, StaticSaltedHasher> CInstantSen
     }
     best_confirmed_height = nUntilHeight;
 
-    auto it = std::unique_ptr<CDBIterator>(db->NewIterator());
+    auto it = dbTransaction.NewIteratorUniquePtr();
 
     auto firstKey = BuildInversedISLockKey(DB_MINED_BY_HEIGHT_AND_HASH, nUntilHeight, uint256());
 
     it->Seek(firstKey);
 
-    CDBBatch batch(*db);
-    std::unordered_map<uint256, CInstantSendLockPtr, StaticSaltedHasher> ret;
+    // dbTransaction must not be modified while iterating it
+    std::vector<decltype(firstKey)> minedKeys;
     while (it->Valid()) {
         decltype(firstKey) curKey;
         if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_MINED_BY_HEIGHT_AND_HASH) {
@@ -195,23 +326,29 @@ std::unordered_map<uint256, CInstantSendLockPtr, StaticSaltedHasher> CInstantSen
         if (nHeight > uint32_t(nUntilHeight)) {
             break;
         }
+        minedKeys.emplace_back(curKey);
+
+        it->Next();
+    }
+    it.reset();
 
+    std::unordered_map<uint256, CInstantSendLockPtr, StaticSaltedHasher> ret;
+    for (const auto& curKey : minedKeys) {
+        uint32_t nHeight = std::numeric_limits<uint32_t>::max() - be32toh(std::get<1>(curKey));
         auto& islockHash = std::get<2>(curKey);
         auto islock = GetInstantSendLockByHashInternal(islockHash, false);
         if (islock) {
-            RemoveInstantSendLock(batch, islockHash, islock);
+            RemoveInstantSendLock(dbTransaction, islockHash, islock);
             ret.emplace(islockHash, islock);
         }
 
         // archive the islock hash, so that we're still able to check if we've seen the islock in the past
-        WriteInstantSendLockArchived(batch, islockHash, nHeight);
-
-        batch.Erase(curKey);
+        WriteInstantSendLockArchived(dbTransaction, islockHash, nHeight);
 
-        it->Next();
+        dbTransaction.Erase(curKey);
     }
 
-    db->WriteBatch(batch);
+    FlushIfNeeded();
 
     return ret;
 }
@@ -223,13 +360,14 @@ void CInstantSendDb::RemoveArchivedInstantSendLocks(int nUntilHeight)
         return;
     }
 
-    auto it = std::unique_ptr<CDBIterator>(db->NewIterator());
+    auto it = dbTransaction.NewIteratorUniquePtr();
 
     auto firstKey = BuildInversedISLockKey(DB_ARCHIVED_BY_HEIGHT_AND_HASH, nUntilHeight, uint256());
 
     it->Seek(firstKey);
 
-    CDBBatch batch(*db);
+    // dbTransaction must not be modified while iterating it
+    std::vector<decltype(firstKey)> archivedKeys;
     while (it->Valid()) {
         decltype(firstKey) curKey;
         if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_ARCHIVED_BY_HEIGHT_AND_HASH) {
@@ -239,21 +377,23 @@ void CInstantSendDb::RemoveArchivedInstantSendLocks(int nUntilHeight)
         if (nHeight > uint32_t(nUntilHeight)) {
             break;
         }
-
-        auto& islockHash = std::get<2>(curKey);
-        batch.Erase(std::make_tuple(DB_ARCHIVED_BY_HASH, islockHash));
-        batch.Erase(curKey);
+        archivedKeys.emplace_back(curKey);
 
         it->Next();
     }
+    it.reset();
 
-    db->WriteBatch(batch);
+    for (const auto& curKey : archivedKeys) {
+        dbTransaction.Erase(std::make_tuple(DB_ARCHIVED_BY_HASH, std::get<2>(curKey)));
+        dbTransaction.Erase(curKey);
+    }
+
+    FlushIfNeeded();
 }
 
 void CInstantSendDb::WriteBlockInstantSendLocks(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected)
 {
     LOCK(cs_db);
-    CDBBatch batch(*db);
     for (const auto& tx : pblock->vtx) {
         if (tx->IsCoinBase() || tx->vin.empty()) {
             // coinbase and TXs with no inputs can't be locked
@@ -262,16 +402,15 @@ void CInstantSendDb::WriteBlockInstantSendLocks(const std::shared_ptr<const CBlo
         uint256 islockHash = GetInstantSendLockHashByTxidInternal(tx->GetHash());
         // update DB about when an IS lock was mined
         if (!islockHash.IsNull()) {
-            WriteInstantSendLockMined(batch, islockHash, pindexConnected->nHeight);
+            WriteInstantSendLockMined(dbTransaction, islockHash, pindexConnected->nHeight);
         }
     }
-    db->WriteBatch(batch);
+    FlushIfNeeded();
 }
 
 void CInstantSendDb::RemoveBlockInstantSendLocks(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected)
 {
     LOCK(cs_db);
-    CDBBatch batch(*db);
     for (const auto& tx : pblock->vtx) {
         if (tx->IsCoinBase() || tx->vin.empty()) {
             // coinbase and TXs with no inputs can't be locked
@@ -279,22 +418,22 @@ void CInstantSendDb::RemoveBlockInstantSendLocks(const std::shared_ptr<const CBl
         }
         uint256 islockHash = GetInstantSendLockHashByTxidInternal(tx->GetHash());
         if (!islockHash.IsNull()) {
-            RemoveInstantSendLockMined(batch, islockHash, pindexDisconnected->nHeight);
+            RemoveInstantSendLockMined(dbTransaction, islockHash, pindexDisconnected->nHeight);
         }
     }
-    db->WriteBatch(batch);
+    FlushIfNeeded();
 }
 
 bool CInstantSendDb::KnownInstantSendLock(const uint256& islockHash) const
 {
     LOCK(cs_db);
-    return GetInstantSendLockByHashInternal(islockHash) != nullptr || db->Exists(std::make_tuple(DB_ARCHIVED_BY_HASH, islockHash));
+    return GetInstantSendLockByHashInternal(islockHash) != nullptr || dbTransaction.Exists(std::make_tuple(DB_ARCHIVED_BY_HASH, islockHash));
 }
 
 size_t CInstantSendDb::GetInstantSendLockCount() const
 {
     LOCK(cs_db);
-    auto it = std::unique_ptr<CDBIterator>(db->NewIterator());
+    auto it = dbTransaction.NewIteratorUniquePtr();
     auto firstKey = std::make_tuple(DB_ISLOCK_BY_HASH, uint256());
 
     it->Seek(firstKey);
@@ -327,10 +466,10 @@ CInstantSendLockPtr CInstantSendDb::GetInstantSendLockByHashInternal(const uint2
     }
 
     ret = std::make_shared<CInstantSendLock>(CInstantSendLock::isdlock_version);
-    bool exists = db->Read(std::make_tuple(DB_ISLOCK_BY_HASH, hash), *ret);
+    bool exists = dbTransaction.Read(std::make_tuple(DB_ISLOCK_BY_HASH, hash), *ret);
     if (!exists || (::SerializeHash(*ret) != hash)) {
         ret = std::make_shared<CInstantSendLock>();
-        exists = db->Read(std::make_tuple(DB_ISLOCK_BY_HASH, hash), *ret);
+        exists = dbTransaction.Read(std::make_tuple(DB_ISLOCK_BY_HASH, hash), *ret);
         if (!exists || (::SerializeHash(*ret) != hash)) {
             ret = nullptr;
         }
@@ -344,7 +483,7 @@ uint256 CInstantSendDb::GetInstantSendLockHashByTxidInternal(const uint256& txid
     AssertLockHeld(cs_db);
     uint256 islockHash;
     if (!txidCache.get(txid, islockHash)) {
-        if (!db->Read(std::make_tuple(DB_HASH_BY_TXID, txid), islockHash)) {
+        if (!keyFilter.MayContain(txid) || !dbTransaction.Read(std::make_tuple(DB_HASH_BY_TXID, txid), islockHash)) {
             return {};
         }
         txidCache.insert(txid, islockHash);
@@ -363,7 +502,7 @@ CInstantSendLockPtr CInstantSendDb::GetInstantSendLockByInput(const COutPoint& o
     LOCK(cs_db);
     uint256 islockHash;
     if (!outpointCache.get(outpoint, islockHash)) {
-        if (!db->Read(std::make_tuple(DB_HASH_BY_OUTPOINT, outpoint), islockHash)) {
+        if (!keyFilter.MayContain(outpoint) || !dbTransaction.Read(std::make_tuple(DB_HASH_BY_OUTPOINT, outpoint), islockHash)) {
             return nullptr;
         }
         outpointCache.insert(outpoint, islockHash);
@@ -374,7 +513,7 @@ CInstantSendLockPtr CInstantSendDb::GetInstantSendLockByInput(const COutPoint& o
 std::vector<uint256> CInstantSendDb::GetInstantSendLocksByParent(const uint256& parent) const
 {
     AssertLockHeld(cs_db);
-    auto it = std::unique_ptr<CDBIterator>(db->NewIterator());
+    auto it = dbTransaction.NewIteratorUniquePtr();
     auto firstKey = std::make_tuple(DB_HASH_BY_OUTPOINT, COutPoint(parent, 0));
     it->Seek(firstKey);
 
@@ -401,7 +540,7 @@ std::vector<uint256> CInstantSendDb::GetInstantSendLocksByParent(const uint256&
     return result;
 }
 
-std::vector<uint256> CInstantSendDb::RemoveChainedInstantSendLocks(const uint256& islockHash, const uint256& txid, int nHeight)
+std::vector<uint256> CInstantSendDb::RemoveChainedInstantSendLocks(const uint256& islockHash, const uint256& txid, int nHeight, std::vector<uint256>& removedTxidsRet)
 {
     LOCK(cs_db);
     std::vector<uint256> result;
@@ -410,7 +549,6 @@ std::vector<uint256> CInstantSendDb::RemoveChainedInstantSendLocks(const uint256
     std::unordered_set<uint256, StaticSaltedHasher> added;
     stack.emplace_back(txid);
 
-    CDBBatch batch(*db);
     while (!stack.empty()) {
         auto children = GetInstantSendLocksByParent(stack.back());
         stack.pop_back();
@@ -421,9 +559,10 @@ std::vector<uint256> CInstantSendDb::RemoveChainedInstantSendLocks(const uint256
                 continue;
             }
 
-            RemoveInstantSendLock(batch, childIslockHash, childIsLock, false);
-            WriteInstantSendLockArchived(batch, childIslockHash, nHeight);
+            RemoveInstantSendLock(dbTransaction, childIslockHash, childIsLock, false);
+            WriteInstantSendLockArchived(dbTransaction, childIslockHash, nHeight);
             result.emplace_back(childIslockHash);
+            removedTxidsRet.emplace_back(childIsLock->txid);
 
             if (added.emplace(childIsLock->txid).second) {
                 stack.emplace_back(childIsLock->txid);
@@ -431,11 +570,12 @@ std::vector<uint256> CInstantSendDb::RemoveChainedInstantSendLocks(const uint256
         }
     }
 
-    RemoveInstantSendLock(batch, islockHash, nullptr, false);
-    WriteInstantSendLockArchived(batch, islockHash, nHeight);
+    RemoveInstantSendLock(dbTransaction, islockHash, nullptr, false);
+    WriteInstantSendLockArchived(dbTransaction, islockHash, nHeight);
     result.emplace_back(islockHash);
+    removedTxidsRet.emplace_back(txid);
 
-    db->WriteBatch(batch);
+    FlushIfNeeded();
 
     return result;
 }
@@ -444,11 +584,10 @@ void CInstantSendDb::RemoveAndArchiveInstantSendLock(const CInstantSendLockPtr&
 {
     LOCK(cs_db);
 
-    CDBBatch batch(*db);
     const auto hash = ::SerializeHash(*islock);
-    RemoveInstantSendLock(batch, hash, islock, false);
-    WriteInstantSendLockArchived(batch, hash, nHeight);
-    db->WriteBatch(batch);
+    RemoveInstantSendLock(dbTransaction, hash, islock, false);
+    WriteInstantSendLockArchived(dbTransaction, hash, nHeight);
+    FlushIfNeeded();
 }
 
 ////////////////
@@ -477,6 +616,8 @@ void CInstantSendManager::Stop()
     if (workThread.joinable()) {
         workThread.join();
     }
+
+    db.Flush();
 }
 
 void CInstantSendManager::ProcessTx(const CTransaction& tx, bool fRetroactive, const Consensus::Params& params)
@@ -762,6 +903,7 @@ void CInstantSendManager::HandleNewInstantSendLockRecoveredSig(const llmq::CReco
     }
     LOCK(cs_pendingLocks);
     pendingInstantSendLocks.emplace(hash, std::make_pair(-1, islock));
+    workInterrupt.wakeup();
 }
 
 void CInstantSendManager::ProcessMessage(const CNode& pfrom, const std::string& msg_type, CDataStream& vRecv)
@@ -830,6 +972,8 @@ void CInstantSendManager::ProcessMessageInstantSendLock(const CNode& pfrom, cons
 
     LOCK(cs_pendingLocks);
     pendingInstantSendLocks.emplace(hash, std::make_pair(pfrom.GetId(), islock));
+    pendingInstantSendLocksTime.emplace(hash, GetTimeMillis());
+    workInterrupt.wakeup();
 }
 
 /**
@@ -899,8 +1043,13 @@ bool CInstantSendManager::ProcessPendingInstantSendLocks(bool deterministic)
             removed.emplace_back(islockHash);
         }
 
+        const int64_t nNow = GetTimeMillis();
         for (const auto& islockHash : removed) {
             pendingInstantSendLocks.erase(islockHash);
+            if (auto it = pendingInstantSendLocksTime.find(islockHash); it != pendingInstantSendLocksTime.end()) {
+                statsClient.timing("instantsend.islocks.queueLatencyMs", nNow - it->second, 1.0f);
+                pendingInstantSendLocksTime.erase(it);
+            }
         }
     }
 
@@ -915,21 +1064,58 @@ bool CInstantSendManager::ProcessPendingInstantSendLocks(bool deterministic)
     const auto& llmq_params = llmq_params_opt.value();
     auto dkgInterval = llmq_params.dkgInterval;
 
-    // First check against the current active set and don't ban
-    auto badISLocks = ProcessPendingInstantSendLocks(llmq_params, 0, pend, false);
-    if (!badISLocks.empty()) {
+    // returns the peers which sent islocks that are invalid for the current and the previous active set
+    auto verifyAndProcess = [&](decltype(pend)& locks) {
+        std::set<NodeId> badSources;
+        // First check against the current active set and don't ban
+        auto badISLocks = ProcessPendingInstantSendLocks(llmq_params, 0, locks, false);
+        if (badISLocks.empty()) {
+            return badSources;
+        }
         LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- doing verification on old active set\n", __func__);
 
-        // filter out valid IS locks from "pend"
-        for (auto it = pend.begin(); it != pend.end(); ) {
+        // filter out valid IS locks from "locks"
+        for (auto it = locks.begin(); it != locks.end(); ) {
             if (!badISLocks.count(it->first)) {
-                it = pend.erase(it);
+                it = locks.erase(it);
             } else {
                 ++it;
             }
         }
         // Now check against the previous active set and perform banning if this fails
-        ProcessPendingInstantSendLocks(llmq_params, dkgInterval, pend, true);
+        for (const auto& hash : ProcessPendingInstantSendLocks(llmq_params, dkgInterval, locks, true)) {
+            badSources.emplace(locks.at(hash).first);
+        }
+        return badSources;
+    };
+
+    // Verify only the first few islocks of each peer in the first round. Peers which turn out to send invalid islocks
+    // are misbehaving and their remaining islocks are dropped unverified, so that they can't make us bisect batches
+    // full of invalid islocks
+    const size_t maxEarlyCountPerSource = 4;
+    decltype(pend) pendLater;
+    std::map<NodeId, size_t> countPerSource;
+    for (auto it = pend.begin(); it != pend.end(); ) {
+        if (++countPerSource[it->second.first] > maxEarlyCountPerSource) {
+            pendLater.emplace(it->first, std::move(it->second));
+            it = pend.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    const auto badSources = verifyAndProcess(pend);
+    if (!pendLater.empty()) {
+        for (auto it = pendLater.begin(); it != pendLater.end(); ) {
+            if (badSources.count(it->second.first)) {
+                LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- txid=%s, islock=%s: dropping islock from misbehaving peer=%d\n", __func__,
+                         it->second.second->txid.ToString(), it->first.ToString(), it->second.first);
+                it = pendLater.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        verifyAndProcess(pendLater);
     }
 
     return fMoreWork;
@@ -937,7 +1123,14 @@ bool CInstantSendManager::ProcessPendingInstantSendLocks(bool deterministic)
 
 std::unordered_set<uint256, StaticSaltedHasher> CInstantSendManager::ProcessPendingInstantSendLocks(const Consensus::LLMQParams& llmq_params, int signOffset, const std::unordered_map<uint256, std::pair<NodeId, CInstantSendLockPtr>, StaticSaltedHasher>& pend, bool ban)
 {
-    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, true, 8);
+    // islocks are partitioned by the quorum which signed them and the partitions are verified in parallel. Bad islocks
+    // are found by bisecting the partition they are in (see CBLSBatchVerifier)
+    using BatchVerifier = CBLSBatchVerifier<NodeId, uint256>;
+    std::unordered_map<uint256, BatchVerifier, StaticSaltedHasher> batchVerifiers;
+    std::set<NodeId> badSources;
+    // also contains the islocks which were skipped because their peer was already known to be bad
+    std::set<uint256> badMessages;
+    std::set<NodeId> sources;
     std::unordered_map<uint256, CRecoveredSig, StaticSaltedHasher> recSigs;
 
     size_t verifyCount = 0;
@@ -947,12 +1140,14 @@ std::unordered_set<uint256, StaticSaltedHasher> CInstantSendManager::ProcessPend
         auto nodeId = p.second.first;
         const auto& islock = p.second.second;
 
-        if (batchVerifier.badSources.count(nodeId)) {
+        if (badSources.count(nodeId)) {
+            badMessages.emplace(hash);
             continue;
         }
 
         if (!islock->sig.Get().IsValid()) {
-            batchVerifier.badSources.emplace(nodeId);
+            badSources.emplace(nodeId);
+            badMessages.emplace(hash);
             continue;
         }
 
@@ -970,7 +1165,8 @@ std::unordered_set<uint256, StaticSaltedHasher> CInstantSendManager::ProcessPend
 
             const auto blockIndex = LookupBlockIndex(islock->cycleHash);
             if (blockIndex == nullptr) {
-                batchVerifier.badSources.emplace(nodeId);
+                badSources.emplace(nodeId);
+                badMessages.emplace(hash);
                 continue;
             }
 
@@ -986,7 +1182,9 @@ std::unordered_set<uint256, StaticSaltedHasher> CInstantSendManager::ProcessPend
             return {};
         }
         uint256 signHash = utils::BuildSignHash(llmq_params.type, quorum->qc->quorumHash, id, islock->txid);
+        auto& batchVerifier = batchVerifiers.try_emplace(quorum->qc->quorumHash, false, true).first->second;
         batchVerifier.PushMessage(nodeId, hash, signHash, islock->sig.Get(), quorum->qc->quorumPublicKey);
+        sources.emplace(nodeId);
         verifyCount++;
 
         // We can reconstruct the CRecoveredSig objects from the islock and pass it to the signing manager, which
@@ -998,17 +1196,31 @@ std::unordered_set<uint256, StaticSaltedHasher> CInstantSendManager::ProcessPend
     }
 
     cxxtimer::Timer verifyTimer(true);
-    batchVerifier.Verify();
+    std::vector<std::function<bool()>> jobs;
+    jobs.reserve(batchVerifiers.size());
+    for (auto& p : batchVerifiers) {
+        auto* batchVerifier = &p.second;
+        jobs.emplace_back([batchVerifier]() {
+            batchVerifier->Verify();
+            return true;
+        });
+    }
+    blsWorker.ExecuteParallel(jobs);
     verifyTimer.stop();
 
-    LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- verified locks. count=%d, alreadyVerified=%d, vt=%d, nodes=%d\n", __func__,
-            verifyCount, alreadyVerified, verifyTimer.count(), batchVerifier.GetUniqueSourceCount());
+    for (const auto& p : batchVerifiers) {
+        badSources.insert(p.second.badSources.begin(), p.second.badSources.end());
+        badMessages.insert(p.second.badMessages.begin(), p.second.badMessages.end());
+    }
+
+    LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- verified locks. count=%d, alreadyVerified=%d, vt=%d, nodes=%d, quorums=%d\n", __func__,
+            verifyCount, alreadyVerified, verifyTimer.count(), sources.size(), batchVerifiers.size());
 
     std::unordered_set<uint256, StaticSaltedHasher> badISLocks;
 
-    if (ban && !batchVerifier.badSources.empty()) {
+    if (ban && !badSources.empty()) {
         LOCK(cs_main);
-        for (const auto& nodeId : batchVerifier.badSources) {
+        for (const auto& nodeId : badSources) {
             // Let's not be too harsh, as the peer might simply be unlucky and might have sent us an old lock which
             // does not validate anymore due to changed quorums
             Misbehaving(nodeId, 20);
@@ -1019,7 +1231,7 @@ std::unordered_set<uint256, StaticSaltedHasher> CInstantSendManager::ProcessPend
         auto nodeId = p.second.first;
         const auto& islock = p.second.second;
 
-        if (batchVerifier.badMessages.count(hash)) {
+        if (badMessages.count(hash)) {
             LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- txid=%s, islock=%s: invalid sig in islock, peer=%d\n", __func__,
                      islock->txid.ToString(), hash.ToString(), nodeId);
             badISLocks.emplace(hash);
@@ -1127,6 +1339,8 @@ void CInstantSendManager::ProcessInstantSendLock(NodeId from, const uint256& has
     ResolveBlockConflicts(hash, *islock);
 
     if (tx != nullptr) {
+        // the ChainLocks handler might have been waiting for this TX to become locked before signing the tip
+        clhandler.TransactionLocked(islock->txid);
         RemoveMempoolConflictsForLock(hash, *islock);
         LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- notify about lock %s for tx %s\n", __func__,
                 hash.ToString(), tx->GetHash().ToString());
@@ -1156,6 +1370,7 @@ void CInstantSendManager::TransactionAddedToMempool(const CTransactionRef& tx)
                 islock = it->second.second;
                 pendingInstantSendLocks.try_emplace(it->first, it->second);
                 pendingNoTxInstantSendLocks.erase(it);
+                workInterrupt.wakeup();
                 break;
             }
             ++it;
@@ -1167,6 +1382,8 @@ void CInstantSendManager::TransactionAddedToMempool(const CTransactionRef& tx)
         // TX is not locked, so make sure it is tracked
         AddNonLockedTx(tx, nullptr);
     } else {
+        // the islock was verified already but we could not notify the ChainLocks handler before the TX arrived
+        clhandler.TransactionLocked(tx->GetHash());
         RemoveMempoolConflictsForLock(::SerializeHash(*islock), *islock);
     }
 }
@@ -1245,6 +1462,7 @@ void CInstantSendManager::AddNonLockedTx(const CTransactionRef& tx, const CBlock
                          tx->GetHash().ToString(), it->first.ToString());
                 pendingInstantSendLocks.try_emplace(it->first, it->second);
                 pendingNoTxInstantSendLocks.erase(it);
+                workInterrupt.wakeup();
                 break;
             }
             ++it;
@@ -1272,6 +1490,9 @@ void CInstantSendManager::RemoveNonLockedTx(const uint256& txid, bool retryChild
             pendingRetryTxs.emplace(childTxid);
             retryChildrenCount++;
         }
+        if (retryChildrenCount != 0) {
+            workInterrupt.wakeup();
+        }
     }
 
     if (info.tx) {
@@ -1511,11 +1732,16 @@ void CInstantSendManager::RemoveConflictingLock(const uint256& islockHash, const
               islock.txid.ToString(), islockHash.ToString());
     int tipHeight = WITH_LOCK(cs_main, return ::ChainActive().Height());
 
-    auto removedIslocks = db.RemoveChainedInstantSendLocks(islockHash, islock.txid, tipHeight);
+    std::vector<uint256> removedTxids;
+    auto removedIslocks = db.RemoveChainedInstantSendLocks(islockHash, islock.txid, tipHeight, removedTxids);
     for (const auto& h : removedIslocks) {
         LogPrintf("CInstantSendManager::%s -- txid=%s, islock=%s: removed (child) ISLOCK %s\n", __func__,
                   islock.txid.ToString(), islockHash.ToString(), h.ToString());
     }
+    // the ChainLocks handler might have considered these TXs as safe already
+    for (const auto& txid : removedTxids) {
+        clhandler.TransactionUnlocked(txid);
+    }
 }
 
 void CInstantSendManager::AskNodesForLockedTx(const uint256& txid, const CConnman& connman)
@@ -1722,6 +1948,7 @@ void CInstantSendManager::WorkThreadMain()
         bool fMoreWork = ProcessPendingInstantSendLocks();
         ProcessPendingRetryLockTxs();
 
+        // new islocks and retry candidates wake us up, no need to poll for them
         if (!fMoreWork && !workInterrupt.sleep_for(std::chrono::milliseconds(100))) {
             return;
         }
@@ -10,6 +10,7 @@
 
 #include <chain.h>
 #include <coins.h>
+#include <crypto/siphash.h>
 #include <dbwrapper.h>
 #include <primitives/transaction.h>
 #include <threadinterrupt.h>
@@ -18,6 +19,7 @@
 #include <unordered_map>
 #include <unordered_set>
 
+class CBLSWorker;
 class CSporkManager;
 class CMasternodeSync;
 
@@ -64,6 +66,43 @@ struct CInstantSendLock
 
 using CInstantSendLockPtr = std::shared_ptr<CInstantSendLock>;
 
+/**
+ * Bloom filter over the txids and inputs of all islocks in CInstantSendDb. Most transactions and inputs which are
+ * looked up have no islock, this lets these lookups skip LevelDB. There are no false negatives, removed keys stay in
+ * the filter until it is rebuilt.
+ */
+class CInstantSendKeyFilter
+{
+private:
+    static constexpr size_t BITS_PER_ELEMENT{10};
+    static constexpr size_t HASH_FUNCS{7};
+
+    const uint64_t k0;
+    const uint64_t k1;
+
+    std::vector<uint64_t> bits;
+    size_t nCapacity{0};
+    size_t nInserted{0};
+    size_t nRemoved{0};
+
+    void Insert(uint64_t hash);
+    bool MayContain(uint64_t hash) const;
+
+public:
+    static constexpr size_t MIN_CAPACITY{1 << 16};
+
+    CInstantSendKeyFilter();
+
+    void Reset(size_t capacity);
+    void Insert(const uint256& txid) { Insert(SipHashUint256(k0, k1, txid)); }
+    void Insert(const COutPoint& outpoint) { Insert(SipHashUint256Extra(k0, k1, outpoint.hash, outpoint.n)); }
+    void Removed(size_t count) { nRemoved += count; }
+    [[nodiscard]] bool MayContain(const uint256& txid) const { return MayContain(SipHashUint256(k0, k1, txid)); }
+    [[nodiscard]] bool MayContain(const COutPoint& outpoint) const { return MayContain(SipHashUint256Extra(k0, k1, outpoint.hash, outpoint.n)); }
+    // too many keys inserted for the false positive rate to stay low or too many stale keys
+    [[nodiscard]] bool NeedsRebuild() const { return nInserted > nCapacity || nRemoved > nCapacity; }
+};
+
 class CInstantSendDb
 {
 private:
@@ -71,16 +110,34 @@ private:
 
     static constexpr int CURRENT_VERSION{1};
 
+    // pending writes are flushed to db once they use this much memory or are older than FLUSH_INTERVAL seconds
+    static constexpr size_t MAX_PENDING_MEMORY{8 << 20};
+    static constexpr int64_t FLUSH_INTERVAL{10};
+
+    using DbTransaction = CDBTransaction<CDBWrapper, CDBBatch>;
+
     int best_confirmed_height GUARDED_BY(cs_db) {0};
 
     std::unique_ptr<CDBWrapper> db GUARDED_BY(cs_db) {nullptr};
+    // All writes go into dbTransaction (write-behind), which coalesces them into large batches that are written to db
+    // by Flush(). Reads and iterators go through dbTransaction too, so they see pending writes
+    CDBBatch rootBatch GUARDED_BY(cs_db);
+    mutable DbTransaction dbTransaction GUARDED_BY(cs_db);
+    int64_t nLastFlushTime GUARDED_BY(cs_db) {0};
     mutable unordered_lru_cache<uint256, CInstantSendLockPtr, StaticSaltedHasher, 10000> islockCache GUARDED_BY(cs_db);
     mutable unordered_lru_cache<uint256, uint256, StaticSaltedHasher, 10000> txidCache GUARDED_BY(cs_db);
 
     mutable unordered_lru_cache<COutPoint, uint256, SaltedOutpointHasher, 10000> outpointCache GUARDED_BY(cs_db);
-    void WriteInstantSendLockMined(CDBBatch& batch, const uint256& hash, int nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs_db);
+    // txids and inputs of all islocks in db
+    CInstantSendKeyFilter keyFilter GUARDED_BY(cs_db);
+
+    void RebuildKeyFilter() EXCLUSIVE_LOCKS_REQUIRED(cs_db);
+
+    void FlushInternal() EXCLUSIVE_LOCKS_REQUIRED(cs_db);
+    void FlushIfNeeded() EXCLUSIVE_LOCKS_REQUIRED(cs_db);
+    void WriteInstantSendLockMined(DbTransaction& batch, const uint256& hash, int nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs_db);
 
-    void RemoveInstantSendLockMined(CDBBatch& batch, const uint256& hash, int nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs_db);
+    void RemoveInstantSendLockMined(DbTransaction& batch, const uint256& hash, int nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs_db);
 
     /**
      * This method removes a InstantSend Lock from the database and is called when a tx with an IS lock is confirmed and Chainlocked
@@ -89,14 +146,14 @@ private:
      * @param islock The InstantSend Lock object itself
      * @param keep_cache Should we still keep corresponding entries in the cache or not
      */
-    void RemoveInstantSendLock(CDBBatch& batch, const uint256& hash, CInstantSendLockPtr islock, bool keep_cache = true) EXCLUSIVE_LOCKS_REQUIRED(cs_db);
+    void RemoveInstantSendLock(DbTransaction& batch, const uint256& hash, CInstantSendLockPtr islock, bool keep_cache = true) EXCLUSIVE_LOCKS_REQUIRED(cs_db);
     /**
      * Marks an InstantSend Lock as archived.
      * @param batch Object used to batch many calls together
      * @param hash The hash of the InstantSend Lock
      * @param nHeight The height that the transaction was included at
      */
-    void WriteInstantSendLockArchived(CDBBatch& batch, const uint256& hash, int nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs_db);
+    void WriteInstantSendLockArchived(DbTransaction& batch, const uint256& hash, int nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs_db);
     /**
      * Gets a vector of IS Lock hashes of the IS Locks which rely on or are children of the parent IS Lock
      * @param parent The hash of the parent IS Lock
@@ -117,8 +174,21 @@ private:
 
 public:
     explicit CInstantSendDb(bool unitTests, bool fWipe) :
-            db(std::make_unique<CDBWrapper>(unitTests ? "" : (GetDataDir() / "llmq/isdb"), 32 << 20, unitTests, fWipe))
-    {}
+            db(std::make_unique<CDBWrapper>(unitTests ? "" : (GetDataDir() / "llmq/isdb"), 32 << 20, unitTests, fWipe)),
+            rootBatch(*db),
+            dbTransaction(*db, rootBatch)
+    {
+        LOCK(cs_db);
+        nLastFlushTime = GetTime();
+        RebuildKeyFilter();
+    }
+    ~CInstantSendDb() { Flush(); }
+
+    /**
+     * Writes all pending changes to disk. Called synchronously by FlushStateToDisk before the coins and evodb are
+     * written, so that the islock db is never behind the chainstate after a crash, and on shutdown
+     */
+    void Flush() LOCKS_EXCLUDED(cs_db);
 
     void Upgrade(const CTxMemPool& mempool) LOCKS_EXCLUDED(cs_db);
 
@@ -191,9 +261,10 @@ public:
      * @param islockHash IS Lock hash which has been invalidated
      * @param txid Transaction id associated with the islockHash
      * @param nHeight height of the block which received a chainlock and invalidated the IS Lock
+     * @param removedTxidsRet receives the txids of all removed IS Locks
      * @return A vector of IS Lock hashes of all IS Locks removed
      */
-    std::vector<uint256> RemoveChainedInstantSendLocks(const uint256& islockHash, const uint256& txid, int nHeight) LOCKS_EXCLUDED(cs_db);
+    std::vector<uint256> RemoveChainedInstantSendLocks(const uint256& islockHash, const uint256& txid, int nHeight, std::vector<uint256>& removedTxidsRet) LOCKS_EXCLUDED(cs_db);
 
     void RemoveAndArchiveInstantSendLock(const CInstantSendLockPtr& islock, int nHeight) LOCKS_EXCLUDED(cs_db);
 };
@@ -209,6 +280,7 @@ private:
     CSigningManager& sigman;
     CSigSharesManager& shareman;
     CChainLocksHandler& clhandler;
+    CBLSWorker& blsWorker;
     const std::unique_ptr<CMasternodeSync>& m_mn_sync;
 
     std::atomic<bool> fUpgradedDB{false};
@@ -238,6 +310,8 @@ private:
     mutable Mutex cs_pendingLocks;
     // Incoming and not verified yet
     std::unordered_map<uint256, std::pair<NodeId, CInstantSendLockPtr>, StaticSaltedHasher> pendingInstantSendLocks GUARDED_BY(cs_pendingLocks);
+    // Time (in ms) islocks in pendingInstantSendLocks were received from other nodes, used to measure the queueing latency
+    std::unordered_map<uint256, int64_t, StaticSaltedHasher> pendingInstantSendLocksTime GUARDED_BY(cs_pendingLocks);
     // Tried to verify but there is no tx yet
     std::unordered_map<uint256, std::pair<NodeId, CInstantSendLockPtr>, StaticSaltedHasher> pendingNoTxInstantSendLocks GUARDED_BY(cs_pendingLocks);
 
@@ -259,9 +333,10 @@ private:
 public:
     explicit CInstantSendManager(CTxMemPool& _mempool, CConnman& _connman, CSporkManager& sporkManager,
                                  CQuorumManager& _qman, CSigningManager& _sigman, CSigSharesManager& _shareman,
-                                 CChainLocksHandler& _clhandler, const std::unique_ptr<CMasternodeSync>& mn_sync, bool unitTests, bool fWipe) :
+                                 CChainLocksHandler& _clhandler, CBLSWorker& _blsWorker, const std::unique_ptr<CMasternodeSync>& mn_sync,
+                                 bool unitTests, bool fWipe) :
         db(unitTests, fWipe), connman(_connman), mempool(_mempool), spork_manager(sporkManager), qman(_qman), sigman(_sigman), shareman(_shareman),
-        clhandler(_clhandler), m_mn_sync(mn_sync)
+        clhandler(_clhandler), blsWorker(_blsWorker), m_mn_sync(mn_sync)
     {
         workInterrupt.reset();
     }
@@ -329,6 +404,7 @@ public:
 
     void NotifyChainLock(const CBlockIndex* pindexChainLock);
     void UpdatedBlockTip(const CBlockIndex* pindexNew);
+    void FlushDb() { db.Flush(); }
 
     void RemoveConflictingLock(const uint256& islockHash, const CInstantSendLock& islock);
 
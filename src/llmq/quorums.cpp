@@ -82,6 +82,11 @@ void CQuorum::Init(CFinalCommitmentPtr _qc, const CBlockIndex* _pQuorumBaseBlock
     m_quorum_base_block_index = _pQuorumBaseBlockIndex;
     members = _members;
     minedBlockHash = _minedBlockHash;
+
+    // the quorum public key is decoded again with every commitment and diff referring to this quorum
+    const bool fLegacy = qc->nVersion == CFinalCommitment::LEGACY_BLS_NON_INDEXED_QUORUM_VERSION ||
+                         qc->nVersion == CFinalCommitment::LEGACY_BLS_INDEXED_QUORUM_VERSION;
+    CBLSPublicKeyCache::Add(qc->quorumPublicKey, fLegacy);
 }
 
 bool CQuorum::SetVerificationVector(const BLSVerificationVector& quorumVecIn)
@@ -837,6 +842,30 @@ void CQuorumManager::StartCachePopulatorThread(const CQuorumCPtr pQuorum) const
     });
 }
 
+void CQuorumManager::StartQuorumMembersPrecomputeThreads(const CBlockIndex* pindexNew) const
+{
+    // DKG sessions, quorum connections and commitment verification all need the members of a new quorum right after
+    // its base block got connected. Compute them in the background so that they are already cached by then.
+    for (const auto& params : Params().GetConsensus().llmqs) {
+        if (!utils::IsQuorumBaseBlock(params, pindexNew)) {
+            continue;
+        }
+
+        const auto llmqType = params.type;
+        workerPool.push([pindexNew, llmqType, this](int threadId) {
+            if (quorumThreadInterrupt) {
+                return;
+            }
+            cxxtimer::Timer t(true);
+            // returns early if the quorum type is not enabled. For rotated quorums, the first call of a cycle computes
+            // the members of all its quorums, the following ones only take them from the cache.
+            const auto members = utils::GetAllQuorumMembers(llmqType, pindexNew);
+            LogPrint(BCLog::LLMQ, "CQuorumManager::StartQuorumMembersPrecomputeThreads -- llmqType=%d, height=%d, members=%d, time=%d\n",
+                     ToUnderlying(llmqType), pindexNew->nHeight, members.size(), t.count());
+        });
+    }
+}
+
 void CQuorumManager::StartQuorumDataRecoveryThread(const CQuorumCPtr pQuorum, const CBlockIndex* pIndex, uint16_t nDataMaskIn) const
 {
     if (pQuorum->fQuorumDataRecoveryThreadRunning) {
@@ -236,6 +236,7 @@ public:
     void Stop();
 
     void TriggerQuorumDataRecoveryThreads(const CBlockIndex* pIndex) const;
+    void StartQuorumMembersPrecomputeThreads(const CBlockIndex* pindexNew) const;
 
     void UpdatedBlockTip(const CBlockIndex *pindexNew, bool fInitialDownload) const;
 
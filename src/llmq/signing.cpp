@@ -16,6 +16,7 @@
 #include <net_processing.h>
 #include <netmessagemaker.h>
 #include <scheduler.h>
+#include <threadinterrupt.h>
 #include <util/irange.h>
 #include <util/underlying.h>
 #include <validation.h>
@@ -526,8 +527,8 @@ void CRecoveredSigsDb::CleanupOldVotes(int64_t maxAge)
 
 //////////////////
 
-CSigningManager::CSigningManager(CConnman& _connman, const CQuorumManager& _qman, bool fMemory, bool fWipe) :
-    db(fMemory, fWipe), connman(_connman), qman(_qman)
+CSigningManager::CSigningManager(CConnman& _connman, const CQuorumManager& _qman, CBLSWorker& _blsWorker, bool fMemory, bool fWipe) :
+    db(fMemory, fWipe), connman(_connman), qman(_qman), blsWorker(_blsWorker)
 {
 }
 
@@ -600,6 +601,9 @@ void CSigningManager::ProcessMessageRecoveredSig(const CNode& pfrom, const std::
         return;
     }
     pendingRecoveredSigs[pfrom.GetId()].emplace_back(recoveredSig);
+    if (workerWakeup != nullptr) {
+        workerWakeup->wakeup();
+    }
 }
 
 bool CSigningManager::PreVerifyRecoveredSig(const CQuorumManager& quorum_manager, const CRecoveredSig& recoveredSig, bool& retBan)
@@ -719,7 +723,7 @@ bool CSigningManager::ProcessPendingRecoveredSigs()
 
     // It's ok to perform insecure batched verification here as we verify against the quorum public keys, which are not
     // craftable by individual entities, making the rogue public key attack impossible
-    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, false);
+    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, false, 0, &blsWorker);
 
     size_t verifyCount = 0;
     for (const auto& p : recSigsByNode) {
@@ -835,6 +839,9 @@ void CSigningManager::PushReconstructedRecoveredSig(const std::shared_ptr<const
 {
     LOCK(cs);
     pendingReconstructedRecoveredSigs.emplace(std::piecewise_construct, std::forward_as_tuple(recoveredSig->GetHash()), std::forward_as_tuple(recoveredSig));
+    if (workerWakeup != nullptr) {
+        workerWakeup->wakeup();
+    }
 }
 
 void CSigningManager::TruncateRecoveredSig(Consensus::LLMQType llmqType, const uint256& id)
@@ -870,6 +877,12 @@ void CSigningManager::UnregisterRecoveredSigsListener(CRecoveredSigsListener* l)
     recoveredSigsListeners.erase(itRem, recoveredSigsListeners.end());
 }
 
+void CSigningManager::SetWorkerWakeup(CThreadInterrupt* wakeup)
+{
+    LOCK(cs);
+    workerWakeup = wakeup;
+}
+
 bool CSigningManager::AsyncSignIfMember(Consensus::LLMQType llmqType, CSigSharesManager& shareman, const uint256& id, const uint256& msgHash, const uint256& quorumHash, bool allowReSign)
 {
     if (!fMasternodeMode || WITH_LOCK(activeMasternodeInfoCs, return activeMasternodeInfo.proTxHash.IsNull())) {
@@ -18,9 +18,11 @@
 #include <unordered_map>
 
 using NodeId = int64_t;
+class CBLSWorker;
 class CConnman;
 class CInv;
 class CNode;
+class CThreadInterrupt;
 
 namespace llmq
 {
@@ -167,6 +169,7 @@ private:
     CRecoveredSigsDb db;
     CConnman& connman;
     const CQuorumManager& qman;
+    CBLSWorker& blsWorker;
 
     // Incoming and not verified yet
     std::unordered_map<NodeId, std::list<std::shared_ptr<const CRecoveredSig>>> pendingRecoveredSigs GUARDED_BY(cs);
@@ -178,8 +181,11 @@ private:
 
     std::vector<CRecoveredSigsListener*> recoveredSigsListeners GUARDED_BY(cs);
 
+    // woken up when new recovered sigs are pending, see SetWorkerWakeup
+    CThreadInterrupt* workerWakeup GUARDED_BY(cs){nullptr};
+
 public:
-    CSigningManager(CConnman& _connman, const CQuorumManager& _qman, bool fMemory, bool fWipe);
+    CSigningManager(CConnman& _connman, const CQuorumManager& _qman, CBLSWorker& _blsWorker, bool fMemory, bool fWipe);
 
     bool AlreadyHave(const CInv& inv) const;
     bool GetRecoveredSigForGetData(const uint256& hash, CRecoveredSig& ret) const;
@@ -213,6 +219,10 @@ public:
     void RegisterRecoveredSigsListener(CRecoveredSigsListener* l);
     void UnregisterRecoveredSigsListener(CRecoveredSigsListener* l);
 
+    // The thread calling ProcessPendingRecoveredSigs registers here to be woken up as soon as new recovered sigs are
+    // pending, instead of polling for them
+    void SetWorkerWakeup(CThreadInterrupt* wakeup);
+
     bool AsyncSignIfMember(Consensus::LLMQType llmqType, CSigSharesManager& shareman, const uint256& id, const uint256& msgHash, const uint256& quorumHash = uint256(), bool allowReSign = false);
     bool HasRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, const uint256& msgHash) const;
     bool HasRecoveredSigForId(Consensus::LLMQType llmqType, const uint256& id) const;
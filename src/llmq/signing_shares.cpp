@@ -11,16 +11,21 @@
 
 #include <bls/bls_batchverifier.h>
 #include <chainparams.h>
+#include <crypto/common.h>
 #include <evo/deterministicmns.h>
 #include <masternode/node.h>
 #include <net_processing.h>
 #include <netmessagemaker.h>
 #include <spork.h>
+#include <statsd_client.h>
 #include <util/irange.h>
 #include <util/underlying.h>
 
 #include <cxxtimer.hpp>
 
+#include <algorithm>
+#include <bitset>
+
 namespace llmq
 {
 void CSigShare::UpdateKey()
@@ -35,53 +40,124 @@ std::string CSigSesAnn::ToString() const
                      sessionId, ToUnderlying(getLlmqType()), getQuorumHash().ToString(), getId().ToString(), getMsgHash().ToString());
 }
 
-void CSigSharesInv::Merge(const CSigSharesInv& inv2)
+void CQuorumMemberBitSet::Resize(size_t size)
+{
+    assert(size <= MAX_SIZE);
+    nSize = size;
+    for (size_t i = UsedWords(); i < WORD_COUNT; i++) {
+        words[i] = 0;
+    }
+    if (nSize % WORD_BITS != 0) {
+        words[UsedWords() - 1] &= (uint64_t{1} << (nSize % WORD_BITS)) - 1;
+    }
+}
+
+void CQuorumMemberBitSet::SetAll(bool v)
+{
+    words.fill(0);
+    if (v) {
+        const size_t size = nSize;
+        for (size_t i = 0; i < UsedWords(); i++) {
+            words[i] = ~uint64_t{0};
+        }
+        Resize(size);
+    }
+}
+
+void CQuorumMemberBitSet::Or(const CQuorumMemberBitSet& other)
+{
+    assert(nSize == other.nSize);
+    for (size_t i = 0; i < WORD_COUNT; i++) {
+        words[i] |= other.words[i];
+    }
+}
+
+void CQuorumMemberBitSet::And(const CQuorumMemberBitSet& other)
+{
+    assert(nSize == other.nSize);
+    for (size_t i = 0; i < WORD_COUNT; i++) {
+        words[i] &= other.words[i];
+    }
+}
+
+void CQuorumMemberBitSet::AndNot(const CQuorumMemberBitSet& other)
+{
+    assert(nSize == other.nSize);
+    for (size_t i = 0; i < WORD_COUNT; i++) {
+        words[i] &= ~other.words[i];
+    }
+}
+
+size_t CQuorumMemberBitSet::Count() const
+{
+    size_t count{0};
+    for (const auto w : words) {
+        count += std::bitset<WORD_BITS>(w).count();
+    }
+    return count;
+}
+
+bool CQuorumMemberBitSet::Any() const
 {
-    for (const auto i : irange::range(inv.size())) {
-        if (inv2.inv[i]) {
-            inv[i] = inv2.inv[i];
+    return std::any_of(words.begin(), words.end(), [](uint64_t w) { return w != 0; });
+}
+
+size_t CQuorumMemberBitSet::FindNext(size_t pos) const
+{
+    if (pos >= nSize) {
+        return nSize;
+    }
+    size_t wordIdx = pos / WORD_BITS;
+    // mask out the bits before pos in the first word
+    uint64_t w = words[wordIdx] & (~uint64_t{0} << (pos % WORD_BITS));
+    while (w == 0) {
+        if (++wordIdx >= UsedWords()) {
+            return nSize;
         }
+        w = words[wordIdx];
     }
+    // CountBits of the isolated lowest bit gives its 1-based index
+    return wordIdx * WORD_BITS + CountBits(w & (~w + 1)) - 1;
+}
+
+void CSigSharesInv::Merge(const CSigSharesInv& inv2)
+{
+    inv.Or(inv2.inv);
 }
 
 size_t CSigSharesInv::CountSet() const
 {
-    return (size_t)std::count(inv.begin(), inv.end(), true);
+    return inv.Count();
 }
 
 std::string CSigSharesInv::ToString() const
 {
     std::string str = "(";
     bool first = true;
-    for (const auto i : irange::range(inv.size())) {
-        if (!inv[i]) {
-            continue;
-        }
-
+    inv.ForEachSet([&](size_t i) {
         if (!first) {
             str += ",";
         }
         first = false;
         str += strprintf("%d", i);
-    }
+    });
     str += ")";
     return str;
 }
 
 void CSigSharesInv::Init(size_t size)
 {
-    inv.resize(size, false);
+    inv.Resize(size);
 }
 
 void CSigSharesInv::Set(uint16_t quorumMember, bool v)
 {
-    assert(quorumMember < inv.size());
-    inv[quorumMember] = v;
+    inv.Set(quorumMember, v);
 }
 
 void CSigSharesInv::SetAll(bool v)
 {
-    std::fill(inv.begin(), inv.end(), v);
+    inv.SetAll(v);
 }
 
 std::string CBatchedSigShares::ToInvString() const
@@ -90,7 +166,7 @@ std::string CBatchedSigShares::ToInvString() const
     // we use 400 here no matter what the real size is. We don't really care about that size as we just want to call ToString()
     inv.Init(400);
     for (const auto& sigShare : sigShares) {
-        inv.inv[sigShare.first] = true;
+        inv.Set(sigShare.first, true);
     }
     return inv.ToString();
 }
@@ -114,7 +190,7 @@ static void InitSession(CSigSharesNodeState::Session& s, const uint256& signHash
 CSigSharesNodeState::Session& CSigSharesNodeState::GetOrCreateSessionFromShare(const llmq::CSigShare& sigShare)
 {
     auto& s = sessions[sigShare.GetSignHash()];
-    if (s.announced.inv.empty()) {
+    if (s.announced.inv.Empty()) {
         InitSession(s, sigShare.GetSignHash(), sigShare);
     }
     return s;
@@ -124,7 +200,7 @@ CSigSharesNodeState::Session& CSigSharesNodeState::GetOrCreateSessionFromAnn(con
 {
     auto signHash = ann.buildSignHash();
     auto& s = sessions[signHash];
-    if (s.announced.inv.empty()) {
+    if (s.announced.inv.Empty()) {
         InitSession(s, signHash, ann);
     }
     return s;
@@ -183,9 +259,18 @@ void CSigSharesManager::StartWorkerThread()
         assert(false);
     }
 
+    sigman.SetWorkerWakeup(&workInterrupt);
+
+    const size_t nRecoveryWorkers = std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, MAX_RECOVERY_WORKERS);
+    recoverySessions.resize(nRecoveryWorkers);
+    recoveryWorkers.Start(nRecoveryWorkers, "sigshares-rec");
+
     workThread = std::thread(&TraceThread<std::function<void()> >,
         "sigshares",
         std::function<void()>(std::bind(&CSigSharesManager::WorkThreadMain, this)));
+    sendThread = std::thread(&TraceThread<std::function<void()> >,
+        "sigshares-send",
+        std::function<void()>(std::bind(&CSigSharesManager::SendThreadMain, this)));
 }
 
 void CSigSharesManager::StopWorkerThread()
@@ -195,9 +280,18 @@ void CSigSharesManager::StopWorkerThread()
         assert(false);
     }
 
+    if (sendThread.joinable()) {
+        sendThread.join();
+    }
     if (workThread.joinable()) {
         workThread.join();
     }
+
+    // queued recoveries are dropped, running ones are waited for
+    recoveryWorkers.Stop();
+    recoverySessions.clear();
+
+    sigman.SetWorkerWakeup(nullptr);
 }
 
 void CSigSharesManager::RegisterAsRecoveredSigsListener()
@@ -213,6 +307,60 @@ void CSigSharesManager::UnregisterAsRecoveredSigsListener()
 void CSigSharesManager::InterruptWorkerThread()
 {
     workInterrupt();
+    sendInterrupt();
+}
+
+void CSigSharesNodeStates::ReportLockWait(int64_t nWaitStart)
+{
+    if (const int64_t nWaitTime = GetTimeMicros() - nWaitStart; nWaitTime >= 1000) {
+        statsClient.timing("llmq.sigShares.nodeStateLockWaitMs", nWaitTime / 1000, 1.0f);
+    }
+}
+
+std::vector<NodeId> CSigSharesNodeStates::GetNodeIds(bool fOnlyWithPendingSigShares)
+{
+    std::vector<NodeId> nodeIds;
+    ForEach([&](NodeId nodeId, const CSigSharesNodeState& nodeState) {
+        if (!fOnlyWithPendingSigShares || !nodeState.pendingIncomingSigShares.Empty()) {
+            nodeIds.emplace_back(nodeId);
+        }
+    });
+    return nodeIds;
+}
+
+void CShardedWorkerPool::Start(size_t nWorkers, const std::string& threadName)
+{
+    assert(workers.empty());
+    for (size_t i = 0; i < nWorkers; i++) {
+        auto& worker = workers.emplace_back(std::make_unique<Worker>());
+        RenameThreadPool(worker->pool, strprintf("%s.%d", threadName, i).c_str());
+    }
+}
+
+void CShardedWorkerPool::Stop()
+{
+    for (auto& worker : workers) {
+        worker->pool.stop(false);
+    }
+    workers.clear();
+}
+
+bool CShardedWorkerPool::Push(const uint256& key, std::function<void(size_t)> job)
+{
+    if (workers.empty()) {
+        return false;
+    }
+    const size_t nIndex = GetWorkerIndex(key);
+    auto& worker = *workers[nIndex];
+    if (worker.nPending >= nMaxPendingPerWorker) {
+        return false;
+    }
+    worker.nPending++;
+    worker.pool.push([&worker, nIndex, job = std::move(job)](int) {
+        job(nIndex);
+        worker.nPending--;
+    });
+    return true;
 }
 
 void CSigSharesManager::ProcessMessage(const CNode& pfrom, const CSporkManager& sporkManager, const std::string& msg_type, CDataStream& vRecv)
@@ -316,14 +464,14 @@ bool CSigSharesManager::ProcessMessageSigSesAnn(const CNode& pfrom, const CSigSe
         return true; // let's still try other announcements from the same message
     }
 
-    LOCK(cs);
-    auto& nodeState = nodeStates[pfrom.GetId()];
-    auto& session = nodeState.GetOrCreateSessionFromAnn(ann);
-    nodeState.sessionByRecvId.erase(session.recvSessionId);
-    nodeState.sessionByRecvId.erase(ann.getSessionId());
-    session.recvSessionId = ann.getSessionId();
-    session.quorum = quorum;
-    nodeState.sessionByRecvId.try_emplace(ann.getSessionId(), &session);
+    nodeStates.With(pfrom.GetId(), [&](CSigSharesNodeState& nodeState) {
+        auto& session = nodeState.GetOrCreateSessionFromAnn(ann);
+        nodeState.sessionByRecvId.erase(session.recvSessionId);
+        nodeState.sessionByRecvId.erase(ann.getSessionId());
+        session.recvSessionId = ann.getSessionId();
+        session.quorum = quorum;
+        nodeState.sessionByRecvId.try_emplace(ann.getSessionId(), &session);
+    });
 
     return true;
 }
@@ -331,7 +479,7 @@ bool CSigSharesManager::ProcessMessageSigSesAnn(const CNode& pfrom, const CSigSe
 bool CSigSharesManager::VerifySigSharesInv(Consensus::LLMQType llmqType, const CSigSharesInv& inv)
 {
     const auto& llmq_params_opt = GetLLMQParams(llmqType);
-    return llmq_params_opt.has_value() && (inv.inv.size() == size_t(llmq_params_opt->size));
+    return llmq_params_opt.has_value() && (inv.inv.Size() == size_t(llmq_params_opt->size));
 }
 
 bool CSigSharesManager::ProcessMessageSigSharesInv(const CNode& pfrom, const CSigSharesInv& inv)
@@ -360,14 +508,12 @@ bool CSigSharesManager::ProcessMessageSigSharesInv(const CNode& pfrom, const CSi
         return true;
     }
 
-    LOCK(cs);
-    auto& nodeState = nodeStates[pfrom.GetId()];
-    auto* session = nodeState.GetSessionByRecvId(inv.sessionId);
-    if (session == nullptr) {
-        return true;
-    }
-    session->announced.Merge(inv);
-    session->knows.Merge(inv);
+    nodeStates.With(pfrom.GetId(), [&](CSigSharesNodeState& nodeState) {
+        if (auto* session = nodeState.GetSessionByRecvId(inv.sessionId)) {
+            session->announced.Merge(inv);
+            session->knows.Merge(inv);
+        }
+    });
     return true;
 }
 
@@ -390,14 +536,12 @@ bool CSigSharesManager::ProcessMessageGetSigShares(const CNode& pfrom, const CSi
     LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- signHash=%s, inv={%s}, node=%d\n", __func__,
             sessionInfo.signHash.ToString(), inv.ToString(), pfrom.GetId());
 
-    LOCK(cs);
-    auto& nodeState = nodeStates[pfrom.GetId()];
-    auto* session = nodeState.GetSessionByRecvId(inv.sessionId);
-    if (session == nullptr) {
-        return true;
-    }
-    session->requested.Merge(inv);
-    session->knows.Merge(inv);
+    nodeStates.With(pfrom.GetId(), [&](CSigSharesNodeState& nodeState) {
+        if (auto* session = nodeState.GetSessionByRecvId(inv.sessionId)) {
+            session->requested.Merge(inv);
+            session->knows.Merge(inv);
+        }
+    });
     return true;
 }
 
@@ -417,11 +561,8 @@ bool CSigSharesManager::ProcessMessageBatchedSigShares(const CNode& pfrom, const
 
     {
         LOCK(cs);
-        auto& nodeState = nodeStates[pfrom.GetId()];
-
         for (const auto& sigSharetmp : batchedSigShares.sigShares) {
             CSigShare sigShare = RebuildSigShare(sessionInfo, sigSharetmp);
-            nodeState.requestedSigShares.Erase(sigShare.GetKey());
 
             // TODO track invalid sig shares received for PoSe?
             // It's important to only skip seen *valid* sig shares here. If a node sends us a
@@ -431,15 +572,15 @@ bool CSigSharesManager::ProcessMessageBatchedSigShares(const CNode& pfrom, const
                 continue;
             }
 
-            // TODO for PoSe, we should consider propagating shares even if we already have a recovered sig
-            if (sigman.HasRecoveredSigForId(sigShare.getLlmqType(), sigShare.getId())) {
-                continue;
-            }
-
             sigSharesToProcess.emplace_back(sigShare);
         }
     }
 
+    // TODO for PoSe, we should consider propagating shares even if we already have a recovered sig
+    sigSharesToProcess.erase(std::remove_if(sigSharesToProcess.begin(), sigSharesToProcess.end(), [&](const CSigShare& sigShare) {
+        return sigman.HasRecoveredSigForId(sigShare.getLlmqType(), sigShare.getId());
+    }), sigSharesToProcess.end());
+
     LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- signHash=%s, shares=%d, new=%d, inv={%s}, node=%d\n", __func__,
              sessionInfo.signHash.ToString(), batchedSigShares.sigShares.size(), sigSharesToProcess.size(), batchedSigShares.ToInvString(), pfrom.GetId());
 
@@ -447,11 +588,18 @@ bool CSigSharesManager::ProcessMessageBatchedSigShares(const CNode& pfrom, const
         return true;
     }
 
-    LOCK(cs);
-    auto& nodeState = nodeStates[pfrom.GetId()];
-    for (const auto& s : sigSharesToProcess) {
-        nodeState.pendingIncomingSigShares.Add(s.GetKey(), s);
-    }
+    // Sig shares which got verified in the meantime are skipped again by CollectPendingSigSharesToVerify
+    const int64_t nNow = GetTimeMillis();
+    nodeStates.With(pfrom.GetId(), [&](CSigSharesNodeState& nodeState) {
+        for (const auto& sigShare : batchedSigShares.sigShares) {
+            nodeState.requestedSigShares.Erase(std::make_pair(sessionInfo.signHash, sigShare.first));
+        }
+        for (auto& s : sigSharesToProcess) {
+            s.nReceivedTime = nNow;
+            nodeState.pendingIncomingSigShares.Add(s.GetKey(), s);
+        }
+    });
+    workInterrupt.wakeup();
     return true;
 }
 
@@ -487,21 +635,17 @@ void CSigSharesManager::ProcessMessageSigShare(NodeId fromId, const CSigShare& s
         return;
     }
 
-    {
-        LOCK(cs);
-
-        if (sigShares.Has(sigShare.GetKey())) {
-            return;
-        }
-
-        if (sigman.HasRecoveredSigForId(sigShare.getLlmqType(), sigShare.getId())) {
-            return;
-        }
-
-        auto& nodeState = nodeStates[fromId];
-        nodeState.pendingIncomingSigShares.Add(sigShare.GetKey(), sigShare);
+    if (sigman.HasRecoveredSigForId(sigShare.getLlmqType(), sigShare.getId())) {
+        return;
     }
 
+    CSigShare pendingSigShare(sigShare);
+    pendingSigShare.nReceivedTime = GetTimeMillis();
+    nodeStates.With(fromId, [&](CSigSharesNodeState& nodeState) {
+        nodeState.pendingIncomingSigShares.Add(pendingSigShare.GetKey(), pendingSigShare);
+    });
+    workInterrupt.wakeup();
+
     LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- signHash=%s, id=%s, msgHash=%s, member=%d, node=%d\n", __func__,
              sigShare.GetSignHash().ToString(), sigShare.getId().ToString(), sigShare.getMsgHash().ToString(), sigShare.getQuorumMember(), fromId);
 }
@@ -554,7 +698,8 @@ void CSigSharesManager::CollectPendingSigSharesToVerify(
 {
     {
         LOCK(cs);
-        if (nodeStates.empty()) {
+        auto nodeIds = nodeStates.GetNodeIds(/*fOnlyWithPendingSigShares=*/true);
+        if (nodeIds.empty()) {
             return;
         }
 
@@ -563,24 +708,36 @@ void CSigSharesManager::CollectPendingSigSharesToVerify(
         // other nodes would be able to poison us with a large batch with N-1 valid shares and the last one being
         // invalid, making batch verification fail and revert to per-share verification, which in turn would slow down
         // the whole verification process
+        Shuffle(nodeIds.begin(), nodeIds.end(), rnd);
 
         std::unordered_set<std::pair<NodeId, uint256>, StaticSaltedHasher> uniqueSignHashes;
-        utils::IterateNodesRandom(nodeStates, [&]() {
-            return uniqueSignHashes.size() < maxUniqueSessions;
-        }, [&](NodeId nodeId, CSigSharesNodeState& ns) {
-            if (ns.pendingIncomingSigShares.Empty()) {
-                return false;
-            }
-            const auto& sigShare = *ns.pendingIncomingSigShares.GetFirst();
+        size_t idx = 0;
+        while (!nodeIds.empty() && uniqueSignHashes.size() < maxUniqueSessions) {
+            const NodeId nodeId = nodeIds[idx];
+            const bool fMore = nodeStates.With(nodeId, [&](CSigSharesNodeState& ns) {
+                if (ns.pendingIncomingSigShares.Empty()) {
+                    return false;
+                }
+                const auto& sigShare = *ns.pendingIncomingSigShares.GetFirst();
 
-            AssertLockHeld(cs);
-            if (const bool alreadyHave = this->sigShares.Has(sigShare.GetKey()); !alreadyHave) {
-                uniqueSignHashes.emplace(nodeId, sigShare.GetSignHash());
-                retSigShares[nodeId].emplace_back(sigShare);
+                AssertLockHeld(cs);
+                if (const bool alreadyHave = this->sigShares.Has(sigShare.GetKey()); !alreadyHave) {
+                    uniqueSignHashes.emplace(nodeId, sigShare.GetSignHash());
+                    retSigShares[nodeId].emplace_back(sigShare);
+                }
+                ns.pendingIncomingSigShares.Erase(sigShare.GetKey());
+                return !ns.pendingIncomingSigShares.Empty();
+            });
+            if (fMore) {
+                idx = (idx + 1) % nodeIds.size();
+            } else {
+                nodeIds.erase(nodeIds.begin() + idx);
+                if (nodeIds.empty()) {
+                    break;
+                }
+                idx %= nodeIds.size();
             }
-            ns.pendingIncomingSigShares.Erase(sigShare.GetKey());
-            return !ns.pendingIncomingSigShares.Empty();
-        }, rnd);
+        }
 
         if (retSigShares.empty()) {
             return;
@@ -616,11 +773,45 @@ bool CSigSharesManager::ProcessPendingSigShares(const CConnman& connman)
         return false;
     }
 
+    const int64_t nNow = GetTimeMillis();
+    for (const auto& [_, v] : sigSharesByNodes) {
+        for (const auto& sigShare : v) {
+            if (sigShare.nReceivedTime != 0) {
+                statsClient.timing("llmq.sigShares.queueLatencyMs", nNow - sigShare.nReceivedTime, 0.1f);
+            }
+        }
+    }
+
     // It's ok to perform insecure batched verification here as we verify against the quorum public key shares,
     // which are not craftable by individual entities, making the rogue public key attack impossible
-    CBLSBatchVerifier<NodeId, SigShareKey> batchVerifier(false, true);
+    CBLSBatchVerifier<NodeId, SigShareKey> batchVerifier(false, true, 0, &blsWorker);
 
     cxxtimer::Timer prepareTimer(true);
+
+    // Deserializing the lazy signatures is the expensive part of preparing the batch, so it's spread over the BLS
+    // worker threads. The loop below then only picks up the already decoded signatures.
+    std::vector<const CSigShare*> sigSharesToDecode;
+    for (const auto& [_, v] : sigSharesByNodes) {
+        for (const auto& sigShare : v) {
+            sigSharesToDecode.emplace_back(&sigShare);
+        }
+    }
+    const size_t nDecodeShards = std::min(blsWorker.GetWorkerCount() + 1, sigSharesToDecode.size());
+    if (nDecodeShards > 1) {
+        std::vector<std::function<bool()>> jobs;
+        const size_t nShardSize = (sigSharesToDecode.size() + nDecodeShards - 1) / nDecodeShards;
+        for (size_t start = 0; start < sigSharesToDecode.size(); start += nShardSize) {
+            const size_t end = std::min(start + nShardSize, sigSharesToDecode.size());
+            jobs.emplace_back([&sigSharesToDecode, start, end]() {
+                for (size_t i = start; i < end; i++) {
+                    sigSharesToDecode[i]->sigShare.Get();
+                }
+                return true;
+            });
+        }
+        blsWorker.ExecuteParallel(jobs);
+    }
+
     size_t verifyCount = 0;
     for (const auto& [nodeId, v] : sigSharesByNodes) {
         for (const auto& sigShare : v) {
@@ -723,11 +914,12 @@ void CSigSharesManager::ProcessSigShare(const CSigShare& sigShare, const CConnma
             // don't announce and wait for other nodes to request this share and directly send it to them
             // there is no way the other nodes know about this share as this is the one created on this node
             for (auto otherNodeId : quorumNodes) {
-                auto& nodeState = nodeStates[otherNodeId];
-                auto& session = nodeState.GetOrCreateSessionFromShare(sigShare);
-                session.quorum = quorum;
-                session.requested.Set(sigShare.getQuorumMember(), true);
-                session.knows.Set(sigShare.getQuorumMember(), true);
+                nodeStates.With(otherNodeId, [&](CSigSharesNodeState& nodeState) {
+                    auto& session = nodeState.GetOrCreateSessionFromShare(sigShare);
+                    session.quorum = quorum;
+                    session.requested.Set(sigShare.getQuorumMember(), true);
+                    session.knows.Set(sigShare.getQuorumMember(), true);
+                });
             }
         }
 
@@ -737,12 +929,94 @@ void CSigSharesManager::ProcessSigShare(const CSigShare& sigShare, const CConnma
         }
     }
 
-    if (canTryRecovery) {
+    AsyncAddSigShareForRecovery(quorum, sigShare, canTryRecovery);
+}
+
+void CSigSharesManager::AsyncAddSigShareForRecovery(const CQuorumCPtr& quorum, const CSigShare& sigShare, bool fCanRecover)
+{
+    if (recoveryWorkers.Push(quorum->qc->quorumHash, [this, quorum, sigShare, fCanRecover](size_t nWorker) {
+            AddSigShareForRecovery(recoverySessions[nWorker], quorum, sigShare, fCanRecover);
+        })) {
+        return;
+    }
+
+    if (fCanRecover) {
         TryRecoverSig(quorum, sigShare.getId(), sigShare.getMsgHash());
     }
 }
 
-void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash)
+void CSigSharesManager::AddSigShareForRecovery(RecoverySessions& worker, const CQuorumCPtr& quorum, const CSigShare& sigShare, bool fCanRecover)
+{
+    const int64_t now = GetAdjustedTime();
+    if (now - worker.nLastCleanup >= SESSION_NEW_SHARES_TIMEOUT) {
+        for (auto it = worker.sessions.begin(); it != worker.sessions.end(); ) {
+            if (now - it->second.nLastUpdate >= SESSION_NEW_SHARES_TIMEOUT) {
+                it = worker.sessions.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        worker.nLastCleanup = now;
+    }
+
+    const auto& signHash = sigShare.GetSignHash();
+    auto it = worker.sessions.find(signHash);
+    if (it != worker.sessions.end() && it->second.fDone) {
+        return;
+    }
+    if (sigman.HasRecoveredSigForId(quorum->params.type, sigShare.getId())) {
+        if (it != worker.sessions.end()) {
+            worker.sessions.erase(it);
+        }
+        return;
+    }
+
+    if (it == worker.sessions.end()) {
+        if (worker.sessions.size() >= MAX_RECOVERY_SESSIONS_PER_WORKER) {
+            if (fCanRecover) {
+                TryRecoverSig(quorum, sigShare.getId(), sigShare.getMsgHash(), true);
+            }
+            return;
+        }
+        it = worker.sessions.emplace(signHash, RecoverySession()).first;
+    }
+    auto& session = it->second;
+    session.nLastUpdate = now;
+
+    const auto threshold = size_t(quorum->params.threshold);
+    if (session.recovery.Size() < threshold) {
+        session.recovery.Add(CBLSId(quorum->members[sigShare.getQuorumMember()]->proTxHash), sigShare.sigShare.Get());
+    }
+    if (session.recovery.Size() < threshold) {
+        if (fCanRecover) {
+            // some shares were never queued to this worker, recover from all the shares we know of
+            TryRecoverSig(quorum, sigShare.getId(), sigShare.getMsgHash(), true);
+        }
+        return;
+    }
+
+    cxxtimer::Timer t(true);
+    CBLSSignature recoveredSig;
+    const bool fRecovered = session.recovery.Recover(recoveredSig);
+
+    // the interpolation state is not needed anymore, only remember that this session is done
+    session.recovery = CBLSSignatureRecovery();
+    session.fDone = true;
+
+    if (!fRecovered) {
+        LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- failed to recover signature. id=%s, msgHash=%s, time=%d\n", __func__,
+                  sigShare.getId().ToString(), sigShare.getMsgHash().ToString(), t.count());
+        TryRecoverSig(quorum, sigShare.getId(), sigShare.getMsgHash(), true);
+        return;
+    }
+
+    LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- recovered signature. id=%s, msgHash=%s, time=%d\n", __func__,
+              sigShare.getId().ToString(), sigShare.getMsgHash().ToString(), t.count());
+
+    ProcessOwnRecoveredSig(quorum, sigShare.getId(), sigShare.getMsgHash(), recoveredSig, true);
+}
+
+void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, bool fFromWorker)
 {
     if (sigman.HasRecoveredSigForId(quorum->params.type, id)) {
         return;
@@ -785,6 +1059,11 @@ void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256&
     LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- recovered signature. id=%s, msgHash=%s, time=%d\n", __func__,
               id.ToString(), msgHash.ToString(), t.count());
 
+    ProcessOwnRecoveredSig(quorum, id, msgHash, recoveredSig, fFromWorker);
+}
+
+void CSigSharesManager::ProcessOwnRecoveredSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, const CBLSSignature& recoveredSig, bool fFromWorker)
+{
     auto rs = std::make_shared<CRecoveredSig>(quorum->params.type, quorum->qc->quorumHash, id, msgHash, recoveredSig);
 
     // There should actually be no need to verify the self-recovered signatures as it should always succeed. Let's
@@ -801,7 +1080,12 @@ void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256&
         }
     }
 
-    sigman.ProcessRecoveredSig(rs);
+    if (fFromWorker) {
+        // hand it over to the sigshares thread, which is woken up by this
+        sigman.PushReconstructedRecoveredSig(rs);
+    } else {
+        sigman.ProcessRecoveredSig(rs);
+    }
 }
 
 CDeterministicMNCPtr CSigSharesManager::SelectMemberForRecovery(const CQuorumCPtr& quorum, const uint256 &id, size_t attempt)
@@ -828,91 +1112,89 @@ void CSigSharesManager::CollectSigSharesToRequest(std::unordered_map<NodeId, std
 
     // avoid requesting from same nodes all the time
     std::vector<NodeId> shuffledNodeIds;
-    shuffledNodeIds.reserve(nodeStates.size());
-    for (const auto& [nodeId, nodeState] : nodeStates) {
-        if (nodeState.sessions.empty()) {
-            continue;
+    nodeStates.ForEach([&](NodeId nodeId, const CSigSharesNodeState& nodeState) {
+        if (!nodeState.sessions.empty()) {
+            shuffledNodeIds.emplace_back(nodeId);
         }
-        shuffledNodeIds.emplace_back(nodeId);
-    }
+    });
     Shuffle(shuffledNodeIds.begin(), shuffledNodeIds.end(), rnd);
 
     for (const auto& nodeId : shuffledNodeIds) {
-        auto& nodeState = nodeStates[nodeId];
-
-        if (nodeState.banned) {
-            continue;
-        }
+        nodeStates.With(nodeId, [&](CSigSharesNodeState& nodeState) {
+            AssertLockHeld(cs);
 
-        nodeState.requestedSigShares.EraseIf([&now, &nodeId](const SigShareKey& k, int64_t t) {
-            if (now - t >= SIG_SHARE_REQUEST_TIMEOUT) {
-                // timeout while waiting for this one, so retry it with another node
-                LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::CollectSigSharesToRequest -- timeout while waiting for %s-%d, node=%d\n",
-                         k.first.ToString(), k.second, nodeId);
-                return true;
+            if (nodeState.banned) {
+                return;
             }
-            return false;
-        });
 
-        decltype(sigSharesToRequest.begin()->second)* invMap = nullptr;
-
-        for (auto& [signHash, session] : nodeState.sessions) {
-            if (utils::IsAllMembersConnectedEnabled(session.llmqType)) {
-                continue;
-            }
+            nodeState.requestedSigShares.EraseIf([&now, &nodeId](const SigShareKey& k, int64_t t) {
+                if (now - t >= SIG_SHARE_REQUEST_TIMEOUT) {
+                    // timeout while waiting for this one, so retry it with another node
+                    LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::CollectSigSharesToRequest -- timeout while waiting for %s-%d, node=%d\n",
+                             k.first.ToString(), k.second, nodeId);
+                    return true;
+                }
+                return false;
+            });
 
-            if (sigman.HasRecoveredSigForSession(signHash)) {
-                continue;
-            }
+            decltype(sigSharesToRequest.begin()->second)* invMap = nullptr;
 
-            for (const auto i : irange::range(session.announced.inv.size())) {
-                if (!session.announced.inv[i]) {
+            for (auto& [signHash, session] : nodeState.sessions) {
+                if (utils::IsAllMembersConnectedEnabled(session.llmqType)) {
                     continue;
                 }
-                auto k = std::make_pair(signHash, (uint16_t) i);
-                if (sigShares.Has(k)) {
-                    // we already have it
-                    session.announced.inv[i] = false;
+
+                if (sigman.HasRecoveredSigForSession(signHash)) {
                     continue;
                 }
-                if (nodeState.requestedSigShares.Size() >= maxRequestsForNode) {
-                    // too many pending requests for this node
-                    break;
-                }
-                if (auto *const p = sigSharesRequested.Get(k)) {
-                    if (now - p->second >= SIG_SHARE_REQUEST_TIMEOUT && nodeId != p->first) {
-                        // other node timed out, re-request from this node
-                        LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- other node timeout while waiting for %s-%d, re-request from=%d, node=%d\n", __func__,
-                                 k.first.ToString(), k.second, nodeId, p->first);
-                    } else {
+
+                auto& announced = session.announced.inv;
+                for (size_t i = announced.FindNext(0); i < announced.Size(); i = announced.FindNext(i + 1)) {
+                    auto k = std::make_pair(signHash, (uint16_t) i);
+                    if (sigShares.Has(k)) {
+                        // we already have it
+                        announced.Set(i, false);
                         continue;
                     }
-                }
-                // if we got this far we should do a request
+                    if (nodeState.requestedSigShares.Size() >= maxRequestsForNode) {
+                        // too many pending requests for this node
+                        break;
+                    }
+                    if (auto *const p = sigSharesRequested.Get(k)) {
+                        if (now - p->second >= SIG_SHARE_REQUEST_TIMEOUT && nodeId != p->first) {
+                            // other node timed out, re-request from this node
+                            LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- other node timeout while waiting for %s-%d, re-request from=%d, node=%d\n", __func__,
+                                     k.first.ToString(), k.second, nodeId, p->first);
+                        } else {
+                            continue;
+                        }
+                    }
+                    // if we got this far we should do a request
 
-                // track when we initiated the request so that we can detect timeouts
-                nodeState.requestedSigShares.Add(k, now);
+                    // track when we initiated the request so that we can detect timeouts
+                    nodeState.requestedSigShares.Add(k, now);
 
-                // don't request it from other nodes until a timeout happens
-                auto& r = sigSharesRequested.GetOrAdd(k);
-                r.first = nodeId;
-                r.second = now;
+                    // don't request it from other nodes until a timeout happens
+                    auto& r = sigSharesRequested.GetOrAdd(k);
+                    r.first = nodeId;
+                    r.second = now;
 
-                if (invMap == nullptr) {
-                    invMap = &sigSharesToRequest[nodeId];
-                }
-                auto& inv = (*invMap)[signHash];
-                if (inv.inv.empty()) {
-                    const auto& llmq_params_opt = GetLLMQParams(session.llmqType);
-                    assert(llmq_params_opt.has_value());
-                    inv.Init(llmq_params_opt->size);
-                }
-                inv.inv[k.second] = true;
+                    if (invMap == nullptr) {
+                        invMap = &sigSharesToRequest[nodeId];
+                    }
+                    auto& inv = (*invMap)[signHash];
+                    if (inv.inv.Empty()) {
+                        const auto& llmq_params_opt = GetLLMQParams(session.llmqType);
+                        assert(llmq_params_opt.has_value());
+                        inv.Init(llmq_params_opt->size);
+                    }
+                    inv.Set(k.second, true);
 
-                // don't request it again from this node
-                session.announced.inv[i] = false;
+                    // don't request it again from this node
+                    announced.Set(i, false);
+                }
             }
-        }
+        });
     }
 }
 
@@ -920,9 +1202,11 @@ void CSigSharesManager::CollectSigSharesToSend(std::unordered_map<NodeId, std::u
 {
     AssertLockHeld(cs);
 
-    for (auto& [nodeId, nodeState] : nodeStates) {
+    nodeStates.ForEach([&](NodeId nodeId, CSigSharesNodeState& nodeState) {
+        AssertLockHeld(cs);
+
         if (nodeState.banned) {
-            continue;
+            return;
         }
 
         decltype(sigSharesToSend.begin()->second)* sigSharesToSend2 = nullptr;
@@ -938,22 +1222,18 @@ void CSigSharesManager::CollectSigSharesToSend(std::unordered_map<NodeId, std::u
 
             CBatchedSigShares batchedSigShares;
 
-            for (const auto i : irange::range(session.requested.inv.size())) {
-                if (!session.requested.inv[i]) {
-                    continue;
-                }
-                session.requested.inv[i] = false;
-
+            const auto& requested = session.requested.inv;
+            for (size_t i = requested.FindNext(0); i < requested.Size(); i = requested.FindNext(i + 1)) {
                 auto k = std::make_pair(signHash, (uint16_t)i);
                 const CSigShare* sigShare = sigShares.Get(k);
                 if (sigShare == nullptr) {
                     // he requested something we don't have
-                    session.requested.inv[i] = false;
                     continue;
                 }
 
                 batchedSigShares.sigShares.emplace_back((uint16_t)i, sigShare->sigShare);
             }
+            session.requested.SetAll(false);
 
             if (!batchedSigShares.sigShares.empty()) {
                 if (sigSharesToSend2 == nullptr) {
@@ -963,7 +1243,7 @@ void CSigSharesManager::CollectSigSharesToSend(std::unordered_map<NodeId, std::u
                 sigSharesToSend2->try_emplace(signHash, std::move(batchedSigShares));
             }
         }
-    }
+    });
 }
 
 void CSigSharesManager::CollectSigSharesToSendConcentrated(std::unordered_map<NodeId, std::vector<CSigShare>>& sigSharesToSend, const std::vector<CNode*>& vNodes)
@@ -1037,27 +1317,27 @@ void CSigSharesManager::CollectSigSharesToAnnounce(std::unordered_map<NodeId, st
         const auto& quorumNodes = it->second;
 
         for (const auto& nodeId : quorumNodes) {
-            auto& nodeState = nodeStates[nodeId];
-
-            if (nodeState.banned) {
-                continue;
-            }
+            nodeStates.With(nodeId, [&](CSigSharesNodeState& nodeState) {
+                if (nodeState.banned) {
+                    return;
+                }
 
-            auto& session = nodeState.GetOrCreateSessionFromShare(*sigShare);
+                auto& session = nodeState.GetOrCreateSessionFromShare(*sigShare);
 
-            if (session.knows.inv[quorumMember]) {
-                // he already knows that one
-                continue;
-            }
+                if (session.knows.inv.Get(quorumMember)) {
+                    // he already knows that one
+                    return;
+                }
 
-            auto& inv = sigSharesToAnnounce[nodeId][signHash];
-            if (inv.inv.empty()) {
-                const auto& llmq_params_opt = GetLLMQParams(sigShare->getLlmqType());
-                assert(llmq_params_opt.has_value());
-                inv.Init(llmq_params_opt->size);
-            }
-            inv.inv[quorumMember] = true;
-            session.knows.inv[quorumMember] = true;
+                auto& inv = sigSharesToAnnounce[nodeId][signHash];
+                if (inv.inv.Empty()) {
+                    const auto& llmq_params_opt = GetLLMQParams(sigShare->getLlmqType());
+                    assert(llmq_params_opt.has_value());
+                    inv.Init(llmq_params_opt->size);
+                }
+                inv.Set(quorumMember, true);
+                session.knows.Set(quorumMember, true);
+            });
         }
     });
 
@@ -1075,18 +1355,19 @@ bool CSigSharesManager::SendMessages()
 
     auto addSigSesAnnIfNeeded = [&](NodeId nodeId, const uint256& signHash) {
         AssertLockHeld(cs);
-        auto& nodeState = nodeStates[nodeId];
-        auto* session = nodeState.GetSessionBySignHash(signHash);
-        assert(session);
-        if (session->sendSessionId == UNINITIALIZED_SESSION_ID) {
-            session->sendSessionId = nodeState.nextSendSessionId++;
-
-            sigSessionAnnouncements[nodeId].emplace_back(
-                    CSigSesAnn(/*sessionId=*/session->sendSessionId, /*llmqType=*/session->llmqType,
-                               /*quorumHash=*/session->quorumHash, /*id=*/session->id, /*msgHash=*/session->msgHash)
-            );
-        }
-        return session->sendSessionId;
+        return nodeStates.With(nodeId, [&](CSigSharesNodeState& nodeState) {
+            auto* session = nodeState.GetSessionBySignHash(signHash);
+            assert(session);
+            if (session->sendSessionId == UNINITIALIZED_SESSION_ID) {
+                session->sendSessionId = nodeState.nextSendSessionId++;
+
+                sigSessionAnnouncements[nodeId].emplace_back(
+                        CSigSesAnn(/*sessionId=*/session->sendSessionId, /*llmqType=*/session->llmqType,
+                                   /*quorumHash=*/session->quorumHash, /*id=*/session->id, /*msgHash=*/session->msgHash)
+                );
+            }
+            return session->sendSessionId;
+        });
     };
 
     std::vector<CNode*> vNodesCopy = connman.CopyNodeVector(CConnman::FullyConnectedOnly);
@@ -1227,8 +1508,9 @@ bool CSigSharesManager::SendMessages()
 
 bool CSigSharesManager::GetSessionInfoByRecvId(NodeId nodeId, uint32_t sessionId, CSigSharesNodeState::SessionInfo& retInfo)
 {
-    LOCK(cs);
-    return nodeStates[nodeId].GetSessionInfoByRecvId(sessionId, retInfo);
+    return nodeStates.With(nodeId, [&](CSigSharesNodeState& nodeState) {
+        return nodeState.GetSessionInfoByRecvId(sessionId, retInfo);
+    });
 }
 
 CSigShare CSigSharesManager::RebuildSigShare(const CSigSharesNodeState::SessionInfo& session, const std::pair<uint16_t, CBLSLazySignature>& in)
@@ -1340,11 +1622,8 @@ void CSigSharesManager::Cleanup()
 
     // Find node states for peers that disappeared from CConnman
     std::unordered_set<NodeId> nodeStatesToDelete;
-    {
-        LOCK(cs);
-        for (const auto& [nodeId, _] : nodeStates) {
-            nodeStatesToDelete.emplace(nodeId);
-        }
+    for (const auto& nodeId : nodeStates.GetNodeIds()) {
+        nodeStatesToDelete.emplace(nodeId);
     }
     connman.ForEachNode([&nodeStatesToDelete](const CNode* pnode) {
         nodeStatesToDelete.erase(pnode->GetId());
@@ -1352,18 +1631,17 @@ void CSigSharesManager::Cleanup()
 
     // Now delete these node states
     LOCK(cs);
-    for (const auto& nodeId : nodeStatesToDelete) {
-        auto it = nodeStates.find(nodeId);
-        if (it == nodeStates.end()) {
-            continue;
+    nodeStates.EraseIf([&](NodeId nodeId, CSigSharesNodeState& nodeState) {
+        if (nodeStatesToDelete.count(nodeId) == 0) {
+            return false;
         }
         // remove global requested state to force a re-request from another node
-        it->second.requestedSigShares.ForEach([this](const SigShareKey& k, bool) {
+        nodeState.requestedSigShares.ForEach([this](const SigShareKey& k, bool) {
             AssertLockHeld(cs);
             sigSharesRequested.Erase(k);
         });
-        nodeStates.erase(nodeId);
-    }
+        return true;
+    });
 
     lastCleanupTime = GetAdjustedTime();
 }
@@ -1372,9 +1650,9 @@ void CSigSharesManager::RemoveSigSharesForSession(const uint256& signHash)
 {
     AssertLockHeld(cs);
 
-    for (auto& [_, nodeState] : nodeStates) {
+    nodeStates.ForEach([&signHash](NodeId, CSigSharesNodeState& nodeState) {
         nodeState.RemoveSession(signHash);
-    }
+    });
 
     sigSharesRequested.EraseAllForSignHash(signHash);
     sigSharesQueuedToAnnounce.EraseAllForSignHash(signHash);
@@ -1388,18 +1666,17 @@ void CSigSharesManager::RemoveBannedNodeStates()
     // Called regularly to cleanup local node states for banned nodes
 
     LOCK2(cs_main, cs);
-    for (auto it = nodeStates.begin(); it != nodeStates.end();) {
-        if (IsBanned(it->first)) {
-            // re-request sigshares from other nodes
-            it->second.requestedSigShares.ForEach([this](const SigShareKey& k, int64_t) {
-                AssertLockHeld(cs);
-                sigSharesRequested.Erase(k);
-            });
-            it = nodeStates.erase(it);
-        } else {
-            ++it;
+    nodeStates.EraseIf([this](NodeId nodeId, CSigSharesNodeState& nodeState) {
+        if (!IsBanned(nodeId)) {
+            return false;
         }
-    }
+        // re-request sigshares from other nodes
+        nodeState.requestedSigShares.ForEach([this](const SigShareKey& k, int64_t) {
+            AssertLockHeld(cs);
+            sigSharesRequested.Erase(k);
+        });
+        return true;
+    });
 }
 
 void CSigSharesManager::BanNode(NodeId nodeId)
@@ -1414,26 +1691,20 @@ void CSigSharesManager::BanNode(NodeId nodeId)
     }
 
     LOCK(cs);
-    auto it = nodeStates.find(nodeId);
-    if (it == nodeStates.end()) {
-        return;
-    }
-    auto& nodeState = it->second;
+    nodeStates.WithExisting(nodeId, [this](CSigSharesNodeState& nodeState) {
+        // Whatever we requested from him, let's request it from someone else now
+        nodeState.requestedSigShares.ForEach([this](const SigShareKey& k, int64_t) {
+            AssertLockHeld(cs);
+            sigSharesRequested.Erase(k);
+        });
+        nodeState.requestedSigShares.Clear();
 
-    // Whatever we requested from him, let's request it from someone else now
-    nodeState.requestedSigShares.ForEach([this](const SigShareKey& k, int64_t) {
-        AssertLockHeld(cs);
-        sigSharesRequested.Erase(k);
+        nodeState.banned = true;
     });
-    nodeState.requestedSigShares.Clear();
-
-    nodeState.banned = true;
 }
 
 void CSigSharesManager::WorkThreadMain()
 {
-    int64_t lastSendTime = 0;
-
     while (!workInterrupt) {
         bool fMoreWork{false};
 
@@ -1442,25 +1713,34 @@ void CSigSharesManager::WorkThreadMain()
         fMoreWork |= ProcessPendingSigShares(connman);
         SignPendingSigShares();
 
-        if (GetTimeMillis() - lastSendTime > 100) {
-            SendMessages();
-            lastSendTime = GetTimeMillis();
-        }
-
         Cleanup();
         sigman.Cleanup();
 
-        // TODO Wakeup when pending signing is needed?
+        // new sig shares, recovered sigs and signing requests wake us up, the timeout only drives the periodic
+        // cleanup above
         if (!fMoreWork && !workInterrupt.sleep_for(std::chrono::milliseconds(100))) {
             return;
         }
     }
 }
 
+void CSigSharesManager::SendThreadMain()
+{
+    while (!sendInterrupt) {
+        SendMessages();
+
+        // batch up everything that got queued in the meantime into the next round of messages
+        if (!sendInterrupt.sleep_for(std::chrono::milliseconds(100))) {
+            return;
+        }
+    }
+}
+
 void CSigSharesManager::AsyncSign(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash)
 {
     LOCK(cs);
     pendingSigns.emplace_back(quorum, id, msgHash);
+    workInterrupt.wakeup();
 }
 
 void CSigSharesManager::SignPendingSigShares()
@@ -1544,16 +1824,16 @@ void CSigSharesManager::ForceReAnnouncement(const CQuorumCPtr& quorum, Consensus
             sigSharesQueuedToAnnounce.Add(std::make_pair(signHash, quorumMemberIndex), true);
         }
     }
-    for (auto& [_, nodeState] : nodeStates) {
+    nodeStates.ForEach([&signHash](NodeId, CSigSharesNodeState& nodeState) {
         auto* session = nodeState.GetSessionBySignHash(signHash);
         if (session == nullptr) {
-            continue;
+            return;
         }
         // pretend that the other node doesn't know about any shares so that we re-announce everything
         session->knows.SetAll(false);
         // we need to use a new session id as we don't know if the other node has run into a timeout already
         session->sendSessionId = UNINITIALIZED_SESSION_ID;
-    }
+    });
 }
 
 void CSigSharesManager::HandleNewRecoveredSig(const llmq::CRecoveredSig& recoveredSig)
@@ -12,13 +12,22 @@
 #include <saltedhasher.h>
 #include <serialize.h>
 #include <sync.h>
+#include <util/time.h>
 #include <uint256.h>
 
+#include <ctpl_stl.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <optional>
 #include <thread>
 #include <unordered_map>
 #include <utility>
 
+class CBLSWorker;
 class CEvoDB;
 class CScheduler;
 class CSporkManager;
@@ -44,6 +53,9 @@ public:
 
     SigShareKey key;
 
+    // not serialized, time (in ms) the share was received from another node, used to measure the queueing latency
+    int64_t nReceivedTime{0};
+
     [[nodiscard]] auto getQuorumMember() const {
         return quorumMember;
     }
@@ -105,20 +117,154 @@ public:
     [[nodiscard]] std::string ToString() const;
 };
 
+/**
+ * Bitset over the members of a quorum, packed into a fixed number of 64 bit words. Bulk operations work on whole words,
+ * so merging, counting and finding the set members of an inv costs O(words) instead of O(members).
+ */
+class CQuorumMemberBitSet
+{
+public:
+    // 400 is the largest quorum size we have, leave some room for future LLMQ types
+    static constexpr size_t MAX_SIZE{512};
+
+private:
+    static constexpr size_t WORD_BITS{64};
+    static constexpr size_t WORD_COUNT{MAX_SIZE / WORD_BITS};
+
+    std::array<uint64_t, WORD_COUNT> words{};
+    size_t nSize{0};
+
+    [[nodiscard]] size_t UsedWords() const { return (nSize + WORD_BITS - 1) / WORD_BITS; }
+
+public:
+    [[nodiscard]] size_t Size() const { return nSize; }
+    [[nodiscard]] bool Empty() const { return nSize == 0; }
+    // Bits beyond the new size are cleared
+    void Resize(size_t size);
+
+    [[nodiscard]] bool Get(size_t i) const
+    {
+        assert(i < nSize);
+        return (words[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+    }
+    void Set(size_t i, bool v)
+    {
+        assert(i < nSize);
+        const uint64_t mask = uint64_t{1} << (i % WORD_BITS);
+        if (v) {
+            words[i / WORD_BITS] |= mask;
+        } else {
+            words[i / WORD_BITS] &= ~mask;
+        }
+    }
+    void SetAll(bool v);
+
+    // Bulk operations, both bitsets must have the same size
+    void Or(const CQuorumMemberBitSet& other);
+    void And(const CQuorumMemberBitSet& other);
+    void AndNot(const CQuorumMemberBitSet& other);
+
+    [[nodiscard]] size_t Count() const;
+    [[nodiscard]] bool Any() const;
+    // Returns the index of the first set bit at or after pos, or Size() if there is none
+    [[nodiscard]] size_t FindNext(size_t pos) const;
+
+    template <typename Callback>
+    void ForEachSet(Callback&& callback) const
+    {
+        for (size_t i = FindNext(0); i < nSize; i = FindNext(i + 1)) {
+            callback(i);
+        }
+    }
+
+    bool operator==(const CQuorumMemberBitSet& other) const { return nSize == other.nSize && words == other.words; }
+    bool operator!=(const CQuorumMemberBitSet& other) const { return !(*this == other); }
+
+    // Same wire format as AUTOBITSET, the size is not part of it and must be set with Resize() before unserializing
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        size_t nVarIntsSize{1}; // stopper
+        int64_t last{-1};
+        ForEachSet([&](size_t i) {
+            nVarIntsSize += GetSizeOfVarInt<VarIntMode::DEFAULT, uint32_t>(uint32_t(i - last));
+            last = i;
+        });
+
+        if (GetSizeOfFixedBitSet(nSize) < nVarIntsSize) {
+            ser_writedata8(s, 0);
+            for (size_t i = 0; i < GetSizeOfFixedBitSet(nSize); i++) {
+                ser_writedata8(s, uint8_t(words[i / 8] >> (8 * (i % 8))));
+            }
+        } else {
+            ser_writedata8(s, 1);
+            last = -1;
+            ForEachSet([&](size_t i) {
+                WriteVarInt<Stream, VarIntMode::DEFAULT, uint32_t>(s, uint32_t(i - last));
+                last = i;
+            });
+            WriteVarInt<Stream, VarIntMode::DEFAULT, uint32_t>(s, 0);
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint8_t isVarInts = ser_readdata8(s);
+        if (isVarInts != 0 && isVarInts != 1) {
+            throw std::ios_base::failure("invalid value for isVarInts byte");
+        }
+
+        SetAll(false);
+        if (!isVarInts) {
+            for (size_t i = 0; i < GetSizeOfFixedBitSet(nSize); i++) {
+                words[i / 8] |= uint64_t{ser_readdata8(s)} << (8 * (i % 8));
+            }
+            if (nSize % WORD_BITS != 0 && (words[UsedWords() - 1] >> (nSize % WORD_BITS)) != 0) {
+                throw std::ios_base::failure("Out-of-range bits set");
+            }
+        } else {
+            int64_t last{-1};
+            while (true) {
+                const uint32_t offset = ReadVarInt<Stream, VarIntMode::DEFAULT, uint32_t>(s);
+                if (offset == 0) {
+                    break;
+                }
+                const int64_t idx = last + offset;
+                if (idx >= int64_t(nSize)) {
+                    throw std::ios_base::failure("out of bounds index");
+                }
+                Set(idx, true);
+                last = idx;
+            }
+        }
+    }
+};
+
 class CSigSharesInv
 {
 public:
     uint32_t sessionId{UNINITIALIZED_SESSION_ID};
-    std::vector<bool> inv;
+    CQuorumMemberBitSet inv;
 
 public:
-    SERIALIZE_METHODS(CSigSharesInv, obj)
+    template <typename Stream>
+    void Serialize(Stream& s) const
     {
-        uint64_t invSize = obj.inv.size();
-        READWRITE(VARINT(obj.sessionId), COMPACTSIZE(invSize));
-        autobitset_t bitset = std::make_pair(obj.inv, (size_t)invSize);
-        READWRITE(AUTOBITSET(bitset));
-        SER_READ(obj, obj.inv = bitset.first);
+        uint64_t invSize = inv.Size();
+        s << VARINT(sessionId) << COMPACTSIZE(invSize) << inv;
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        uint64_t invSize;
+        s >> VARINT(sessionId) >> COMPACTSIZE(invSize);
+        if (invSize > CQuorumMemberBitSet::MAX_SIZE) {
+            throw std::ios_base::failure("inv too large");
+        }
+        inv.Resize(invSize);
+        s >> inv;
     }
 
     void Init(size_t size);
@@ -146,17 +292,102 @@ public:
     [[nodiscard]] std::string ToInvString() const;
 };
 
+/**
+ * Maps quorum members to T for a single signing session. Instead of allocating a hash map node per member, values are
+ * stored densely in insertion order and found by scanning a compact array of member indexes, which for the at most
+ * a few hundred members of a quorum is faster than hashing.
+ */
+template<typename T>
+class SigShareSessionMap
+{
+private:
+    std::vector<uint16_t> members;
+    std::vector<std::pair<uint16_t, T>> entries;
+
+    [[nodiscard]] size_t IndexOf(uint16_t member) const
+    {
+        return size_t(std::find(members.begin(), members.end(), member) - members.begin());
+    }
+
+    void EraseAt(size_t idx)
+    {
+        // order doesn't matter, so move the last entry into the gap
+        if (idx != entries.size() - 1) {
+            members[idx] = members.back();
+            entries[idx] = std::move(entries.back());
+        }
+        members.pop_back();
+        entries.pop_back();
+    }
+
+public:
+    [[nodiscard]] size_t size() const { return entries.size(); }
+    [[nodiscard]] bool empty() const { return entries.empty(); }
+    [[nodiscard]] size_t count(uint16_t member) const { return IndexOf(member) != members.size() ? 1 : 0; }
+
+    auto begin() { return entries.begin(); }
+    auto end() { return entries.end(); }
+    auto begin() const { return entries.begin(); }
+    auto end() const { return entries.end(); }
+
+    T* find(uint16_t member)
+    {
+        const size_t idx = IndexOf(member);
+        return idx != members.size() ? &entries[idx].second : nullptr;
+    }
+
+    bool emplace(uint16_t member, const T& v)
+    {
+        if (count(member) != 0) {
+            return false;
+        }
+        members.emplace_back(member);
+        entries.emplace_back(member, v);
+        return true;
+    }
+
+    bool erase(uint16_t member)
+    {
+        const size_t idx = IndexOf(member);
+        if (idx == members.size()) {
+            return false;
+        }
+        EraseAt(idx);
+        return true;
+    }
+
+    template<typename F>
+    size_t EraseIf(F&& f)
+    {
+        size_t erased = 0;
+        for (size_t i = 0; i < entries.size(); ) {
+            if (f(entries[i].first, entries[i].second)) {
+                EraseAt(i);
+                erased++;
+            } else {
+                ++i;
+            }
+        }
+        return erased;
+    }
+};
+
 template<typename T>
 class SigShareMap
 {
 private:
-    std::unordered_map<uint256, std::unordered_map<uint16_t, T>, StaticSaltedHasher> internalMap;
+    std::unordered_map<uint256, SigShareSessionMap<T>, StaticSaltedHasher> internalMap;
+    size_t nSize{0};
 
 public:
     bool Add(const SigShareKey& k, const T& v)
     {
         auto& m = internalMap[k.first];
-        return m.emplace(k.second, v).second;
+        if (!m.emplace(k.second, v)) {
+            return false;
+        }
+        nSize++;
+        return true;
     }
 
     void Erase(const SigShareKey& k)
@@ -165,7 +396,9 @@ public:
         if (it == internalMap.end()) {
             return;
         }
-        it->second.erase(k.second);
+        if (it->second.erase(k.second)) {
+            nSize--;
+        }
         if (it->second.empty()) {
             internalMap.erase(it);
         }
@@ -174,6 +407,7 @@ public:
     void Clear()
     {
         internalMap.clear();
+        nSize = 0;
     }
 
     [[nodiscard]] bool Has(const SigShareKey& k) const
@@ -191,13 +425,7 @@ public:
         if (it == internalMap.end()) {
             return nullptr;
         }
-
-        auto jt = it->second.find(k.second);
-        if (jt == it->second.end()) {
-            return nullptr;
-        }
-
-        return &jt->second;
+        return it->second.find(k.second);
     }
 
     T& GetOrAdd(const SigShareKey& k)
@@ -220,11 +448,7 @@ public:
 
     [[nodiscard]] size_t Size() const
     {
-        size_t s = 0;
-        for (auto& p : internalMap) {
-            s += p.second.size();
-        }
-        return s;
+        return nSize;
     }
 
     [[nodiscard]] size_t CountForSignHash(const uint256& signHash) const
@@ -241,7 +465,7 @@ public:
         return internalMap.empty();
     }
 
-    const std::unordered_map<uint16_t, T>* GetAllForSignHash(const uint256& signHash) const
+    const SigShareSessionMap<T>* GetAllForSignHash(const uint256& signHash) const
     {
         auto it = internalMap.find(signHash);
         if (it == internalMap.end()) {
@@ -252,7 +476,12 @@ public:
 
     void EraseAllForSignHash(const uint256& signHash)
     {
-        internalMap.erase(signHash);
+        auto it = internalMap.find(signHash);
+        if (it == internalMap.end()) {
+            return;
+        }
+        nSize -= it->second.size();
+        internalMap.erase(it);
     }
 
     template<typename F>
@@ -261,14 +490,10 @@ public:
         for (auto it = internalMap.begin(); it != internalMap.end(); ) {
             SigShareKey k;
             k.first = it->first;
-            for (auto jt = it->second.begin(); jt != it->second.end(); ) {
-                k.second = jt->first;
-                if (f(k, jt->second)) {
-                    jt = it->second.erase(jt);
-                } else {
-                    ++jt;
-                }
-            }
+            nSize -= it->second.EraseIf([&](uint16_t member, T& v) {
+                k.second = member;
+                return f(k, v);
+            });
             if (it->second.empty()) {
                 it = internalMap.erase(it);
             } else {
@@ -342,6 +567,107 @@ public:
     void RemoveSession(const uint256& signHash);
 };
 
+// Node states are striped by NodeId, so that the message handler thread only contends on the stripe of the peer it's
+// currently processing instead of on a single lock. Only one stripe is locked at a time.
+class CSigSharesNodeStates
+{
+public:
+    static constexpr size_t STRIPES{16};
+
+private:
+    struct Stripe {
+        Mutex cs;
+        std::unordered_map<NodeId, CSigSharesNodeState> nodeStates GUARDED_BY(cs);
+    };
+    std::array<Stripe, STRIPES> stripes;
+
+    Stripe& GetStripe(NodeId nodeId) { return stripes[size_t(nodeId) % STRIPES]; }
+    static void ReportLockWait(int64_t nWaitStart);
+
+public:
+    // Calls callback with the (possibly newly created) state of nodeId, while holding only its stripe's lock
+    template <typename Callback>
+    auto With(NodeId nodeId, Callback&& callback)
+    {
+        auto& stripe = GetStripe(nodeId);
+        const int64_t nWaitStart = GetTimeMicros();
+        LOCK(stripe.cs);
+        ReportLockWait(nWaitStart);
+        return callback(stripe.nodeStates[nodeId]);
+    }
+
+    // Like With, but doesn't create a new state. Returns false if there is no state for nodeId
+    template <typename Callback>
+    bool WithExisting(NodeId nodeId, Callback&& callback)
+    {
+        auto& stripe = GetStripe(nodeId);
+        LOCK(stripe.cs);
+        auto it = stripe.nodeStates.find(nodeId);
+        if (it == stripe.nodeStates.end()) {
+            return false;
+        }
+        callback(it->second);
+        return true;
+    }
+
+    // Calls callback for every node state, locking one stripe after the other
+    template <typename Callback>
+    void ForEach(Callback&& callback)
+    {
+        for (auto& stripe : stripes) {
+            LOCK(stripe.cs);
+            for (auto& [nodeId, nodeState] : stripe.nodeStates) {
+                callback(nodeId, nodeState);
+            }
+        }
+    }
+
+    // Erases all node states for which pred(nodeId, nodeState) returns true
+    template <typename Predicate>
+    void EraseIf(Predicate&& pred)
+    {
+        for (auto& stripe : stripes) {
+            LOCK(stripe.cs);
+            for (auto it = stripe.nodeStates.begin(); it != stripe.nodeStates.end(); ) {
+                if (pred(it->first, it->second)) {
+                    it = stripe.nodeStates.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    std::vector<NodeId> GetNodeIds(bool fOnlyWithPendingSigShares = false);
+};
+
+// Runs jobs on single threaded workers which are sharded by a key, so that all jobs with the same key are executed in
+// the order they were pushed, while jobs of different shards run in parallel. Each worker's queue is bounded.
+class CShardedWorkerPool
+{
+private:
+    struct Worker {
+        ctpl::thread_pool pool{1};
+        std::atomic<size_t> nPending{0};
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    const size_t nMaxPendingPerWorker;
+
+public:
+    explicit CShardedWorkerPool(size_t _nMaxPendingPerWorker) : nMaxPendingPerWorker(_nMaxPendingPerWorker) {}
+    ~CShardedWorkerPool() { Stop(); }
+
+    void Start(size_t nWorkers, const std::string& threadName);
+    // queued jobs are dropped, running ones are waited for
+    void Stop();
+
+    size_t GetWorkerCount() const { return workers.size(); }
+    size_t GetWorkerIndex(const uint256& key) const { return key.GetUint64(0) % workers.size(); }
+    // Queues job on the worker of key, which calls it with the worker's index. Returns false if the pool is not
+    // running or the queue of the worker is full, in which case the caller has to handle the job itself
+    bool Push(const uint256& key, std::function<void(size_t)> job);
+};
+
 class CSignedSession
 {
 public:
@@ -369,18 +695,45 @@ private:
     static constexpr int64_t MAX_SEND_FOR_RECOVERY_TIMEOUT{10000};
     static constexpr size_t MAX_MSGS_SIG_SHARES{32};
 
+    static constexpr size_t MAX_RECOVERY_WORKERS{4};
+    static constexpr size_t MAX_PENDING_RECOVERIES_PER_WORKER{1024};
+    static constexpr size_t MAX_RECOVERY_SESSIONS_PER_WORKER{1024};
+
     CCriticalSection cs;
 
+    // verifies and processes incoming sig shares, signs and handles recovered sigs
     std::thread workThread;
     CThreadInterrupt workInterrupt;
 
+    // announces, requests and sends sig shares in 100ms batches, independent of how busy workThread is
+    std::thread sendThread;
+    CThreadInterrupt sendInterrupt;
+
+    // Recovery of the final signatures is offloaded to these single threaded workers. Every verified sig share is fed
+    // into the worker of its quorum (sharded by quorum hash), which updates the Lagrange interpolation of the session
+    // as shares arrive. Once the threshold is reached, only the final step of the recovery is left to do. If a worker's
+    // queue is full or a session misses shares, recovery falls back to the full recovery from sigShares.
+    struct RecoverySession {
+        CBLSSignatureRecovery recovery;
+        int64_t nLastUpdate{0};
+        bool fDone{false};
+    };
+    struct RecoverySessions {
+        std::unordered_map<uint256, RecoverySession, StaticSaltedHasher> sessions;
+        int64_t nLastCleanup{0};
+    };
+    CShardedWorkerPool recoveryWorkers{MAX_PENDING_RECOVERIES_PER_WORKER};
+    // indexed by worker, each entry is only accessed from its worker's thread
+    std::vector<RecoverySessions> recoverySessions;
+
     SigShareMap<CSigShare> sigShares GUARDED_BY(cs);
     std::unordered_map<uint256, CSignedSession, StaticSaltedHasher> signedSessions GUARDED_BY(cs);
 
     // stores time of last receivedSigShare. Used to detect timeouts
     std::unordered_map<uint256, int64_t, StaticSaltedHasher> timeSeenForSessions GUARDED_BY(cs);
 
-    std::unordered_map<NodeId, CSigSharesNodeState> nodeStates GUARDED_BY(cs);
+    // Lock order is cs -> node state stripe
+    CSigSharesNodeStates nodeStates;
     SigShareMap<std::pair<NodeId, int64_t>> sigSharesRequested GUARDED_BY(cs);
     SigShareMap<bool> sigSharesQueuedToAnnounce GUARDED_BY(cs);
 
@@ -399,13 +752,16 @@ private:
     CConnman& connman;
     const CQuorumManager& qman;
     CSigningManager& sigman;
+    CBLSWorker& blsWorker;
     int64_t lastCleanupTime{0};
     std::atomic<uint32_t> recoveredSigsCounter{0};
 
 public:
-    explicit CSigSharesManager(CConnman& _connman, CQuorumManager& _qman, CSigningManager& _sigman) : connman(_connman), qman(_qman), sigman(_sigman)
+    explicit CSigSharesManager(CConnman& _connman, CQuorumManager& _qman, CSigningManager& _sigman, CBLSWorker& _blsWorker) :
+        connman(_connman), qman(_qman), sigman(_sigman), blsWorker(_blsWorker)
     {
         workInterrupt.reset();
+        sendInterrupt.reset();
     };
     CSigSharesManager() = delete;
     ~CSigSharesManager() override = default;
@@ -447,7 +803,10 @@ private:
             const CConnman& connman);
 
     void ProcessSigShare(const CSigShare& sigShare, const CConnman& connman, const CQuorumCPtr& quorum);
-    void TryRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash);
+    void AsyncAddSigShareForRecovery(const CQuorumCPtr& quorum, const CSigShare& sigShare, bool fCanRecover);
+    void AddSigShareForRecovery(RecoverySessions& sessions, const CQuorumCPtr& quorum, const CSigShare& sigShare, bool fCanRecover);
+    void TryRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, bool fFromWorker = false);
+    void ProcessOwnRecoveredSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, const CBLSSignature& recoveredSig, bool fFromWorker);
 
     bool GetSessionInfoByRecvId(NodeId nodeId, uint32_t sessionId, CSigSharesNodeState::SessionInfo& retInfo);
     static CSigShare RebuildSigShare(const CSigSharesNodeState::SessionInfo& session, const std::pair<uint16_t, CBLSLazySignature>& in);
@@ -465,6 +824,7 @@ private:
     void CollectSigSharesToAnnounce(std::unordered_map<NodeId, std::unordered_map<uint256, CSigSharesInv, StaticSaltedHasher>>& sigSharesToAnnounce) EXCLUSIVE_LOCKS_REQUIRED(cs);
     void SignPendingSigShares();
     void WorkThreadMain();
+    void SendThreadMain();
 };
 } // namespace llmq
 
@@ -630,6 +630,14 @@ bool IsQuorumRotationEnabled(const Consensus::LLMQParams& llmqParams, const CBlo
     return IsDIP0024Active(pindex->GetAncestor(cycleQuorumBaseHeight - 1));
 }
 
+bool IsQuorumBaseBlock(const Consensus::LLMQParams& llmqParams, const CBlockIndex* pindex)
+{
+    assert(pindex);
+
+    const int quorumIndex = pindex->nHeight % llmqParams.dkgInterval;
+    return quorumIndex < (IsQuorumRotationEnabled(llmqParams, pindex) ? llmqParams.signingActiveQuorumCount : 1);
+}
+
 Consensus::LLMQType GetInstantSendLLMQType(const CQuorumManager& qman, const CBlockIndex* pindex)
 {
     if (IsDIP0024Active(pindex) && !qman.ScanQuorums(Params().GetConsensus().llmqTypeDIP0024InstantSend, pindex, 1).empty()) {
@@ -80,6 +80,9 @@ std::vector<Consensus::LLMQType> GetEnabledQuorumTypes(const CBlockIndex* pindex
 std::vector<std::reference_wrapper<const Consensus::LLMQParams>> GetEnabledQuorumParams(const CBlockIndex* pindex);
 
 bool IsQuorumRotationEnabled(const Consensus::LLMQParams& llmqParams, const CBlockIndex* pindex);
+// true if a quorum of this type is based on pindex, i.e. it's the first block of a DKG interval or, with rotation
+// enabled, one of the first signingActiveQuorumCount blocks of a cycle
+bool IsQuorumBaseBlock(const Consensus::LLMQParams& llmqParams, const CBlockIndex* pindex);
 Consensus::LLMQType GetInstantSendLLMQType(const CQuorumManager& qman, const CBlockIndex* pindex);
 Consensus::LLMQType GetInstantSendLLMQType(bool deterministic);
 bool IsDIP0024Active(const CBlockIndex* pindex);
@@ -1359,6 +1359,38 @@ void PeerLogicValidation::BlockDisconnected(const std::shared_ptr<const CBlock>
     g_recent_confirmed_transactions->reset();
 }
 
+// Serialized MNLISTDIFF and QRINFO responses, cleared whenever the tip changes
+static CMNListResponseCache mnListResponseCache;
+
+template <typename Request>
+static uint256 GetMNListResponseCacheKey(const std::string& msg_type, int nSendVersion, const uint256& tipHash, const Request& request)
+{
+    CHashWriter hw(SER_NETWORK, nSendVersion);
+    hw << msg_type << nSendVersion << tipHash << request;
+    return hw.GetHash();
+}
+
+static bool PushCachedMNListResponse(CConnman& connman, CNode& pfrom, const std::string& msg_type, const uint256& cacheKey)
+{
+    CSerializedNetMsg msg;
+    if (!mnListResponseCache.Get(cacheKey, msg.data)) {
+        statsClient.inc("mnListResponseCache.misses", 1.0f);
+        return false;
+    }
+    statsClient.inc("mnListResponseCache.hits", 1.0f);
+
+    msg.command = msg_type;
+    connman.PushMessage(&pfrom, std::move(msg));
+    return true;
+}
+
+static void CacheMNListResponse(const uint256& cacheKey, const CSerializedNetMsg& msg)
+{
+    // msg itself is moved into the send queue, so the cache needs its own copy
+    mnListResponseCache.Add(cacheKey, std::vector<unsigned char>(msg.data));
+    statsClient.gauge("mnListResponseCache.bytes", mnListResponseCache.GetBytes(), 1.0f);
+}
+
 // All of the following cache a recent block, and are protected by cs_most_recent_block
 static CCriticalSection cs_most_recent_block;
 static std::shared_ptr<const CBlock> most_recent_block GUARDED_BY(cs_most_recent_block);
@@ -1417,6 +1449,9 @@ void PeerLogicValidation::UpdatedBlockTip(const CBlockIndex *pindexNew, const CB
     const int nNewHeight = pindexNew->nHeight;
     m_connman.SetBestHeight(nNewHeight);
 
+    // cached responses were built for the previous tip and can't be served anymore
+    mnListResponseCache.Clear();
+
     SetServiceFlagsIBDCache(!fInitialDownload);
     if (!fInitialDownload) {
         // Find the hashes of all blocks that weren't previously in the best chain.
@@ -4012,10 +4047,17 @@ void PeerLogicValidation::ProcessMessage(
 
         LOCK(cs_main);
 
+        const uint256 cacheKey = GetMNListResponseCacheKey(msg_type, pfrom.GetSendVersion(), ::ChainActive().Tip()->GetBlockHash(), cmd);
+        if (PushCachedMNListResponse(m_connman, pfrom, NetMsgType::MNLISTDIFF, cacheKey)) {
+            return;
+        }
+
         CSimplifiedMNListDiff mnListDiff;
         std::string strError;
         if (BuildSimplifiedMNListDiff(cmd.baseBlockHash, cmd.blockHash, mnListDiff, *m_llmq_ctx->quorum_block_processor, strError)) {
-            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::MNLISTDIFF, mnListDiff));
+            auto msg = msgMaker.Make(NetMsgType::MNLISTDIFF, mnListDiff);
+            CacheMNListResponse(cacheKey, msg);
+            m_connman.PushMessage(&pfrom, std::move(msg));
         } else {
             strError = strprintf("getmnlistdiff failed for baseBlockHash=%s, blockHash=%s. error=%s", cmd.baseBlockHash.ToString(), cmd.blockHash.ToString(), strError);
             Misbehaving(pfrom.GetId(), 1, strError);
@@ -4052,10 +4094,17 @@ void PeerLogicValidation::ProcessMessage(
 
         LOCK(cs_main);
 
+        const uint256 cacheKey = GetMNListResponseCacheKey(msg_type, pfrom.GetSendVersion(), ::ChainActive().Tip()->GetBlockHash(), cmd);
+        if (PushCachedMNListResponse(m_connman, pfrom, NetMsgType::QUORUMROTATIONINFO, cacheKey)) {
+            return;
+        }
+
         llmq::CQuorumRotationInfo quorumRotationInfoRet;
         std::string strError;
         if (BuildQuorumRotationInfo(cmd, quorumRotationInfoRet, *m_llmq_ctx->qman, *m_llmq_ctx->quorum_block_processor, strError)) {
-            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::QUORUMROTATIONINFO, quorumRotationInfoRet));
+            auto msg = msgMaker.Make(NetMsgType::QUORUMROTATIONINFO, quorumRotationInfoRet);
+            CacheMNListResponse(cacheKey, msg);
+            m_connman.PushMessage(&pfrom, std::move(msg));
         } else {
             strError = strprintf("getquorumrotationinfo failed for size(baseBlockHashes)=%d, blockRequestHash=%s. error=%s", cmd.baseBlockHashes.size(), cmd.blockRequestHash.ToString(), strError);
             Misbehaving(pfrom.GetId(), 1, strError);
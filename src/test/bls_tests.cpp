@@ -4,9 +4,13 @@
 
 #include <bls/bls.h>
 #include <bls/bls_batchverifier.h>
+#include <bls/bls_worker.h>
 #include <random.h>
+#include <streams.h>
 #include <test/util/setup_common.h>
 
+#include <thread>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(bls_tests, BasicTestingSetup)
@@ -247,6 +251,396 @@ void FuncDHExchange(const bool legacy_scheme)
     BOOST_CHECK(pke1 == pke2);
 }
 
+void FuncMulInsecure(const bool legacy_scheme)
+{
+    bls::bls_legacy_scheme.store(legacy_scheme);
+
+    CBLSSecretKey sk1, sk2, sk3, k1, k2;
+    sk1.MakeNewKey();
+    sk2.MakeNewKey();
+    sk3.MakeNewKey();
+    k1.MakeNewKey();
+    k2.MakeNewKey();
+
+    const uint256 hash1 = GetRandHash();
+    const uint256 hash2 = GetRandHash();
+    CBLSPublicKey pk1 = sk1.GetPublicKey();
+    CBLSPublicKey pk2 = sk2.GetPublicKey();
+    CBLSSignature sig1 = sk1.Sign(hash1);
+    CBLSSignature sig2 = sk2.Sign(hash2);
+
+    // signature and key multiplied by the same scalar still match
+    CBLSSignature sig1k = sig1;
+    CBLSPublicKey pk1k = pk1;
+    sig1k.MulInsecure(k1);
+    pk1k.MulInsecure(k1);
+    BOOST_CHECK(sig1k.VerifyInsecure(pk1k, hash1));
+    BOOST_CHECK(!sig1k.VerifyInsecure(pk1, hash1));
+
+    // two invalid signatures which cancel each other out pass a plain aggregated verification...
+    const CBLSSignature offset = sk3.Sign(GetRandHash());
+    sig1.AggregateInsecure(offset);
+    sig2.SubInsecure(offset);
+    BOOST_CHECK(!sig1.VerifyInsecure(pk1, hash1));
+    BOOST_CHECK(!sig2.VerifyInsecure(pk2, hash2));
+    BOOST_CHECK(CBLSSignature::AggregateInsecure({sig1, sig2}).VerifyInsecureAggregated({pk1, pk2}, {hash1, hash2}));
+
+    // ...but not a randomized one
+    sig1.MulInsecure(k1);
+    pk1.MulInsecure(k1);
+    sig2.MulInsecure(k2);
+    pk2.MulInsecure(k2);
+    BOOST_CHECK(!CBLSSignature::AggregateInsecure({sig1, sig2}).VerifyInsecureAggregated({pk1, pk2}, {hash1, hash2}));
+}
+
+void FuncLazy(const bool legacy_scheme)
+{
+    bls::bls_legacy_scheme.store(legacy_scheme);
+
+    CBLSSecretKey sk;
+    sk.MakeNewKey();
+    const CBLSSignature sig = sk.Sign(GetRandHash());
+
+    // decoding from the serialized form
+    CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+    ds << sig;
+    CBLSLazySignature lazySig;
+    ds >> lazySig;
+    BOOST_CHECK(lazySig.Get() == sig);
+    BOOST_CHECK(lazySig.GetHash() == sig.GetHash());
+
+    // encoding a set object
+    CBLSLazySignature lazySig2;
+    lazySig2.Set(sig, legacy_scheme);
+    BOOST_CHECK(lazySig2 == lazySig);
+    BOOST_CHECK(lazySig2.GetHash() == sig.GetHash());
+    ds << lazySig2;
+    CBLSSignature sig2;
+    ds >> sig2;
+    BOOST_CHECK(sig2 == sig);
+
+    // serializing in the other scheme re-encodes the object
+    lazySig2.Serialize(ds, !legacy_scheme);
+    BOOST_CHECK(lazySig2.IsLegacy() == !legacy_scheme);
+    sig2.Unserialize(ds, !legacy_scheme, true);
+    BOOST_CHECK(sig2 == sig);
+
+    // copies keep the decoded or the serialized form
+    const CBLSLazySignature lazySig3(lazySig);
+    BOOST_CHECK(lazySig3.Get() == sig);
+    CBLSLazySignature lazySig4;
+    ds << sig;
+    ds >> lazySig4;
+    const CBLSLazySignature lazySig5(lazySig4);
+    BOOST_CHECK(lazySig5.Get() == sig);
+    BOOST_CHECK(lazySig4.Get() == sig);
+
+    // null and invalid objects
+    CBLSLazySignature lazyNull;
+    BOOST_CHECK(!lazyNull.Get().IsValid());
+    ds << lazyNull;
+    BOOST_CHECK(ds.size() == CBLSSignature::SerSize);
+    BOOST_CHECK(std::all_of(ds.begin(), ds.end(), [](auto c) { return c == 0; }));
+    ds.clear();
+    std::vector<uint8_t> garbage(CBLSSignature::SerSize, 0xff);
+    ds.write(reinterpret_cast<const char*>(garbage.data()), garbage.size());
+    ds >> lazyNull;
+    BOOST_CHECK(!lazyNull.Get().IsValid());
+
+    // concurrent decoding of the same object
+    CBLSLazySignature lazySig6;
+    ds << sig;
+    ds >> lazySig6;
+    std::vector<std::thread> threads;
+    std::atomic<int> validCount{0};
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&]() {
+            if (lazySig6.Get() == sig && lazySig6.GetHash() == sig.GetHash()) {
+                validCount++;
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    BOOST_CHECK_EQUAL(validCount.load(), 4);
+}
+
+void FuncPubKeyCache(const bool legacy_scheme)
+{
+    bls::bls_legacy_scheme.store(legacy_scheme);
+    CBLSPublicKeyCache::Clear();
+
+    CBLSSecretKey sk;
+    sk.MakeNewKey();
+    const CBLSPublicKey pk = sk.GetPublicKey();
+    const auto bytes = pk.ToByteVector(legacy_scheme);
+
+    // plain decoding doesn't feed the cache
+    CBLSPublicKey pk2;
+    pk2.SetByteVector(bytes, legacy_scheme);
+    BOOST_CHECK(pk2 == pk);
+    BOOST_CHECK_EQUAL(CBLSPublicKeyCache::Size(), 0);
+
+    // lazy (operator) keys do
+    CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+    ds << pk;
+    CBLSLazyPublicKey lazyPk;
+    ds >> lazyPk;
+    BOOST_CHECK(lazyPk.Get() == pk);
+    BOOST_CHECK_EQUAL(CBLSPublicKeyCache::Size(), 1);
+
+    // cached keys decode to the same key, but only in the scheme they were added with
+    bls::G1Element cached;
+    BOOST_CHECK(CBLSPublicKeyCache::Get(bytes, legacy_scheme, cached));
+    BOOST_CHECK(!CBLSPublicKeyCache::Get(bytes, !legacy_scheme, cached));
+    CBLSPublicKey pk3;
+    pk3.SetByteVector(bytes, legacy_scheme);
+    BOOST_CHECK(pk3 == pk);
+
+    // explicitly added quorum keys
+    CBLSSecretKey sk2;
+    sk2.MakeNewKey();
+    CBLSPublicKeyCache::Add(sk2.GetPublicKey(), legacy_scheme);
+    BOOST_CHECK_EQUAL(CBLSPublicKeyCache::Size(), 2);
+    CBLSPublicKeyCache::Add(CBLSPublicKey(), legacy_scheme);
+    BOOST_CHECK_EQUAL(CBLSPublicKeyCache::Size(), 2);
+
+    // Only lazy keys and quorum commitments consult the cache. Map the bytes to another key to see who does.
+    CBLSPublicKeyCache::Add(bytes, legacy_scheme, sk2.GetPublicKey());
+    CBLSPublicKey pk4;
+    pk4.SetByteVector(bytes, legacy_scheme);
+    BOOST_CHECK(pk4 == pk);
+    CDataStream ds2(SER_NETWORK, PROTOCOL_VERSION);
+    ds2 << CBLSPublicKeyVersionWrapper(pk4, legacy_scheme);
+    CBLSPublicKey pk5;
+    ds2 >> CBLSPublicKeyVersionWrapper(pk5, legacy_scheme, /*checkMalleable=*/false);
+    BOOST_CHECK(pk5 == pk);
+    ds2 << CBLSPublicKeyVersionWrapper(pk4, legacy_scheme);
+    ds2 >> CBLSPublicKeyVersionWrapper(pk5, legacy_scheme, /*checkMalleable=*/false, /*fUseCache=*/true);
+    BOOST_CHECK(pk5 == sk2.GetPublicKey());
+    // the lazy key sees the bogus cached key as well and rejects it for not matching its bytes
+    ds2 << CBLSPublicKeyVersionWrapper(pk4, legacy_scheme);
+    CBLSLazyPublicKey lazyPk2;
+    lazyPk2.Unserialize(ds2, legacy_scheme);
+    BOOST_CHECK(!lazyPk2.Get().IsValid());
+
+    CBLSPublicKeyCache::Clear();
+    BOOST_CHECK_EQUAL(CBLSPublicKeyCache::Size(), 0);
+
+    // the cache is sharded, concurrent adds and lookups of different keys all end up in it
+    std::vector<CBLSPublicKey> pks(64);
+    for (auto& p : pks) {
+        CBLSSecretKey skTmp;
+        skTmp.MakeNewKey();
+        p = skTmp.GetPublicKey();
+    }
+    std::atomic<int> hits{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; t++) {
+        threads.emplace_back([&, t]() {
+            for (size_t i = t; i < pks.size(); i += 4) {
+                CBLSPublicKeyCache::Add(pks[i], legacy_scheme);
+            }
+            for (size_t i = 0; i < pks.size(); i++) {
+                bls::G1Element el;
+                if (CBLSPublicKeyCache::Get(pks[i].ToByteVector(legacy_scheme), legacy_scheme, el)) {
+                    hits++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(CBLSPublicKeyCache::Size(), pks.size());
+    BOOST_CHECK(hits > 0);
+    for (const auto& p : pks) {
+        bls::G1Element el;
+        BOOST_CHECK(CBLSPublicKeyCache::Get(p.ToByteVector(legacy_scheme), legacy_scheme, el));
+        BOOST_CHECK(el.Serialize(legacy_scheme) == p.ToByteVector(legacy_scheme));
+    }
+
+    CBLSPublicKeyCache::Clear();
+}
+
+void FuncSigRecovery(const bool legacy_scheme)
+{
+    bls::bls_legacy_scheme.store(legacy_scheme);
+
+    const size_t threshold = 5;
+    std::vector<CBLSSecretKey> msk(threshold);
+    for (auto& sk : msk) {
+        sk.MakeNewKey();
+    }
+    const CBLSPublicKey pk = msk[0].GetPublicKey();
+    const uint256 msgHash = GetRandHash();
+
+    std::vector<CBLSId> ids;
+    std::vector<CBLSSignature> sigShares;
+    for (size_t i = 0; i < threshold + 2; i++) {
+        CBLSId id(GetRandHash());
+        CBLSSecretKey skShare;
+        BOOST_CHECK(skShare.SecretKeyShare(msk, id));
+        ids.emplace_back(id);
+        sigShares.emplace_back(skShare.Sign(msgHash));
+    }
+
+    CBLSSignatureRecovery recovery;
+    CBLSSignature sig;
+    BOOST_CHECK(!recovery.Recover(sig));
+    for (size_t i = 0; i < threshold; i++) {
+        BOOST_CHECK(recovery.Add(ids[i], sigShares[i]));
+    }
+    // duplicate and invalid ids must be rejected and leave the state untouched
+    BOOST_CHECK(!recovery.Add(ids[0], sigShares[0]));
+    BOOST_CHECK(!recovery.Add(CBLSId(), sigShares[threshold]));
+    BOOST_CHECK(!recovery.Add(CBLSId(uint256()), sigShares[threshold]));
+    BOOST_CHECK_EQUAL(recovery.Size(), threshold);
+
+    BOOST_CHECK(recovery.Recover(sig));
+    BOOST_CHECK(sig.VerifyInsecure(pk, msgHash));
+
+    CBLSSignature sig2;
+    BOOST_CHECK(sig2.Recover({sigShares.begin(), sigShares.begin() + threshold}, {ids.begin(), ids.begin() + threshold}));
+    BOOST_CHECK(sig == sig2);
+
+    // any other set of shares results in the same signature
+    CBLSSignatureRecovery recovery2;
+    for (size_t i = sigShares.size(); i-- > sigShares.size() - threshold; ) {
+        BOOST_CHECK(recovery2.Add(ids[i], sigShares[i]));
+    }
+    BOOST_CHECK(recovery2.Recover(sig2));
+    BOOST_CHECK(sig == sig2);
+
+    // below the threshold, the recovered signature is invalid
+    CBLSSignatureRecovery recovery3;
+    for (size_t i = 0; i < threshold - 1; i++) {
+        BOOST_CHECK(recovery3.Add(ids[i], sigShares[i]));
+    }
+    BOOST_CHECK(recovery3.Recover(sig2));
+    BOOST_CHECK(!sig2.VerifyInsecure(pk, msgHash));
+}
+
+void FuncSigRecoveryMatchesLibrary(const bool legacy_scheme)
+{
+    bls::bls_legacy_scheme.store(legacy_scheme);
+
+    for (size_t round = 0; round < 50; round++) {
+        const size_t threshold = 1 + InsecureRandRange(6);
+        std::vector<CBLSSecretKey> msk(threshold);
+        for (auto& sk : msk) {
+            sk.MakeNewKey();
+        }
+        const uint256 msgHash = GetRandHash();
+
+        std::vector<uint256> idHashes;
+        std::vector<CBLSId> ids;
+        std::vector<CBLSSignature> sigShares;
+        const size_t count = threshold + InsecureRandRange(3);
+        for (size_t i = 0; i < count; i++) {
+            // mix in duplicate and zero ids, both have to be rejected
+            uint256 idHash = GetRandHash();
+            if (i > 0 && InsecureRandRange(8) == 0) {
+                idHash = idHashes[InsecureRandRange(i)];
+            } else if (InsecureRandRange(16) == 0) {
+                idHash.SetNull();
+            }
+            const CBLSId id(idHash);
+            idHashes.emplace_back(idHash);
+            ids.emplace_back(id);
+            if (threshold == 1) {
+                // a single coefficient is the secret itself, SecretKeyShare needs at least two
+                sigShares.emplace_back(msk[0].Sign(msgHash));
+            } else {
+                CBLSSecretKey skShare;
+                BOOST_CHECK(skShare.SecretKeyShare(msk, id));
+                sigShares.emplace_back(skShare.Sign(msgHash));
+            }
+        }
+
+        CBLSSignature sig;
+        const bool fRecovered = sig.Recover(sigShares, ids);
+
+        if (count == 1) {
+            // the library refuses to interpolate a single share, which is just the signature itself
+            BOOST_CHECK(fRecovered == !idHashes[0].IsNull());
+            BOOST_CHECK(!fRecovered || sig == sigShares[0]);
+            continue;
+        }
+
+        std::vector<bls::G2Element> sigsVec;
+        std::vector<bls::Bytes> idsVec;
+        for (size_t i = 0; i < count; i++) {
+            sigsVec.emplace_back(bls::G2Element::FromBytes(bls::Bytes(sigShares[i].ToByteVector(legacy_scheme)), legacy_scheme));
+            idsVec.emplace_back(idHashes[i].begin(), idHashes[i].size());
+        }
+        bool fLibRecovered{true};
+        CBLSSignature libSig;
+        try {
+            libSig.SetByteVector(bls::Threshold::SignatureRecover(sigsVec, idsVec).Serialize(legacy_scheme), legacy_scheme);
+        } catch (...) {
+            fLibRecovered = false;
+        }
+
+        BOOST_CHECK_EQUAL(fRecovered, fLibRecovered);
+        if (fRecovered && fLibRecovered) {
+            BOOST_CHECK(sig == libSig);
+        }
+    }
+}
+
+void FuncLagrangeCache(const bool legacy_scheme)
+{
+    bls::bls_legacy_scheme.store(legacy_scheme);
+
+    const size_t threshold = 4;
+    std::vector<CBLSSecretKey> msk(threshold);
+    for (auto& sk : msk) {
+        sk.MakeNewKey();
+    }
+    const CBLSPublicKey pk = msk[0].GetPublicKey();
+    const uint256 msgHash = GetRandHash();
+
+    std::vector<CBLSId> ids;
+    std::vector<CBLSSignature> sigShares;
+    for (size_t i = 0; i < threshold + 1; i++) {
+        CBLSId id(GetRandHash());
+        CBLSSecretKey skShare;
+        BOOST_CHECK(skShare.SecretKeyShare(msk, id));
+        ids.emplace_back(id);
+        sigShares.emplace_back(skShare.Sign(msgHash));
+    }
+
+    CBLSLagrangeCache::Clear();
+
+    CBLSSignature sig;
+    BOOST_CHECK(sig.Recover({sigShares.begin(), sigShares.begin() + threshold}, {ids.begin(), ids.begin() + threshold}));
+    BOOST_CHECK(sig.VerifyInsecure(pk, msgHash));
+    BOOST_CHECK_EQUAL(CBLSLagrangeCache::Size(), 1U);
+
+    // same set of ids in a different order hits the cache
+    std::vector<CBLSSignature> sigShares2{sigShares.rbegin() + 1, sigShares.rend()};
+    std::vector<CBLSId> ids2{ids.rbegin() + 1, ids.rend()};
+    CBLSSignature sig2;
+    BOOST_CHECK(sig2.Recover(sigShares2, ids2));
+    BOOST_CHECK(sig == sig2);
+    BOOST_CHECK_EQUAL(CBLSLagrangeCache::Size(), 1U);
+
+    // a different set of ids gets its own entry
+    BOOST_CHECK(sig2.Recover({sigShares.begin() + 1, sigShares.end()}, {ids.begin() + 1, ids.end()}));
+    BOOST_CHECK(sig == sig2);
+    BOOST_CHECK_EQUAL(CBLSLagrangeCache::Size(), 2U);
+
+    // duplicate ids are rejected and not cached
+    ids2[0] = ids2[1];
+    BOOST_CHECK(!sig2.Recover(sigShares2, ids2));
+    BOOST_CHECK_EQUAL(CBLSLagrangeCache::Size(), 2U);
+
+    CBLSLagrangeCache::Clear();
+    BOOST_CHECK_EQUAL(CBLSLagrangeCache::Size(), 0U);
+}
+
 struct Message
 {
     uint32_t sourceId;
@@ -278,9 +672,9 @@ static void AddMessage(std::vector<Message>& vec, uint32_t sourceId, uint32_t ms
     vec.emplace_back(m);
 }
 
-static void Verify(std::vector<Message>& vec, bool secureVerification, bool perMessageFallback)
+static void Verify(std::vector<Message>& vec, bool secureVerification, bool perMessageFallback, CBLSWorker* worker = nullptr)
 {
-    CBLSBatchVerifier<uint32_t, uint32_t> batchVerifier(secureVerification, perMessageFallback);
+    CBLSBatchVerifier<uint32_t, uint32_t> batchVerifier(secureVerification, perMessageFallback, 0, worker);
 
     std::set<uint32_t> expectedBadMessages;
     std::set<uint32_t> expectedBadSources;
@@ -304,12 +698,12 @@ static void Verify(std::vector<Message>& vec, bool secureVerification, bool perM
     }
 }
 
-static void Verify(std::vector<Message>& vec)
+static void Verify(std::vector<Message>& vec, CBLSWorker* worker = nullptr)
 {
-    Verify(vec, false, false);
-    Verify(vec, true, false);
-    Verify(vec, false, true);
-    Verify(vec, true, true);
+    Verify(vec, false, false, worker);
+    Verify(vec, true, false, worker);
+    Verify(vec, false, true, worker);
+    Verify(vec, true, true, worker);
 }
 
 void FuncBatchVerifier(const bool legacy_scheme)
@@ -355,6 +749,71 @@ void FuncBatchVerifier(const bool legacy_scheme)
     // last message invalid from one source
     AddMessage(msgs, 1, 7, 1, false);
     Verify(msgs);
+
+    msgs.clear();
+    // multiple invalid messages spread over a larger batch, found by bisection
+    for (uint32_t i = 0; i < 40; i++) {
+        AddMessage(msgs, i % 8, i, uint8_t(i), i % 13 != 5);
+    }
+    Verify(msgs);
+}
+
+void FuncBatchVerifierParallel(const bool legacy_scheme)
+{
+    bls::bls_legacy_scheme.store(legacy_scheme);
+
+    CBLSWorker worker;
+    worker.Start();
+
+    // enough distinct message hashes to be split into multiple shards
+    std::vector<Message> msgs;
+    for (uint32_t i = 0; i < 100; i++) {
+        AddMessage(msgs, i % 10, i, uint8_t(i), true);
+    }
+    Verify(msgs, &worker);
+
+    // invalid sig in one of the shards
+    AddMessage(msgs, 3, 100, 100, false);
+    Verify(msgs, &worker);
+
+    // same message hash from multiple sources ending up in the same shard
+    AddMessage(msgs, 4, 101, 100, true);
+    AddMessage(msgs, 5, 102, 100, false);
+    Verify(msgs, &worker);
+
+    // A pair of messages with swapped signatures is invalid on its own, but the aggregated signature is valid when both
+    // end up in the same shard or bisection range. Messages from other sources must never be marked bad because of it.
+    msgs.clear();
+    for (uint32_t i = 0; i < 100; i++) {
+        AddMessage(msgs, i % 10, i, uint8_t(i), true);
+    }
+    AddMessage(msgs, 20, 100, 100, true);
+    AddMessage(msgs, 20, 101, 101, true);
+    std::swap(msgs[100].sig, msgs[101].sig);
+    AddMessage(msgs, 21, 102, 102, false);
+    for (const bool secure : {false, true}) {
+        for (const bool perMessageFallback : {false, true}) {
+            CBLSBatchVerifier<uint32_t, uint32_t> batchVerifier(secure, perMessageFallback, 0, &worker);
+            for (const auto& m : msgs) {
+                batchVerifier.PushMessage(m.sourceId, m.msgId, m.msgHash, m.sig, m.pk);
+            }
+            batchVerifier.Verify();
+            BOOST_CHECK(batchVerifier.badSources.count(21));
+            for (const auto sourceId : batchVerifier.badSources) {
+                BOOST_CHECK(sourceId == 20 || sourceId == 21);
+            }
+            for (const auto msgId : batchVerifier.badMessages) {
+                BOOST_CHECK(msgId >= 100);
+            }
+        }
+    }
+
+    worker.Stop();
+
+    // a stopped worker verifies on the calling thread
+    msgs.resize(100);
+    AddMessage(msgs, 3, 100, 100, false);
+    Verify(msgs, &worker);
 }
 
 BOOST_AUTO_TEST_CASE(bls_sethexstr_tests)
@@ -405,10 +864,52 @@ BOOST_AUTO_TEST_CASE(bls_dh_exchange_tests)
     FuncDHExchange(false);
 }
 
+BOOST_AUTO_TEST_CASE(bls_lazy_tests)
+{
+    FuncLazy(true);
+    FuncLazy(false);
+}
+
+BOOST_AUTO_TEST_CASE(bls_pubkey_cache_tests)
+{
+    FuncPubKeyCache(true);
+    FuncPubKeyCache(false);
+}
+
+BOOST_AUTO_TEST_CASE(bls_sig_recovery_tests)
+{
+    FuncSigRecovery(true);
+    FuncSigRecovery(false);
+}
+
+BOOST_AUTO_TEST_CASE(bls_sig_recovery_library_tests)
+{
+    FuncSigRecoveryMatchesLibrary(true);
+    FuncSigRecoveryMatchesLibrary(false);
+}
+
+BOOST_AUTO_TEST_CASE(bls_lagrange_cache_tests)
+{
+    FuncLagrangeCache(true);
+    FuncLagrangeCache(false);
+}
+
+BOOST_AUTO_TEST_CASE(bls_mul_insecure_tests)
+{
+    FuncMulInsecure(true);
+    FuncMulInsecure(false);
+}
+
 BOOST_AUTO_TEST_CASE(batch_verifier_tests)
 {
     FuncBatchVerifier(true);
     FuncBatchVerifier(false);
 }
 
+BOOST_AUTO_TEST_CASE(batch_verifier_parallel_tests)
+{
+    FuncBatchVerifierParallel(true);
+    FuncBatchVerifierParallel(false);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,9 +4,11 @@
 
 #include <test/util/setup_common.h>
 
+#include <arith_uint256.h>
 #include <base58.h>
 #include <chainparams.h>
 #include <consensus/validation.h>
+#include <crypto/sha256.h>
 #include <messagesigner.h>
 #include <netbase.h>
 #include <policy/policy.h>
@@ -17,10 +19,12 @@
 #include <spork.h>
 #include <txmempool.h>
 #include <validation.h>
+#include <versionbits.h>
 
 #include <evo/specialtx.h>
 #include <evo/providertx.h>
 #include <evo/deterministicmns.h>
+#include <llmq/context.h>
 #include <llmq/utils.h>
 
 #include <boost/test/unit_test.hpp>
@@ -194,6 +198,24 @@ static CMutableTransaction MalleateProTxPayout(const CMutableTransaction& tx)
     return tx2;
 }
 
+static uint256 GetTestMNHash(uint8_t n)
+{
+    return uint256(std::vector<unsigned char>(32, n + 1));
+}
+
+// masternode with all unique properties derived from n, for tests which work on lists directly
+static CDeterministicMNCPtr MakeTestMN(uint8_t n, int nPoSePenalty = 0)
+{
+    auto dmn = std::make_shared<CDeterministicMN>(n);
+    dmn->proTxHash = GetTestMNHash(n);
+    dmn->collateralOutpoint = COutPoint(dmn->proTxHash, 0);
+    auto state = std::make_shared<CDeterministicMNState>();
+    state->keyIDOwner = CKeyID(uint160(std::vector<unsigned char>(20, n + 1)));
+    state->nPoSePenalty = nPoSePenalty;
+    dmn->pdmnState = state;
+    return dmn;
+}
+
 static CScript GenerateRandomAddress()
 {
     CKey key;
@@ -789,6 +811,114 @@ void FuncVerifyDB(TestChainSetup& setup)
     BOOST_ASSERT(CVerifyDB().VerifyDB(Params(), &::ChainstateActive().CoinsTip(), *(setup.m_node.evodb), 4, 2));
 }
 
+void FuncMNListCacheBudget(TestChainSetup& setup)
+{
+    auto utxos = BuildSimpleUtxoMap(setup.m_coinbase_txns);
+
+    // register one MN per block, then mine some blocks without any list changes
+    for (size_t i = 0; i < 6; i++) {
+        CKey ownerKey;
+        CBLSSecretKey operatorKey;
+        auto tx = CreateProRegTx(*(setup.m_node.mempool), utxos, 1 + i, GenerateRandomAddress(), setup.coinbaseKey, ownerKey, operatorKey);
+        setup.CreateAndProcessBlock({tx}, setup.coinbaseKey);
+        deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    }
+    for (size_t i = 0; i < 20; i++) {
+        setup.CreateAndProcessBlock({}, setup.coinbaseKey);
+        deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    }
+
+    // fill the cache of a fresh manager with all recent lists to see how much memory they take
+    auto fillCache = [] {
+        for (const CBlockIndex* pindex = ::ChainActive().Tip(); pindex != nullptr && pindex->nHeight + 60 > ::ChainActive().Height(); pindex = pindex->pprev) {
+            deterministicMNManager->GetListForBlock(pindex);
+        }
+    };
+    deterministicMNManager.reset(new CDeterministicMNManager(*setup.m_node.evodb, *setup.m_node.connman));
+    deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    fillCache();
+    const size_t nFullUsage = deterministicMNManager->GetCacheMemoryUsage();
+    BOOST_CHECK(nFullUsage > 0);
+
+    // the same with only half of the memory, a burst of lookups for historical blocks must stay within the budget
+    // without waiting for the cleanup of the next block
+    const size_t nBudget = nFullUsage / 2;
+    deterministicMNManager.reset(new CDeterministicMNManager(*setup.m_node.evodb, *setup.m_node.connman, nBudget));
+    deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    for (const CBlockIndex* pindex = ::ChainActive().Tip(); pindex != nullptr && pindex->nHeight + 60 > ::ChainActive().Height(); pindex = pindex->pprev) {
+        deterministicMNManager->GetListForBlock(pindex);
+        BOOST_CHECK(deterministicMNManager->GetCacheMemoryUsage() <= nBudget);
+    }
+
+    setup.CreateAndProcessBlock({}, setup.coinbaseKey);
+    deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    BOOST_CHECK(deterministicMNManager->GetCacheMemoryUsage() <= nBudget);
+    deterministicMNManager->DoMaintenance();
+    BOOST_CHECK(deterministicMNManager->GetCacheMemoryUsage() <= nBudget);
+
+    // evicted lists are rebuilt on demand and are still correct
+    auto tipList = deterministicMNManager->GetListAtChainTip();
+    BOOST_CHECK_EQUAL(tipList.GetAllMNsCount(), 6);
+    BOOST_CHECK_EQUAL(deterministicMNManager->GetListForBlock(::ChainActive()[::ChainActive().Height() - 10]).GetAllMNsCount(), 6);
+}
+
+void FuncProTxBadSig(TestChainSetup& setup)
+{
+    auto utxos = BuildSimpleUtxoMap(setup.m_coinbase_txns);
+
+    std::vector<uint256> dmnHashes;
+    std::vector<CKey> ownerKeys;
+    std::vector<CBLSSecretKey> operatorKeys;
+    std::vector<CMutableTransaction> txns;
+    for (size_t i = 0; i < 2; i++) {
+        CKey ownerKey;
+        CBLSSecretKey operatorKey;
+        auto tx = CreateProRegTx(*(setup.m_node.mempool), utxos, 1 + i, GenerateRandomAddress(), setup.coinbaseKey, ownerKey, operatorKey);
+        dmnHashes.emplace_back(tx.GetHash());
+        ownerKeys.emplace_back(ownerKey);
+        operatorKeys.emplace_back(operatorKey);
+        txns.emplace_back(tx);
+    }
+    setup.CreateAndProcessBlock(txns, setup.coinbaseKey);
+    deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+
+    CKey wrongKey;
+    wrongKey.MakeNewKey(true);
+    CBLSSecretKey wrongOperatorKey;
+    wrongOperatorKey.MakeNewKey();
+
+    auto testBlock = [&](const std::vector<CMutableTransaction>& txns) {
+        const CBlock block = setup.CreateBlock(txns, setup.coinbaseKey);
+        LOCK(cs_main);
+        CValidationState state;
+        TestBlockValidity(state, *setup.m_node.llmq_ctx->clhandler, *setup.m_node.evodb, Params(), block, ::ChainActive().Tip(), false, true);
+        return state;
+    };
+
+    for (const bool fParallel : {true, false}) {
+        g_parallel_script_checks = fParallel;
+
+        // ECDSA payload signatures go through the check queue, the offending tx is named in the result
+        auto goodTx = CreateProUpRegTx(*(setup.m_node.mempool), utxos, dmnHashes[0], ownerKeys[0], operatorKeys[0].GetPublicKey(), ownerKeys[0].GetPubKey().GetID(), GenerateRandomAddress(), setup.coinbaseKey);
+        auto badTx = CreateProUpRegTx(*(setup.m_node.mempool), utxos, dmnHashes[1], wrongKey, operatorKeys[1].GetPublicKey(), ownerKeys[1].GetPubKey().GetID(), GenerateRandomAddress(), setup.coinbaseKey);
+        auto state = testBlock({goodTx, badTx});
+        BOOST_CHECK(!state.IsValid());
+        BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-protx-sig");
+        BOOST_CHECK(state.GetDebugMessage().find(badTx.GetHash().ToString()) != std::string::npos);
+        BOOST_CHECK(testBlock({goodTx}).IsValid());
+
+        // BLS payload signatures are verified in one batch for the whole block
+        goodTx = CreateProUpServTx(*(setup.m_node.mempool), utxos, dmnHashes[0], operatorKeys[0], 100, CScript(), setup.coinbaseKey);
+        badTx = CreateProUpServTx(*(setup.m_node.mempool), utxos, dmnHashes[1], wrongOperatorKey, 101, CScript(), setup.coinbaseKey);
+        state = testBlock({badTx, goodTx});
+        BOOST_CHECK(!state.IsValid());
+        BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-protx-sig");
+        BOOST_CHECK(state.GetDebugMessage().find(badTx.GetHash().ToString()) != std::string::npos);
+        BOOST_CHECK(testBlock({goodTx}).IsValid());
+    }
+    g_parallel_script_checks = true;
+}
+
 BOOST_AUTO_TEST_SUITE(evo_dip3_activation_tests)
 
 // DIP3 can only be activated with legacy scheme (v19 is activated later)
@@ -841,6 +971,293 @@ BOOST_AUTO_TEST_CASE(test_mempool_dual_proregtx_basic)
     FuncTestMempoolDualProregtx(setup);
 }
 
+BOOST_AUTO_TEST_CASE(protx_bad_sig_basic)
+{
+    TestChainDIP3V19Setup setup;
+    FuncProTxBadSig(setup);
+}
+
+BOOST_AUTO_TEST_CASE(mnlist_set_mns_from_base)
+{
+    BasicTestingSetup setup;
+
+    CDeterministicMNList base(uint256::ONE, 1, 10);
+    for (uint8_t i = 0; i < 10; i++) {
+        base.AddMN(MakeTestMN(i), false);
+    }
+
+    // new objects for all entries, like when read from disk: #3 changed, #9 removed and #10 added
+    std::vector<CDeterministicMNCPtr> dmns;
+    for (uint8_t i = 0; i < 9; i++) {
+        dmns.emplace_back(MakeTestMN(i, i == 3 ? 10 : 0));
+    }
+    dmns.emplace_back(MakeTestMN(10));
+
+    CDeterministicMNList mnList(uint256::ONE, 2, 11);
+    // #3 is removed and added again
+    BOOST_CHECK_EQUAL(mnList.SetMNsFromBase(base, dmns), 4U);
+    BOOST_CHECK_EQUAL(mnList.GetAllMNsCount(), 10U);
+    for (uint8_t i = 0; i < 9; i++) {
+        const uint256 proTxHash = GetTestMNHash(i);
+        // equal entries are taken over from the base list, even though they are different objects
+        BOOST_CHECK(mnList.GetMN(proTxHash) == (i == 3 ? dmns[i] : base.GetMN(proTxHash)));
+    }
+    BOOST_CHECK_EQUAL(mnList.GetMN(GetTestMNHash(3))->pdmnState->nPoSePenalty, 10);
+    BOOST_CHECK(!mnList.HasMN(GetTestMNHash(9)));
+    BOOST_CHECK(mnList.GetMN(GetTestMNHash(10)) == dmns[9]);
+
+    // same result as building the list from scratch
+    CDeterministicMNList expected(uint256::ONE, 2, 11);
+    for (const auto& dmn : dmns) {
+        expected.AddMN(dmn, false);
+    }
+    BOOST_CHECK(::SerializeHash(mnList) == ::SerializeHash(expected));
+
+    // nothing to change
+    CDeterministicMNList mnList2(uint256::ONE, 2, 11);
+    BOOST_CHECK_EQUAL(mnList2.SetMNsFromBase(mnList, dmns), 0U);
+    BOOST_CHECK(::SerializeHash(mnList2) == ::SerializeHash(expected));
+}
+
+BOOST_AUTO_TEST_CASE(mnlist_snapshot_roundtrip)
+{
+    BasicTestingSetup setup;
+
+    CDeterministicMNList mnList1(uint256S("aa"), 100, 10);
+    CDeterministicMNList mnList2(uint256S("bb"), 200, 10);
+    for (uint8_t i = 0; i < 10; i++) {
+        mnList1.AddMN(MakeTestMN(i), false);
+        mnList2.AddMN(MakeTestMN(i, i < 3 ? 5 : 0), false);
+    }
+
+    LOCK(deterministicMNManager->cs);
+    deterministicMNManager->WriteListSnapshot(mnList1, uint256());
+
+    // entries which are referenced by the previous snapshot already are not written again
+    const auto unchangedKey = std::make_pair(std::string("dmn_E4"), ::SerializeHash(*mnList1.GetMN(GetTestMNHash(5))));
+    const auto changedKey = std::make_pair(std::string("dmn_E4"), ::SerializeHash(*mnList2.GetMN(GetTestMNHash(0))));
+    BOOST_CHECK(setup.m_node.evodb->Exists(unchangedKey));
+    setup.m_node.evodb->Erase(unchangedKey);
+    deterministicMNManager->WriteListSnapshot(mnList2, mnList1.GetBlockHash());
+    BOOST_CHECK(!setup.m_node.evodb->Exists(unchangedKey));
+    BOOST_CHECK(setup.m_node.evodb->Exists(changedKey));
+    setup.m_node.evodb->Write(unchangedKey, *mnList1.GetMN(GetTestMNHash(5)));
+    BOOST_CHECK(deterministicMNManager->HasListSnapshot(mnList1.GetBlockHash()));
+    BOOST_CHECK(deterministicMNManager->IsListSnapshotFormatSupported());
+
+    CDeterministicMNList read1, read2;
+    size_t nChanged{0};
+    BOOST_CHECK(deterministicMNManager->ReadListSnapshot(mnList1.GetBlockHash(), read1, nChanged));
+    BOOST_CHECK(deterministicMNManager->ReadListSnapshot(mnList2.GetBlockHash(), read2, nChanged));
+    BOOST_CHECK(!deterministicMNManager->ReadListSnapshot(uint256S("cc"), read2, nChanged));
+    for (const auto& [mnList, read] : {std::make_pair(mnList1, read1), std::make_pair(mnList2, read2)}) {
+        BOOST_CHECK(read.GetBlockHash() == mnList.GetBlockHash());
+        BOOST_CHECK_EQUAL(read.GetHeight(), mnList.GetHeight());
+        BOOST_CHECK_EQUAL(read.GetTotalRegisteredCount(), mnList.GetTotalRegisteredCount());
+        BOOST_CHECK(::SerializeHash(read) == ::SerializeHash(mnList));
+    }
+    // entries which are equal in both snapshots are the same objects in memory
+    for (uint8_t i = 0; i < 10; i++) {
+        const uint256 proTxHash = GetTestMNHash(i);
+        BOOST_CHECK_EQUAL(read1.GetMN(proTxHash) == read2.GetMN(proTxHash), i >= 3);
+    }
+
+    // snapshots in the format before entries were shared are still read
+    CDeterministicMNList oldList(uint256S("dd"), 300, 10);
+    for (uint8_t i = 0; i < 5; i++) {
+        oldList.AddMN(MakeTestMN(i), false);
+    }
+    setup.m_node.evodb->Write(std::make_pair(std::string("dmn_S3"), oldList.GetBlockHash()), oldList);
+    BOOST_CHECK(deterministicMNManager->HasListSnapshot(oldList.GetBlockHash()));
+    CDeterministicMNList readOld;
+    BOOST_CHECK(deterministicMNManager->ReadListSnapshot(oldList.GetBlockHash(), readOld, nChanged));
+    BOOST_CHECK_EQUAL(nChanged, 5U);
+    BOOST_CHECK(::SerializeHash(readOld) == ::SerializeHash(oldList));
+
+    // a format written by a newer version is refused
+    setup.m_node.evodb->Write(std::string("dmn_SF"), uint8_t{2});
+    BOOST_CHECK(!deterministicMNManager->IsListSnapshotFormatSupported());
+}
+
+BOOST_AUTO_TEST_CASE(mnlist_cache_budget)
+{
+    TestChainDIP3Setup setup;
+    FuncMNListCacheBudget(setup);
+}
+
+BOOST_AUTO_TEST_CASE(mnlist_cache_eviction_order)
+{
+    const uint256 h1 = uint256S("01"), h2 = uint256S("02"), h3 = uint256S("03");
+    std::vector<CMNListCacheEvictionCandidate> candidates{
+        {3.0, 100, h3, true},
+        {1.0, 100, h1, false},
+        {2.0, 50, h2, true},
+    };
+
+    // lowest priority goes first, and only as many as needed to get back into the budget
+    BOOST_CHECK_EQUAL(SelectMNListCacheEvictions(candidates, 400, 250), 2U);
+    BOOST_CHECK(candidates[0].blockHash == h1);
+    BOOST_CHECK(candidates[1].blockHash == h2);
+    BOOST_CHECK(candidates[2].blockHash == h3);
+
+    BOOST_CHECK_EQUAL(SelectMNListCacheEvictions(candidates, 400, 300), 1U);
+    BOOST_CHECK_EQUAL(SelectMNListCacheEvictions(candidates, 250, 250), 0U);
+    // budget can't be reached (e.g. because of pinned lists), everything which can go goes
+    BOOST_CHECK_EQUAL(SelectMNListCacheEvictions(candidates, 1000, 100), 3U);
+}
+
+// masternode with a random payment, ban and confirmation state
+static CDeterministicMNCPtr MakeRandomTestMN(uint8_t n)
+{
+    auto dmn = std::make_shared<CDeterministicMN>(*MakeTestMN(n));
+    dmn->nType = InsecureRandRange(4) == 0 ? MnType::HighPerformance : MnType::Regular;
+    auto state = std::make_shared<CDeterministicMNState>(*dmn->pdmnState);
+    state->nRegisteredHeight = 1 + InsecureRandRange(10);
+    state->nLastPaidHeight = InsecureRandRange(3) == 0 ? 0 : InsecureRandRange(20);
+    if (InsecureRandRange(5) == 0) {
+        state->nPoSeRevivedHeight = InsecureRandRange(20);
+    }
+    if (InsecureRandRange(4) == 0) {
+        state->BanIfNotBanned(10);
+    }
+    if (InsecureRandRange(5) != 0) {
+        state->UpdateConfirmedHash(dmn->proTxHash, InsecureRand256());
+    }
+    dmn->pdmnState = state;
+    return dmn;
+}
+
+// Same as GetMNPayee/CalculateScores/Get*Count, but computed by walking the immer map of the list
+static void CheckFlatViewAgainstList(const CDeterministicMNList& mnList, const CBlockIndex* pindex)
+{
+    size_t nValid{0}, nValidWeighted{0}, nHPMN{0}, nValidHPMN{0};
+    CDeterministicMNCPtr expectedPayee;
+    const auto getPaymentHeight = [](const CDeterministicMN& dmn) {
+        int height = dmn.pdmnState->nLastPaidHeight;
+        if (dmn.pdmnState->nPoSeRevivedHeight != -1 && dmn.pdmnState->nPoSeRevivedHeight > height) {
+            height = dmn.pdmnState->nPoSeRevivedHeight;
+        } else if (height == 0) {
+            height = dmn.pdmnState->nRegisteredHeight;
+        }
+        return height;
+    };
+    const uint256 modifier = InsecureRand256();
+    std::map<uint256, arith_uint256> expectedScores;
+    std::map<uint256, arith_uint256> expectedHPMNScores;
+    mnList.ForEachMNShared(false, [&](const CDeterministicMNCPtr& dmn) {
+        const bool fHPMN = dmn->nType == MnType::HighPerformance;
+        if (fHPMN) nHPMN++;
+        if (!CDeterministicMNList::IsMNValid(*dmn)) return;
+        nValid++;
+        nValidWeighted += GetMnType(dmn->nType).voting_weight;
+        if (fHPMN) nValidHPMN++;
+        if (expectedPayee == nullptr || getPaymentHeight(*dmn) < getPaymentHeight(*expectedPayee) ||
+            (getPaymentHeight(*dmn) == getPaymentHeight(*expectedPayee) && dmn->proTxHash < expectedPayee->proTxHash)) {
+            expectedPayee = dmn;
+        }
+        if (dmn->pdmnState->confirmedHash.IsNull()) return;
+        uint256 h;
+        CSHA256()
+            .Write(dmn->pdmnState->confirmedHashWithProRegTxHash.begin(), 32)
+            .Write(modifier.begin(), 32)
+            .Finalize(h.begin());
+        expectedScores.emplace(dmn->proTxHash, UintToArith256(h));
+        if (fHPMN) expectedHPMNScores.emplace(dmn->proTxHash, UintToArith256(h));
+    });
+
+    BOOST_CHECK_EQUAL(mnList.GetValidMNsCount(), nValid);
+    BOOST_CHECK_EQUAL(mnList.GetValidWeightedMNsCount(), nValidWeighted);
+    BOOST_CHECK_EQUAL(mnList.GetAllHPMNsCount(), nHPMN);
+    BOOST_CHECK_EQUAL(mnList.GetValidHPMNsCount(), nValidHPMN);
+    // walking the valid masternodes gives the same result with and without a built view
+    std::vector<CDeterministicMNCPtr> expectedValid;
+    mnList.ForEachMNShared(false, [&](const CDeterministicMNCPtr& dmn) {
+        if (CDeterministicMNList::IsMNValid(*dmn)) expectedValid.emplace_back(dmn);
+    });
+    const auto getValid = [&]() {
+        std::vector<CDeterministicMNCPtr> ret;
+        mnList.ForEachMNShared(true, [&](const CDeterministicMNCPtr& dmn) { ret.emplace_back(dmn); });
+        return ret;
+    };
+    if (mnList.GetFlatViewIfBuilt() == nullptr) {
+        BOOST_CHECK(getValid() == expectedValid);
+    }
+    BOOST_CHECK(mnList.GetFlatView() != nullptr);
+    BOOST_CHECK(getValid() == expectedValid);
+    BOOST_CHECK_EQUAL(mnList.GetFlatView()->nValidCount, nValid);
+    BOOST_CHECK_EQUAL(mnList.GetFlatView()->nValidWeightedCount, nValidWeighted);
+    BOOST_CHECK(mnList.GetMNPayee(pindex) == expectedPayee);
+
+    for (const bool onlyHPMN : {false, true}) {
+        const auto& expected = onlyHPMN ? expectedHPMNScores : expectedScores;
+        const auto scores = mnList.CalculateScores(modifier, onlyHPMN);
+        BOOST_CHECK_EQUAL(scores.size(), expected.size());
+        for (const auto& [score, dmn] : scores) {
+            auto it = expected.find(dmn->proTxHash);
+            BOOST_CHECK(it != expected.end() && it->second == score);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(mnlist_flat_view)
+{
+    BasicTestingSetup setup;
+
+    // v19 is not active at this block, so GetMNPayee only uses the payment order
+    const uint256 blockHash = InsecureRand256();
+    CBlockIndex index;
+    index.phashBlock = &blockHash;
+    index.nHeight = 20;
+
+    CDeterministicMNList mnList(blockHash, 20, 0);
+    for (uint8_t i = 0; i < 100; i++) {
+        mnList.AddMN(MakeRandomTestMN(i));
+    }
+    CheckFlatViewAgainstList(mnList, &index);
+
+    // copies share the view until one of them gets modified
+    CDeterministicMNList mnList2 = mnList;
+    BOOST_CHECK(mnList2.GetFlatView() == mnList.GetFlatView());
+
+    for (int round = 0; round < 20; round++) {
+        const auto oldView = mnList.GetFlatView();
+        const uint8_t n = InsecureRandRange(120);
+        const auto dmn = mnList2.GetMN(GetTestMNHash(n));
+        if (dmn == nullptr) {
+            mnList2.AddMN(MakeRandomTestMN(n));
+        } else if (InsecureRandBool()) {
+            mnList2.RemoveMN(dmn->proTxHash);
+        } else {
+            // what DecreasePoSePenalties/PoSePunish and payments do to every block
+            auto newState = std::make_shared<CDeterministicMNState>(*MakeRandomTestMN(n)->pdmnState);
+            mnList2.UpdateMN(*dmn, newState);
+        }
+        CheckFlatViewAgainstList(mnList2, &index);
+        BOOST_CHECK(mnList2.GetFlatView() != oldView);
+        // the unmodified list keeps its view
+        BOOST_CHECK(mnList.GetFlatView() == oldView);
+        CheckFlatViewAgainstList(mnList, &index);
+    }
+
+    // the view follows the list order
+    const auto view = mnList2.GetFlatView();
+    size_t i{0};
+    mnList2.ForEachMNShared(false, [&](const CDeterministicMNCPtr& dmn) {
+        BOOST_CHECK(i < view->size() && view->dmns[i] == dmn && view->proTxHashes[i] == dmn->proTxHash);
+        i++;
+    });
+    BOOST_CHECK_EQUAL(i, view->size());
+
+    // the counts are rebuilt when reading a list
+    CDataStream ds(SER_DISK, CLIENT_VERSION);
+    ds << mnList2;
+    CDeterministicMNList mnList3;
+    ds >> mnList3;
+    CheckFlatViewAgainstList(mnList3, &index);
+
+    WITH_LOCK(llmq::cs_llmq_vbc, llmq::llmq_versionbitscache.Clear());
+}
+
 //This one can be started only with legacy scheme, since inside undo block will switch it back to legacy resulting into an inconsistency
 BOOST_AUTO_TEST_CASE(verify_db_legacy)
 {
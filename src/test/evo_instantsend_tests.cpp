@@ -37,4 +37,56 @@ BOOST_AUTO_TEST_CASE(instantsend_CInstantSendLock_tests)
     }
 }
 
+BOOST_AUTO_TEST_CASE(instantsend_key_filter_tests)
+{
+    llmq::CInstantSendKeyFilter filter;
+
+    std::vector<uint256> txids;
+    std::vector<COutPoint> outpoints;
+    for (int i = 0; i < 1000; i++) {
+        txids.emplace_back(InsecureRand256());
+        outpoints.emplace_back(InsecureRand256(), InsecureRandRange(10));
+        filter.Insert(txids.back());
+        filter.Insert(outpoints.back());
+    }
+    for (int i = 0; i < 1000; i++) {
+        BOOST_CHECK(filter.MayContain(txids[i]));
+        BOOST_CHECK(filter.MayContain(outpoints[i]));
+    }
+
+    size_t falsePositives = 0;
+    for (int i = 0; i < 1000; i++) {
+        falsePositives += filter.MayContain(InsecureRand256());
+        falsePositives += filter.MayContain(COutPoint(txids[i], 10));
+    }
+    BOOST_CHECK(falsePositives < 20);
+    BOOST_CHECK(!filter.NeedsRebuild());
+
+    filter.Removed(llmq::CInstantSendKeyFilter::MIN_CAPACITY + 1);
+    BOOST_CHECK(filter.NeedsRebuild());
+    filter.Reset(0);
+    BOOST_CHECK(!filter.NeedsRebuild());
+    BOOST_CHECK(!filter.MayContain(txids[0]));
+}
+
+BOOST_AUTO_TEST_CASE(instantsend_db_lookup_tests)
+{
+    llmq::CInstantSendLock islock;
+    islock.txid = InsecureRand256();
+    islock.inputs.emplace_back(InsecureRand256(), 1);
+    islock.inputs.emplace_back(InsecureRand256(), 0);
+    const uint256 hash = ::SerializeHash(islock);
+
+    llmq::CInstantSendDb db(true, true);
+    BOOST_CHECK(db.GetInstantSendLockByTxid(islock.txid) == nullptr);
+    db.WriteNewInstantSendLock(hash, islock);
+
+    BOOST_CHECK(db.GetInstantSendLockHashByTxid(islock.txid) == hash);
+    for (const auto& in : islock.inputs) {
+        BOOST_CHECK(db.GetInstantSendLockByInput(in) != nullptr);
+    }
+    BOOST_CHECK(db.GetInstantSendLockHashByTxid(InsecureRand256()).IsNull());
+    BOOST_CHECK(db.GetInstantSendLockByInput(COutPoint(islock.txid, 0)) == nullptr);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 #include <test/util/setup_common.h>
 
 #include <bls/bls.h>
+#include <consensus/merkle.h>
 #include <evo/simplifiedmns.h>
 #include <netbase.h>
 
@@ -69,4 +70,81 @@ BOOST_AUTO_TEST_CASE(simplifiedmns_merkleroots)
 
     BOOST_CHECK(expectedMerkleRoot == calculatedMerkleRoot);
 }
+
+BOOST_AUTO_TEST_CASE(simplifiedmns_merkletree)
+{
+    CSimplifiedMNListMerkleTree tree;
+    std::map<uint256, uint256> expected;
+
+    BOOST_CHECK(tree.GetRoot() == uint256());
+
+    for (int i = 0; i < 400; i++) {
+        // a few changes between each root calculation, just like blocks do
+        const int nChanges = InsecureRandRange(8);
+        for (int j = 0; j < nChanges; j++) {
+            if (!expected.empty() && InsecureRandBool()) {
+                auto it = std::next(expected.begin(), InsecureRandRange(expected.size()));
+                if (InsecureRandBool()) {
+                    tree.Remove(it->first);
+                    expected.erase(it);
+                } else {
+                    it->second = InsecureRand256();
+                    tree.Set(it->first, it->second);
+                }
+            } else {
+                const uint256 proRegTxHash = InsecureRand256();
+                expected[proRegTxHash] = InsecureRand256();
+                tree.Set(proRegTxHash, expected[proRegTxHash]);
+            }
+        }
+
+        std::vector<uint256> leaves;
+        for (const auto& p : expected) {
+            leaves.emplace_back(p.second);
+        }
+        bool mutated1, mutated2;
+        BOOST_CHECK_EQUAL(tree.GetRoot(&mutated1).ToString(), ComputeMerkleRoot(leaves, &mutated2).ToString());
+        BOOST_CHECK_EQUAL(mutated1, mutated2);
+        BOOST_CHECK_EQUAL(tree.Size(), expected.size());
+    }
+
+    tree.Clear();
+    BOOST_CHECK(tree.GetRoot() == uint256());
+}
+
+BOOST_AUTO_TEST_CASE(mnlist_response_cache)
+{
+    CMNListResponseCache cache(250);
+    const uint256 key1 = uint256S("01"), key2 = uint256S("02"), key3 = uint256S("03");
+
+    std::vector<unsigned char> data;
+    BOOST_CHECK(!cache.Get(key1, data));
+    cache.Add(key1, std::vector<unsigned char>(100, 1));
+    cache.Add(key2, std::vector<unsigned char>(100, 2));
+    BOOST_CHECK_EQUAL(cache.Size(), 2U);
+    BOOST_CHECK_EQUAL(cache.GetBytes(), 200U);
+
+    // key1 becomes the most recently used entry, so key2 must be evicted when key3 doesn't fit into the budget
+    BOOST_REQUIRE(cache.Get(key1, data));
+    BOOST_CHECK(data == std::vector<unsigned char>(100, 1));
+    cache.Add(key3, std::vector<unsigned char>(100, 3));
+    BOOST_CHECK_EQUAL(cache.Size(), 2U);
+    BOOST_CHECK_EQUAL(cache.GetBytes(), 200U);
+    BOOST_CHECK(cache.Get(key1, data));
+    BOOST_CHECK(!cache.Get(key2, data));
+    BOOST_CHECK(cache.Get(key3, data));
+    BOOST_CHECK(data == std::vector<unsigned char>(100, 3));
+    BOOST_CHECK_EQUAL(cache.GetHits(), 3U);
+    BOOST_CHECK_EQUAL(cache.GetMisses(), 2U);
+
+    // responses larger than the whole budget are not cached
+    cache.Add(key2, std::vector<unsigned char>(300, 2));
+    BOOST_CHECK(!cache.Get(key2, data));
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Size(), 0U);
+    BOOST_CHECK_EQUAL(cache.GetBytes(), 0U);
+    BOOST_CHECK(!cache.Get(key1, data));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,7 @@
 #include <llmq/quorums.h>
 
 #include <chainparams.h>
+#include <versionbits.h>
 
 #include <validation.h>
 
@@ -51,4 +52,44 @@ BOOST_FIXTURE_TEST_CASE(utils_IsQuorumTypeEnabled_tests_mainnet, TestingSetup)
     Test(*m_node.llmq_ctx->qman);
 }
 
+BOOST_FIXTURE_TEST_CASE(utils_IsQuorumBaseBlock_tests, RegTestingSetup)
+{
+    using namespace llmq::utils;
+    const auto& consensus_params = Params().GetConsensus();
+    const auto params = llmq::GetLLMQParams(Consensus::LLMQType::LLMQ_TEST).value();
+    const auto rotation_params = llmq::GetLLMQParams(Consensus::LLMQType::LLMQ_TEST_DIP0024).value();
+    BOOST_REQUIRE(!params.useRotation && rotation_params.useRotation && rotation_params.signingActiveQuorumCount > 1);
+
+    // every block signals DIP0024, so it's active from the fourth window on
+    const auto& deployment = consensus_params.vDeployments[Consensus::DEPLOYMENT_DIP0024];
+    std::vector<CBlockIndex> blocks(deployment.nWindowSize * 4 + rotation_params.dkgInterval * 2);
+    for (size_t i = 0; i < blocks.size(); i++) {
+        blocks[i].nHeight = i;
+        blocks[i].pprev = i > 0 ? &blocks[i - 1] : nullptr;
+        blocks[i].nVersion = VERSIONBITS_TOP_BITS | (1 << deployment.bit);
+        blocks[i].nTime = Params().GenesisBlock().nTime + i;
+        blocks[i].BuildSkip();
+    }
+    WITH_LOCK(llmq::cs_llmq_vbc, llmq::llmq_versionbitscache.Clear());
+
+    // before DIP0024, rotated quorum types get a single quorum per interval like all others
+    const int nBeforeHeight = rotation_params.dkgInterval * 2;
+    BOOST_REQUIRE(!IsDIP0024Active(&blocks[nBeforeHeight]));
+    for (int i = 0; i < rotation_params.dkgInterval; i++) {
+        BOOST_CHECK_EQUAL(IsQuorumBaseBlock(params, &blocks[nBeforeHeight + i]), i == 0);
+        BOOST_CHECK_EQUAL(IsQuorumBaseBlock(rotation_params, &blocks[nBeforeHeight + i]), i == 0);
+    }
+
+    // with rotation, the first signingActiveQuorumCount blocks of a cycle are base blocks
+    const int nAfterHeight = blocks.size() - rotation_params.dkgInterval - blocks.size() % rotation_params.dkgInterval;
+    BOOST_REQUIRE(IsQuorumRotationEnabled(rotation_params, &blocks[nAfterHeight]));
+    for (int i = 0; i < rotation_params.dkgInterval; i++) {
+        BOOST_CHECK_EQUAL(IsQuorumBaseBlock(params, &blocks[nAfterHeight + i]), i % params.dkgInterval == 0);
+        BOOST_CHECK_EQUAL(IsQuorumBaseBlock(rotation_params, &blocks[nAfterHeight + i]), i < rotation_params.signingActiveQuorumCount);
+    }
+
+    // the cache refers to the blocks above, don't leave it behind
+    WITH_LOCK(llmq::cs_llmq_vbc, llmq::llmq_versionbitscache.Clear());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,163 @@
+// Copyright (c) 2023 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/util/setup_common.h>
+
+#include <llmq/chainlocks.h>
+
+#include <algorithm>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace llmq;
+
+BOOST_FIXTURE_TEST_SUITE(llmq_chainlocks_tests, BasicTestingSetup)
+
+static std::vector<uint256> Sorted(std::vector<uint256> v)
+{
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+BOOST_AUTO_TEST_CASE(block_txs_not_locked)
+{
+    const uint256 block1 = InsecureRand256();
+    const uint256 block2 = InsecureRand256();
+    const uint256 tx1 = InsecureRand256();
+    const uint256 tx2 = InsecureRand256();
+    const uint256 tx3 = InsecureRand256();
+
+    CBlockTxsNotLocked tracker;
+    // tx2 is included in both blocks (e.g. a reorg to a competing block)
+    tracker.AddBlock(block1, {tx1, tx2});
+    tracker.AddBlock(block2, {tx2, tx3});
+    BOOST_CHECK_EQUAL(tracker.GetBlockCount(), 2U);
+    BOOST_CHECK(Sorted(tracker.GetTxs(block1)) == Sorted({tx1, tx2}));
+    BOOST_CHECK(Sorted(tracker.GetTxs(block2)) == Sorted({tx2, tx3}));
+
+    // unknown TXs don't touch any block
+    BOOST_CHECK(!tracker.TxLocked(InsecureRand256()));
+
+    BOOST_CHECK(!tracker.TxLocked(tx2));
+    BOOST_CHECK(tracker.GetTxs(block1) == std::vector<uint256>{tx1});
+    BOOST_CHECK(tracker.GetTxs(block2) == std::vector<uint256>{tx3});
+
+    // locking the last TX of a block makes it safe, locking it again doesn't report it again
+    BOOST_CHECK(tracker.TxLocked(tx1));
+    BOOST_CHECK(tracker.GetTxs(block1).empty());
+    BOOST_CHECK(!tracker.TxLocked(tx1));
+
+    // a removed islock puts the TX back into all blocks including it
+    tracker.TxUnlocked(tx2);
+    BOOST_CHECK(tracker.GetTxs(block1) == std::vector<uint256>{tx2});
+    BOOST_CHECK(Sorted(tracker.GetTxs(block2)) == Sorted({tx2, tx3}));
+
+    BOOST_CHECK(!tracker.TxLocked(tx3));
+    BOOST_CHECK(tracker.TxLocked(tx2));
+    BOOST_CHECK(tracker.GetTxs(block1).empty());
+    BOOST_CHECK(tracker.GetTxs(block2).empty());
+
+    // removed blocks are not tracked anymore, neither by block nor by txid
+    tracker.RemoveBlock(block1, {tx1, tx2});
+    BOOST_CHECK(!tracker.HasBlock(block1));
+    BOOST_CHECK(tracker.HasBlock(block2));
+    tracker.TxUnlocked(tx1);
+    tracker.TxUnlocked(tx2);
+    BOOST_CHECK(!tracker.HasBlock(block1));
+    BOOST_CHECK(tracker.GetTxs(block2) == std::vector<uint256>{tx2});
+
+    tracker.RemoveBlock(block2, {tx2, tx3});
+    BOOST_CHECK_EQUAL(tracker.GetBlockCount(), 0U);
+    tracker.TxUnlocked(tx2);
+    BOOST_CHECK_EQUAL(tracker.GetBlockCount(), 0U);
+    BOOST_CHECK(!tracker.TxLocked(tx2));
+}
+
+BOOST_AUTO_TEST_CASE(block_txs_not_locked_readd)
+{
+    // BlockConnected might see a block again after GetBlockTxsNotLocked initialized it from disk
+    const uint256 block = InsecureRand256();
+    const uint256 tx1 = InsecureRand256();
+    const uint256 tx2 = InsecureRand256();
+
+    CBlockTxsNotLocked tracker;
+    tracker.AddBlock(block, {tx1});
+    BOOST_CHECK(tracker.TxLocked(tx1));
+    tracker.AddBlock(block, {tx1, tx2});
+    BOOST_CHECK(Sorted(tracker.GetTxs(block)) == Sorted({tx1, tx2}));
+
+    // the txid index must not contain the block twice, so that a single removal cleans it up
+    BOOST_CHECK(!tracker.TxLocked(tx1));
+    BOOST_CHECK(tracker.TxLocked(tx2));
+    tracker.RemoveBlock(block, {tx1, tx2});
+    tracker.TxUnlocked(tx1);
+    BOOST_CHECK_EQUAL(tracker.GetBlockCount(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(tx_recheck_queue_rotation)
+{
+    const uint256 tx1 = InsecureRand256();
+    const uint256 tx2 = InsecureRand256();
+    const uint256 tx3 = InsecureRand256();
+
+    // recheck after 120 seconds, in buckets of 30 seconds
+    CTxRecheckQueue queue(120, 30);
+    queue.Schedule(tx1, 1000);
+    queue.Schedule(tx2, 1019);
+    queue.Schedule(tx3, 1020);
+    BOOST_CHECK_EQUAL(queue.GetBucketCount(), 2U);
+    BOOST_CHECK_EQUAL(queue.GetScheduledCount(), 3U);
+
+    // the first bucket starts at 990 and expires at 1110, the second one at 1140
+    BOOST_CHECK(queue.PopDue(1109).empty());
+    BOOST_CHECK(Sorted(queue.PopDue(1110)) == Sorted({tx1, tx2}));
+    BOOST_CHECK_EQUAL(queue.GetBucketCount(), 1U);
+    BOOST_CHECK(queue.PopDue(1110).empty());
+
+    // TXs which are still tracked get re-scheduled into a new bucket at the end
+    queue.Schedule(tx1, 1110);
+    BOOST_CHECK(queue.PopDue(1139).empty());
+    BOOST_CHECK(queue.PopDue(1140) == std::vector<uint256>{tx3});
+    BOOST_CHECK(queue.PopDue(1229).empty());
+    BOOST_CHECK(queue.PopDue(1230) == std::vector<uint256>{tx1});
+    BOOST_CHECK_EQUAL(queue.GetBucketCount(), 0U);
+    BOOST_CHECK_EQUAL(queue.GetScheduledCount(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(tx_recheck_queue_schedule_now)
+{
+    const uint256 tx1 = InsecureRand256();
+    const uint256 tx2 = InsecureRand256();
+
+    CTxRecheckQueue queue(120, 30);
+    queue.Schedule(tx1, 1000);
+    queue.Schedule(tx2, 1000);
+
+    // scheduling twice into the same bucket doesn't return the TX twice
+    queue.Schedule(tx1, 1001);
+    BOOST_CHECK_EQUAL(queue.GetScheduledCount(), 2U);
+
+    // TXs made due now are returned once, their old bucket entry is dropped
+    queue.ScheduleNow({tx1, tx1, InsecureRand256()});
+    BOOST_CHECK_EQUAL(queue.GetScheduledCount(), 2U);
+    BOOST_CHECK(queue.PopDue(1001) == std::vector<uint256>{tx1});
+    BOOST_CHECK(queue.PopDue(1001).empty());
+    BOOST_CHECK(queue.PopDue(1110) == std::vector<uint256>{tx2});
+
+    // re-scheduling a TX into a later bucket makes the old entry stale
+    queue.Schedule(tx1, 1110);
+    queue.Schedule(tx1, 1200);
+    BOOST_CHECK_EQUAL(queue.GetBucketCount(), 2U);
+    BOOST_CHECK(queue.PopDue(1230).empty());
+    BOOST_CHECK_EQUAL(queue.GetBucketCount(), 1U);
+    BOOST_CHECK(queue.PopDue(1320) == std::vector<uint256>{tx1});
+
+    // a clock going backwards doesn't break the ordering of the buckets
+    queue.Schedule(tx1, 2000);
+    queue.Schedule(tx2, 1900);
+    BOOST_CHECK_EQUAL(queue.GetBucketCount(), 1U);
+    BOOST_CHECK(Sorted(queue.PopDue(2100)) == Sorted({tx1, tx2}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,319 @@
+// Copyright (c) 2023 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/util/setup_common.h>
+
+#include <arith_uint256.h>
+#include <llmq/signing_shares.h>
+#include <streams.h>
+#include <util/strencodings.h>
+#include <version.h>
+
+#include <future>
+#include <map>
+#include <set>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace llmq;
+
+BOOST_FIXTURE_TEST_SUITE(llmq_signing_shares_tests, BasicTestingSetup)
+
+static std::vector<bool> RandomBits(size_t size, int density)
+{
+    std::vector<bool> vec(size);
+    for (size_t i = 0; i < size; i++) {
+        vec[i] = InsecureRandRange(100) < uint64_t(density);
+    }
+    return vec;
+}
+
+BOOST_AUTO_TEST_CASE(bitset_ops)
+{
+    for (const size_t size : {1, 50, 63, 64, 65, 128, 400, 512}) {
+        const auto vec1 = RandomBits(size, 30);
+        const auto vec2 = RandomBits(size, 30);
+
+        CQuorumMemberBitSet b1, b2;
+        b1.Resize(size);
+        b2.Resize(size);
+        for (size_t i = 0; i < size; i++) {
+            b1.Set(i, vec1[i]);
+            b2.Set(i, vec2[i]);
+        }
+
+        std::vector<size_t> setBits;
+        b1.ForEachSet([&](size_t i) { setBits.emplace_back(i); });
+        BOOST_CHECK_EQUAL(setBits.size(), b1.Count());
+        BOOST_CHECK_EQUAL(b1.Any(), !setBits.empty());
+        for (size_t i = 0, j = 0; i < size; i++) {
+            BOOST_CHECK_EQUAL(b1.Get(i), bool(vec1[i]));
+            if (vec1[i]) {
+                BOOST_CHECK_EQUAL(setBits[j++], i);
+            }
+        }
+
+        auto bOr = b1, bAnd = b1, bAndNot = b1;
+        bOr.Or(b2);
+        bAnd.And(b2);
+        bAndNot.AndNot(b2);
+        for (size_t i = 0; i < size; i++) {
+            BOOST_CHECK_EQUAL(bOr.Get(i), vec1[i] || vec2[i]);
+            BOOST_CHECK_EQUAL(bAnd.Get(i), vec1[i] && vec2[i]);
+            BOOST_CHECK_EQUAL(bAndNot.Get(i), vec1[i] && !vec2[i]);
+        }
+
+        b1.SetAll(true);
+        BOOST_CHECK_EQUAL(b1.Count(), size);
+        BOOST_CHECK_EQUAL(b1.FindNext(size - 1), size - 1);
+        b1.Resize(size / 2);
+        BOOST_CHECK_EQUAL(b1.Count(), size / 2);
+        b1.SetAll(false);
+        BOOST_CHECK(!b1.Any());
+        BOOST_CHECK_EQUAL(b1.FindNext(0), b1.Size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sigsharesinv_serialization)
+{
+    // The inv must stay compatible to the old std::vector<bool> based AUTOBITSET serialization, for both the sparse
+    // (var ints) and dense (fixed bit set) encoding
+    for (const int density : {0, 2, 50, 100}) {
+        const size_t size = 400;
+        const auto vec = RandomBits(size, density);
+
+        CSigSharesInv inv;
+        inv.sessionId = 42;
+        inv.Init(size);
+        for (size_t i = 0; i < size; i++) {
+            inv.Set(i, vec[i]);
+        }
+
+        CDataStream ssOld(SER_NETWORK, PROTOCOL_VERSION);
+        uint64_t invSize = size;
+        autobitset_t bitset = std::make_pair(vec, size);
+        ssOld << VARINT(inv.sessionId) << COMPACTSIZE(invSize) << AUTOBITSET(bitset);
+
+        CDataStream ssNew(SER_NETWORK, PROTOCOL_VERSION);
+        ssNew << inv;
+        BOOST_CHECK_EQUAL(HexStr(ssNew), HexStr(ssOld));
+
+        CSigSharesInv inv2;
+        ssOld >> inv2;
+        BOOST_CHECK_EQUAL(inv2.sessionId, inv.sessionId);
+        BOOST_CHECK(inv2.inv == inv.inv);
+        BOOST_CHECK_EQUAL(inv2.CountSet(), inv.CountSet());
+    }
+
+    // Oversized invs are rejected while unserializing
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    uint32_t sessionId = 1;
+    uint64_t invSize = CQuorumMemberBitSet::MAX_SIZE + 1;
+    ss << VARINT(sessionId) << COMPACTSIZE(invSize) << uint8_t{1} << uint8_t{0};
+    CSigSharesInv inv;
+    BOOST_CHECK_THROW(ss >> inv, std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(sigsharemap)
+{
+    SigShareMap<int64_t> map;
+    std::map<SigShareKey, int64_t> expected;
+
+    std::vector<uint256> signHashes(10);
+    for (auto& signHash : signHashes) {
+        signHash = InsecureRand256();
+    }
+
+    for (int i = 0; i < 2000; i++) {
+        const SigShareKey k{signHashes[InsecureRandRange(signHashes.size())], uint16_t(InsecureRandRange(400))};
+        const int64_t v = InsecureRandRange(1000);
+        switch (InsecureRandRange(4)) {
+        case 0:
+        case 1:
+            BOOST_CHECK_EQUAL(map.Add(k, v), expected.emplace(k, v).second);
+            break;
+        case 2:
+            map.Erase(k);
+            expected.erase(k);
+            break;
+        case 3:
+            map.GetOrAdd(k) = v;
+            expected[k] = v;
+            break;
+        }
+        BOOST_CHECK_EQUAL(map.Size(), expected.size());
+    }
+
+    for (const auto& [k, v] : expected) {
+        BOOST_CHECK(map.Has(k));
+        BOOST_CHECK_EQUAL(*map.Get(k), v);
+    }
+
+    size_t count = 0;
+    map.ForEach([&](const SigShareKey& k, int64_t v) {
+        BOOST_CHECK_EQUAL(expected.at(k), v);
+        count++;
+    });
+    BOOST_CHECK_EQUAL(count, expected.size());
+
+    map.EraseIf([](const SigShareKey&, int64_t v) { return v < 500; });
+    for (auto it = expected.begin(); it != expected.end(); ) {
+        it = it->second < 500 ? expected.erase(it) : std::next(it);
+    }
+    BOOST_CHECK_EQUAL(map.Size(), expected.size());
+
+    size_t expectedForSignHash = 0;
+    for (const auto& [k, _] : expected) {
+        expectedForSignHash += k.first == signHashes[0];
+    }
+    BOOST_CHECK_EQUAL(map.CountForSignHash(signHashes[0]), expectedForSignHash);
+    map.EraseAllForSignHash(signHashes[0]);
+    BOOST_CHECK_EQUAL(map.CountForSignHash(signHashes[0]), 0U);
+    BOOST_CHECK_EQUAL(map.Size(), expected.size() - expectedForSignHash);
+
+    map.Clear();
+    BOOST_CHECK(map.Empty());
+    BOOST_CHECK_EQUAL(map.Size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(node_states_striping)
+{
+    CSigSharesNodeStates nodeStates;
+
+    // Each thread updates all node states, a plain (non atomic) counter per node is only race free if the stripe lock
+    // of the node is held for every update
+    constexpr NodeId NODES{3 * CSigSharesNodeStates::STRIPES + 1};
+    constexpr int THREADS{4};
+    constexpr int ITERATIONS{200};
+    std::vector<int> counters(NODES, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < ITERATIONS; i++) {
+                for (NodeId n = 0; n < NODES; n++) {
+                    const NodeId nodeId = (n + t) % NODES;
+                    nodeStates.With(nodeId, [&](CSigSharesNodeState&) { counters[nodeId]++; });
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (NodeId n = 0; n < NODES; n++) {
+        BOOST_CHECK_EQUAL(counters[n], THREADS * ITERATIONS);
+    }
+
+    auto nodeIds = nodeStates.GetNodeIds();
+    std::sort(nodeIds.begin(), nodeIds.end());
+    BOOST_CHECK_EQUAL(nodeIds.size(), size_t(NODES));
+    for (NodeId n = 0; n < NODES; n++) {
+        BOOST_CHECK_EQUAL(nodeIds[n], n);
+    }
+
+    // states are kept per node, also for nodes sharing a stripe
+    nodeStates.With(1, [](CSigSharesNodeState& nodeState) { nodeState.banned = true; });
+    BOOST_CHECK(!nodeStates.With(1 + CSigSharesNodeStates::STRIPES, [](CSigSharesNodeState& nodeState) { return nodeState.banned; }));
+    BOOST_CHECK(nodeStates.With(1, [](CSigSharesNodeState& nodeState) { return nodeState.banned; }));
+
+    // a node holding its stripe doesn't block nodes of other stripes
+    std::promise<void> release;
+    std::promise<void> locked;
+    std::thread holder([&]() {
+        nodeStates.With(0, [&](CSigSharesNodeState&) {
+            locked.set_value();
+            release.get_future().wait();
+        });
+    });
+    locked.get_future().wait();
+    nodeStates.With(1, [](CSigSharesNodeState& nodeState) { nodeState.banned = false; });
+    BOOST_CHECK(!nodeStates.WithExisting(NODES, [](CSigSharesNodeState&) {}));
+    release.set_value();
+    holder.join();
+
+    // erasing and iterating doesn't create new states
+    nodeStates.EraseIf([](NodeId nodeId, const CSigSharesNodeState&) { return nodeId % 2 == 0; });
+    size_t count = 0;
+    nodeStates.ForEach([&](NodeId nodeId, const CSigSharesNodeState&) {
+        BOOST_CHECK(nodeId % 2 == 1);
+        count++;
+    });
+    BOOST_CHECK_EQUAL(count, size_t(NODES / 2));
+    BOOST_CHECK(!nodeStates.WithExisting(0, [](CSigSharesNodeState&) {}));
+    BOOST_CHECK(nodeStates.WithExisting(1, [](CSigSharesNodeState&) {}));
+    BOOST_CHECK_EQUAL(nodeStates.GetNodeIds().size(), size_t(NODES / 2));
+}
+
+BOOST_AUTO_TEST_CASE(sharded_worker_pool_order)
+{
+    constexpr size_t WORKERS{4};
+    constexpr size_t KEYS{8};
+    constexpr size_t JOBS_PER_KEY{100};
+
+    CShardedWorkerPool pool(KEYS * JOBS_PER_KEY + KEYS);
+    // not started yet, the caller has to do the work
+    BOOST_CHECK(!pool.Push(uint256(), [](size_t) {}));
+
+    pool.Start(WORKERS, "test-shard");
+    BOOST_CHECK_EQUAL(pool.GetWorkerCount(), WORKERS);
+
+    // the results of each key are only written by the single worker of that key
+    std::vector<std::vector<size_t>> results(KEYS);
+    std::vector<std::set<size_t>> workersOfKey(KEYS);
+    std::vector<std::promise<void>> done(KEYS);
+    for (size_t i = 0; i < JOBS_PER_KEY; i++) {
+        for (size_t k = 0; k < KEYS; k++) {
+            BOOST_CHECK(pool.Push(ArithToUint256(arith_uint256(k)), [&, k, i](size_t nWorker) {
+                workersOfKey[k].emplace(nWorker);
+                results[k].emplace_back(i);
+            }));
+        }
+    }
+    for (size_t k = 0; k < KEYS; k++) {
+        BOOST_CHECK(pool.Push(ArithToUint256(arith_uint256(k)), [&, k](size_t) { done[k].set_value(); }));
+    }
+    for (auto& d : done) {
+        d.get_future().wait();
+    }
+
+    for (size_t k = 0; k < KEYS; k++) {
+        BOOST_CHECK_EQUAL(pool.GetWorkerIndex(ArithToUint256(arith_uint256(k))), k % WORKERS);
+        BOOST_CHECK(workersOfKey[k] == std::set<size_t>{k % WORKERS});
+        BOOST_CHECK_EQUAL(results[k].size(), JOBS_PER_KEY);
+        BOOST_CHECK(std::is_sorted(results[k].begin(), results[k].end()));
+    }
+    pool.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(sharded_worker_pool_concurrency)
+{
+    CShardedWorkerPool pool(2);
+    pool.Start(2, "test-shard");
+
+    const uint256 key0 = ArithToUint256(arith_uint256(0));
+    const uint256 key1 = ArithToUint256(arith_uint256(1));
+    BOOST_CHECK(pool.GetWorkerIndex(key0) != pool.GetWorkerIndex(key1));
+
+    // a job which blocks its worker doesn't block the jobs of other workers
+    std::promise<void> release;
+    std::promise<void> otherRan;
+    std::promise<bool> blockedDone;
+    BOOST_CHECK(pool.Push(key0, [&](size_t) {
+        const bool fOtherRan = otherRan.get_future().wait_for(std::chrono::seconds(30)) == std::future_status::ready;
+        release.get_future().wait();
+        blockedDone.set_value(fOtherRan);
+    }));
+    BOOST_CHECK(pool.Push(key1, [&](size_t) { otherRan.set_value(); }));
+
+    // the queue of each worker is bounded, including the running job
+    BOOST_CHECK(pool.Push(key0, [](size_t) {}));
+    BOOST_CHECK(!pool.Push(key0, [](size_t) {}));
+
+    release.set_value();
+    BOOST_CHECK(blockedDone.get_future().get());
+    pool.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -59,6 +59,7 @@
 #include <evo/deterministicmns.h>
 #include <evo/evodb.h>
 #include <evo/specialtx.h>
+#include <evo/specialtxman.h>
 
 #include <memory>
 
@@ -191,6 +192,7 @@ ChainTestingSetup::ChainTestingSetup(const std::string& chainName, const std::ve
     // Start script-checking threads. Set g_parallel_script_checks to true so they are used.
     constexpr int script_check_threads = 2;
     StartScriptCheckWorkerThreads(script_check_threads);
+    StartSpecialTxCheckWorkerThreads(std::min(script_check_threads, MAX_SPECIALTXCHECK_THREADS));
     g_parallel_script_checks = true;
 }
 
@@ -201,6 +203,7 @@ ChainTestingSetup::~ChainTestingSetup()
     m_node.llmq_ctx->Interrupt();
     m_node.llmq_ctx->Stop();
     StopScriptCheckWorkerThreads();
+    StopSpecialTxCheckWorkerThreads();
     GetMainSignals().FlushBackgroundCallbacks();
     GetMainSignals().UnregisterBackgroundSignalScheduler();
 #ifdef ENABLE_WALLET
@@ -6,7 +6,7 @@
 #include <threadinterrupt.h>
 #include <sync.h>
 
-CThreadInterrupt::CThreadInterrupt() : flag(false) {}
+CThreadInterrupt::CThreadInterrupt() : flag(false), wakeupPending(false) {}
 
 CThreadInterrupt::operator bool() const
 {
@@ -27,10 +27,23 @@ void CThreadInterrupt::operator()()
     cond.notify_all();
 }
 
+void CThreadInterrupt::wakeup()
+{
+    {
+        LOCK(mut);
+        wakeupPending.store(true, std::memory_order_release);
+    }
+    cond.notify_all();
+}
+
 bool CThreadInterrupt::sleep_for(std::chrono::milliseconds rel_time)
 {
     WAIT_LOCK(mut, lock);
-    return !cond.wait_for(lock, rel_time, [this]() { return flag.load(std::memory_order_acquire); });
+    cond.wait_for(lock, rel_time, [this]() {
+        return flag.load(std::memory_order_acquire) || wakeupPending.load(std::memory_order_acquire);
+    });
+    wakeupPending.store(false, std::memory_order_release);
+    return !flag.load(std::memory_order_acquire);
 }
 
 bool CThreadInterrupt::sleep_for(std::chrono::seconds rel_time)
@@ -14,7 +14,9 @@
 /*
     A helper class for interruptible sleeps. Calling operator() will interrupt
     any current sleep, and after that point operator bool() will return true
-    until reset.
+    until reset. Calling wakeup() ends the current (or the next) sleep early
+    without interrupting, which lets worker threads wait for new work instead
+    of polling.
 */
 class CThreadInterrupt
 {
@@ -23,6 +25,7 @@ public:
     explicit operator bool() const;
     void operator()();
     void reset();
+    void wakeup();
     bool sleep_for(std::chrono::milliseconds rel_time);
     bool sleep_for(std::chrono::seconds rel_time);
     bool sleep_for(std::chrono::minutes rel_time);
@@ -31,6 +34,7 @@ private:
     std::condition_variable cond;
     Mutex mut;
     std::atomic<bool> flag;
+    std::atomic<bool> wakeupPending;
 };
 
 #endif //BITCOIN_THREADINTERRUPT_H